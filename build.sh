@@ -1,21 +1,75 @@
 #!/bin/sh
 
 build_mode="debug" # temporary for now
+# 1: compile the levels into the binary, no level files are read at runtime (kiosk/benchmark builds)
+embed_levels=0
+# 1: build for CPUs with AVX2, 8 wide collision contact batches and level text classified
+# in 64 byte blocks with two 32 byte compares per class. 0 runs on any x86-64 (SSE2: 4 wide
+# batches, four 16 byte compares per class)
+simd_avx2=0
 
 build_dir="build"
 mkdir -p $build_dir
 
 compile_opts="-std=c++11 -g -O0" # -fsanitize=address
+if [ "$simd_avx2" = "1" ]; then
+  compile_opts="$compile_opts -mavx2"
+fi
 
 include_path=include
 include_opts="-I $include_path"
 
-files="source/main.cpp $include_path/glad/glad.c"
-build_opts="$build_dir/main"
-
 lib_path="libs/SDL2"
 link_opts="-L $lib_path -lSDL2 -lpthread -lm -ldl"
 
+# tools
+level_compiler_command="clang++ $compile_opts $include_opts source/tools/level_compiler.cpp $link_opts -o $build_dir/level_compiler"
+
+# stress levels for scaling tests, e.g. build/level_gen -count 100000 levels/stress_100k.txt
+level_gen_command="clang++ $compile_opts $include_opts source/tools/level_gen.cpp -lm -o $build_dir/level_gen"
+
+# broad phase benchmark, e.g. build/broadphase_bench -bodies 5000 levels/stress_100k.txt
+# (checked against O(n*m) loops on every 25th frame, -check <n> changes that)
+broadphase_bench_command="clang++ $compile_opts $include_opts source/tools/broadphase_bench.cpp $link_opts -o $build_dir/broadphase_bench"
+
+# solvability check, e.g. build/level_solver -replays build/solutions levels/*.txt
+level_solver_command="clang++ $compile_opts $include_opts source/tools/level_solver.cpp $link_opts -o $build_dir/level_solver"
+
+# level query check against loops over every collider, e.g. build/level_query_check levels/*.txt
+level_query_check_command="clang++ $compile_opts $include_opts source/tools/level_query_check.cpp $link_opts -o $build_dir/level_query_check"
+
+# tunnelling stress test of the player's continuous collision, e.g. build/swept_stress -scenes 200000 -speed 400
+swept_stress_command="clang++ $compile_opts $include_opts source/tools/swept_stress.cpp $link_opts -o $build_dir/swept_stress"
+
+printf "Building Tools...\n"
+printf "$level_compiler_command\n\n"
+$level_compiler_command
+printf "$level_gen_command\n\n"
+$level_gen_command
+printf "$broadphase_bench_command\n\n"
+$broadphase_bench_command
+printf "$level_solver_command\n\n"
+$level_solver_command
+printf "$level_query_check_command\n\n"
+$level_query_check_command
+printf "$swept_stress_command\n\n"
+$swept_stress_command
+
+# compiled levels, loaded by the game in place of levels/*.txt when up to date
+level_build_dir="$build_dir/levels"
+mkdir -p $level_build_dir
+$build_dir/level_compiler $level_build_dir levels/*.txt
+# level pack, a single indexed file the game prefers over loose levels when up to date
+$build_dir/level_compiler -pack $build_dir/levels.pack levels/*.txt
+if [ "$embed_levels" = "1" ]; then
+  $build_dir/level_compiler -embed $build_dir/embedded_levels.h levels/*.txt
+  compile_opts="$compile_opts -DLEVELS_EMBEDDED -I $build_dir"
+fi
+printf "\nTools Complete!\n\n"
+
+files="source/main.cpp $include_path/glad/glad.c"
+build_opts="$build_dir/main"
+
 build_command="clang++ $compile_opts $include_opts $files $link_opts -o $build_opts"
 
 printf "Building Project...\n"
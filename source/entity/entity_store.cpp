@@ -0,0 +1,334 @@
+#include "entity_store.h"
+
+static u32 entity_id_map_capacity(u32 capacity) {
+  // keep the load factor at or below 1/2
+  u32 map_capacity = 16;
+  while (map_capacity < capacity*2) {
+    map_capacity *= 2;
+  }
+  return map_capacity;
+}
+
+// @description: arena space entity_store_init takes for capacity entities
+size_t entity_store_size(u32 capacity) {
+  size_t entity_size = sizeof(s32) + sizeof(u8) + sizeof(Rect) + sizeof(Vec3) + sizeof(Vec2) + sizeof(u32);
+  size_t registry_size = sizeof(u32) + sizeof(u8) + sizeof(EntityHandle) + sizeof(u32) + sizeof(u32);
+  size_t map_size = entity_id_map_capacity(capacity)*(sizeof(s32) + sizeof(u32));
+  // every array is aligned on its own
+  return capacity*(entity_size + registry_size) + map_size + 13*ALIGNMENT;
+}
+
+// @note: store is reused from level to level, everything but generation_end is reset
+void entity_store_init(EntityStore *store, Arena *arena, u32 capacity) {
+  store->count = 0;
+  store->capacity = capacity;
+  store->ids = (s32*)arena_alloc(arena, capacity*sizeof(s32));
+  store->types = (u8*)arena_alloc(arena, capacity*sizeof(u8));
+  store->bounds = (Rect*)arena_alloc(arena, capacity*sizeof(Rect));
+  store->positions = (Vec3*)arena_alloc(arena, capacity*sizeof(Vec3));
+  store->sizes = (Vec2*)arena_alloc(arena, capacity*sizeof(Vec2));
+  store->link_ids = (u32*)arena_alloc(arena, capacity*sizeof(u32));
+
+  store->generations = (u32*)arena_alloc(arena, capacity*sizeof(u32));
+  store->spawned = (u8*)arena_alloc(arena, capacity*sizeof(u8));
+  store->links = (EntityHandle*)arena_alloc(arena, capacity*sizeof(EntityHandle));
+  store->free_slots = (u32*)arena_alloc(arena, capacity*sizeof(u32));
+  store->free_count = 0;
+  // every slot starts dead, on an even generation past the ones of the previous level
+  u32 generation_base = (store->generation_end + 1) & ~1u;
+  for (u32 i = 0; i < capacity; i++) {
+    store->generations[i] = generation_base;
+  }
+  store->generation_end = generation_base;
+  store->bucket_indices = (u32*)arena_alloc(arena, capacity*sizeof(u32));
+  memset(store->bucket_offsets, 0, sizeof(store->bucket_offsets));
+
+  EntityIdMap *map = &store->id_map;
+  map->capacity = entity_id_map_capacity(capacity);
+  map->ids = (s32*)arena_alloc(arena, map->capacity*sizeof(s32));
+  map->slots = (u32*)arena_alloc(arena, map->capacity*sizeof(u32));
+  SDL_assert(map->slots != NULL);
+}
+
+// ==================== ID MAP ====================
+static inline u32 entity_id_hash(s32 id) {
+  u32 h = (u32)id*0x9E3779B1u;
+  return h ^ (h >> 16);
+}
+
+static void entity_id_map_clear(EntityIdMap *map) {
+  memset(map->slots, 0xFF, map->capacity*sizeof(u32));
+}
+
+static u32 entity_id_map_find(EntityIdMap *map, s32 id) {
+  u32 mask = map->capacity - 1;
+  for (u32 i = entity_id_hash(id) & mask; map->slots[i] != ENTITY_INVALID_INDEX; i = (i + 1) & mask) {
+    if (map->ids[i] == id) {
+      return map->slots[i];
+    }
+  }
+  return ENTITY_INVALID_INDEX;
+}
+
+// @note: ids are not guaranteed to be unique in level files (an explicit id can
+// match an auto-generated one), the first entity with an id keeps it
+static void entity_id_map_insert(EntityIdMap *map, s32 id, u32 slot) {
+  u32 mask = map->capacity - 1;
+  u32 i = entity_id_hash(id) & mask;
+  for (; map->slots[i] != ENTITY_INVALID_INDEX; i = (i + 1) & mask) {
+    if (map->ids[i] == id) {
+      return;
+    }
+  }
+  map->ids[i] = id;
+  map->slots[i] = slot;
+}
+
+// @description: removes id if it maps to slot, entries after it in the probe
+// sequence are shifted back so no tombstones are needed
+static void entity_id_map_remove(EntityIdMap *map, s32 id, u32 slot) {
+  u32 mask = map->capacity - 1;
+  u32 i = entity_id_hash(id) & mask;
+  for (; map->slots[i] != ENTITY_INVALID_INDEX; i = (i + 1) & mask) {
+    if (map->ids[i] == id) {
+      break;
+    }
+  }
+  if (map->slots[i] != slot) {
+    return;
+  }
+  u32 j = i;
+  while (1) {
+    j = (j + 1) & mask;
+    if (map->slots[j] == ENTITY_INVALID_INDEX) {
+      break;
+    }
+    u32 home = entity_id_hash(map->ids[j]) & mask;
+    // the entry at j can fill the hole at i unless its home bucket lies in (i, j]
+    b8 stays = i <= j ? (home > i && home <= j) : (home > i || home <= j);
+    if (!stays) {
+      map->ids[i] = map->ids[j];
+      map->slots[i] = map->slots[j];
+      i = j;
+    }
+  }
+  map->slots[i] = ENTITY_INVALID_INDEX;
+}
+
+// ==================== TYPE BUCKETS ====================
+// @description: counting sort of the live slots by type
+static void entity_buckets_build(EntityStore *store) {
+  u32 *offsets = store->bucket_offsets;
+  memset(offsets, 0, sizeof(store->bucket_offsets));
+  for (u32 i = 0; i < store->count; i++) {
+    if (entity_is_alive(store, i) && store->types[i] < ENTITY_TYPE_COUNT) {
+      offsets[store->types[i] + 1]++;
+    }
+  }
+  for (u32 t = 0; t < ENTITY_TYPE_COUNT; t++) {
+    offsets[t + 1] += offsets[t];
+  }
+  u32 cursor[ENTITY_TYPE_COUNT];
+  memcpy(cursor, offsets, sizeof(cursor));
+  for (u32 i = 0; i < store->count; i++) {
+    if (entity_is_alive(store, i) && store->types[i] < ENTITY_TYPE_COUNT) {
+      store->bucket_indices[cursor[store->types[i]]++] = i;
+    }
+  }
+}
+
+// @note: spawns and despawns shift the buckets after the one that changed,
+// that is fine for the handful of entities a level changes at runtime
+static void entity_buckets_insert(EntityStore *store, u32 slot) {
+  u32 type = store->types[slot];
+  if (type >= ENTITY_TYPE_COUNT) {
+    return;
+  }
+  u32 *offsets = store->bucket_offsets;
+  u32 insert_at = offsets[type + 1];
+  while (insert_at > offsets[type] && store->bucket_indices[insert_at - 1] > slot) {
+    insert_at--;
+  }
+  memmove(&store->bucket_indices[insert_at + 1], &store->bucket_indices[insert_at],
+	  (offsets[ENTITY_TYPE_COUNT] - insert_at)*sizeof(u32));
+  store->bucket_indices[insert_at] = slot;
+  for (u32 t = type + 1; t <= ENTITY_TYPE_COUNT; t++) {
+    offsets[t]++;
+  }
+}
+
+static void entity_buckets_remove(EntityStore *store, u32 slot) {
+  u32 type = store->types[slot];
+  if (type >= ENTITY_TYPE_COUNT) {
+    return;
+  }
+  u32 *offsets = store->bucket_offsets;
+  for (u32 i = offsets[type]; i < offsets[type + 1]; i++) {
+    if (store->bucket_indices[i] != slot) {
+      continue;
+    }
+    memmove(&store->bucket_indices[i], &store->bucket_indices[i + 1],
+	    (offsets[ENTITY_TYPE_COUNT] - i - 1)*sizeof(u32));
+    for (u32 t = type + 1; t <= ENTITY_TYPE_COUNT; t++) {
+      offsets[t]--;
+    }
+    return;
+  }
+}
+
+EntityQuery entity_query(EntityStore *store, ENTITY_TYPE type) {
+  EntityQuery query = {NULL, 0};
+  if ((u32)type < ENTITY_TYPE_COUNT) {
+    u32 begin = store->bucket_offsets[type];
+    query.indices = store->bucket_indices + begin;
+    query.count = store->bucket_offsets[type + 1] - begin;
+  }
+  return query;
+}
+
+// ==================== STORE ====================
+// @description: flips a slot between live (odd) and dead (even)
+static inline void entity_generation_next(EntityStore *store, u32 index) {
+  u32 generation = ++store->generations[index];
+  store->generation_end = MAX(store->generation_end, generation + 1);
+}
+
+static void entity_store_write(EntityStore *store, u32 index, const Entity *e) {
+  store->ids[index] = e->id;
+  store->types[index] = (u8)e->type;
+  store->bounds[index] = e->bounds;
+  store->positions[index] = e->position;
+  store->sizes[index] = e->size;
+  store->link_ids[index] = e->link_id;
+  store->links[index] = EntityHandle{ENTITY_INVALID_INDEX, 0};
+}
+
+// @description: scatters the (scaled) Entity table into the store, replacing
+// everything in it (spawned entities included), and resolves teleporter links
+void entity_store_load(EntityStore *store, const Entity *entities, u32 count) {
+  SDL_assert(count <= store->capacity);
+  entity_id_map_clear(&store->id_map);
+  for (u32 i = 0; i < count; i++) {
+    entity_store_write(store, i, &entities[i]);
+    if (!entity_is_alive(store, i)) {
+      entity_generation_next(store, i);
+    }
+    store->spawned[i] = 0;
+    entity_id_map_insert(&store->id_map, entities[i].id, i);
+  }
+  for (u32 i = count; i < store->count; i++) {
+    if (entity_is_alive(store, i)) {
+      entity_generation_next(store, i);
+    }
+  }
+  store->count = count;
+  store->free_count = 0;
+  entity_buckets_build(store);
+
+  for (u32 i = 0; i < count; i++) {
+    if (store->types[i] == TELEPORT) {
+      entity_link(store, i);
+    }
+  }
+}
+
+// @description: gathers one entity back into an Entity, for the code paths that
+// work on a single entity. raw_position/raw_size are not kept at runtime.
+Entity entity_store_get(EntityStore *store, u32 index) {
+  Entity e;
+  memset(&e, 0, sizeof(Entity));
+  e.id = store->ids[index];
+  e.type = (ENTITY_TYPE)store->types[index];
+  e.position = store->positions[index];
+  e.size = store->sizes[index];
+  e.bounds = store->bounds[index];
+  e.link_id = store->link_ids[index];
+  return e;
+}
+
+// @description: moves an entity, keeping its bounds in sync
+void entity_store_set_position(EntityStore *store, u32 index, Vec3 position) {
+  store->positions[index] = position;
+  store->bounds[index] = rect(position.v2(), store->sizes[index]);
+}
+
+// @description: rewrites a live slot in place (same id), e.g. with an edited copy of
+// the level entity it was loaded from (see entity_is_from_level). The other slots,
+// spawned ones included, stay.
+void entity_store_set(EntityStore *store, u32 index, const Entity *e) {
+  SDL_assert(entity_is_alive(store, index) && store->ids[index] == e->id);
+  b8 type_changed = store->types[index] != (u8)e->type;
+  if (type_changed) {
+    entity_buckets_remove(store, index);
+  }
+  entity_store_write(store, index, e);
+  if (type_changed) {
+    entity_buckets_insert(store, index);
+  }
+}
+
+// ==================== REGISTRY ====================
+// @description: slot of the live entity with this id, or ENTITY_INVALID_INDEX
+u32 entity_find(EntityStore *store, s32 id) {
+  return entity_id_map_find(&store->id_map, id);
+}
+
+EntityHandle entity_handle(EntityStore *store, u32 index) {
+  return EntityHandle{index, store->generations[index]};
+}
+
+// @description: slot the handle refers to, ENTITY_INVALID_INDEX once it was despawned
+u32 entity_resolve(EntityStore *store, EntityHandle handle) {
+  if (handle.index >= store->count || store->generations[handle.index] != handle.generation ||
+      !entity_is_alive(store, handle.index)) {
+    return ENTITY_INVALID_INDEX;
+  }
+  return handle.index;
+}
+
+// @description: slot of the entity index links to (teleporter destination).
+// Resolved through the id map once and cached as a handle, a stale handle
+// (the destination was despawned) is looked up again.
+u32 entity_link(EntityStore *store, u32 index) {
+  u32 link = entity_resolve(store, store->links[index]);
+  if (link == ENTITY_INVALID_INDEX) {
+    link = entity_find(store, (s32)store->link_ids[index]);
+    if (link != ENTITY_INVALID_INDEX) {
+      store->links[index] = entity_handle(store, link);
+    }
+  }
+  return link;
+}
+
+// @description: adds an entity at runtime, reusing despawned slots first.
+// Returns a handle with index ENTITY_INVALID_INDEX when the store is full.
+EntityHandle entity_spawn(EntityStore *store, Entity e) {
+  u32 slot = ENTITY_INVALID_INDEX;
+  if (store->free_count > 0) {
+    slot = store->free_slots[--store->free_count];
+  } else if (store->count < store->capacity) {
+    slot = store->count++;
+  } else {
+    return EntityHandle{ENTITY_INVALID_INDEX, 0};
+  }
+  entity_store_write(store, slot, &e);
+  entity_generation_next(store, slot);
+  store->spawned[slot] = 1;
+  entity_id_map_insert(&store->id_map, e.id, slot);
+  entity_buckets_insert(store, slot);
+  return entity_handle(store, slot);
+}
+
+// @description: removes an entity at runtime. Its slot stays in place (other
+// slots do not move), the loops skip it until a spawn reuses it.
+b8 entity_despawn(EntityStore *store, EntityHandle handle) {
+  u32 slot = entity_resolve(store, handle);
+  if (slot == ENTITY_INVALID_INDEX) {
+    return 0;
+  }
+  entity_id_map_remove(&store->id_map, store->ids[slot], slot);
+  entity_buckets_remove(store, slot);
+  entity_generation_next(store, slot);
+  store->free_slots[store->free_count++] = slot;
+  return 1;
+}
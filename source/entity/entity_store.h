@@ -0,0 +1,112 @@
+#pragma once
+
+#include "../core.h"
+#include "../math.h"
+#include "../memory/arena.h"
+#include "../level/level.h"
+
+#define ENTITY_INVALID_INDEX 0xFFFFFFFFu
+// free slots every level gets on top of its own entities, for entities spawned at runtime
+#define ENTITY_SPAWN_RESERVE 64
+
+// @note: refers to a slot of the store. The generation changes every time the slot
+// is despawned, so a handle kept around after that no longer resolves. Generations
+// keep counting up across entity_store_init (level switches, hot reloads), a handle
+// from an earlier level never resolves on a later one.
+struct EntityHandle {
+    u32 index;
+    u32 generation;
+};
+
+// @note: open addressing (linear probing) map from entity id to slot.
+// Empty buckets have slot == ENTITY_INVALID_INDEX.
+struct EntityIdMap {
+    u32 capacity;	// power of two
+    s32 *ids;
+    u32 *slots;
+};
+
+// @description: slots of every live entity of one type, in slot order
+struct EntityQuery {
+    const u32 *indices;
+    u32 count;
+};
+
+// @note: runtime entity storage, one contiguous array per field (structure of arrays).
+// Built from the loaded Level's Entity table, which stays untouched as the level's
+// source data. The hot loops (collision, teleport, render) only pull in the
+// arrays they read, e.g. the collision pass walks bounds and types and nothing else.
+// Slots never move, despawned slots are reused by later spawns.
+struct EntityStore {
+    u32 count;		// slots in use or despawned, loops run over [0, count)
+    u32 capacity;
+    s32 *ids;
+    u8 *types;		// ENTITY_TYPE
+    Rect *bounds;
+    Vec3 *positions;
+    Vec2 *sizes;
+    u32 *link_ids;
+    // registry
+    u32 *generations;	// odd while the slot holds a live entity
+    u32 generation_end;	// above every generation handed out, survives entity_store_init
+    u8 *spawned;	// 1 when entity_spawn wrote the slot, 0 for the level table's entities
+    EntityHandle *links;	// link_ids resolved to slots
+    u32 *free_slots;
+    u32 free_count;
+    EntityIdMap id_map;
+    // type buckets: the slots of type t are bucket_indices[bucket_offsets[t], bucket_offsets[t + 1])
+    u32 bucket_offsets[ENTITY_TYPE_COUNT + 1];
+    u32 *bucket_indices;
+};
+
+size_t entity_store_size(u32 capacity);
+void entity_store_init(EntityStore *store, Arena *arena, u32 capacity);
+void entity_store_load(EntityStore *store, const Entity *entities, u32 count);
+Entity entity_store_get(EntityStore *store, u32 index);
+void entity_store_set_position(EntityStore *store, u32 index, Vec3 position);
+void entity_store_set(EntityStore *store, u32 index, const Entity *e);
+
+// ==================== REGISTRY ====================
+u32 entity_find(EntityStore *store, s32 id);
+EntityHandle entity_handle(EntityStore *store, u32 index);
+u32 entity_resolve(EntityStore *store, EntityHandle handle);
+u32 entity_link(EntityStore *store, u32 index);
+EntityHandle entity_spawn(EntityStore *store, Entity e);
+b8 entity_despawn(EntityStore *store, EntityHandle handle);
+
+// ==================== TYPE BUCKETS ====================
+EntityQuery entity_query(EntityStore *store, ENTITY_TYPE type);
+
+inline s32 entity_id(EntityStore *store, u32 index) {
+  return store->ids[index];
+}
+
+inline ENTITY_TYPE entity_type(EntityStore *store, u32 index) {
+  return (ENTITY_TYPE)store->types[index];
+}
+
+inline Rect entity_bounds(EntityStore *store, u32 index) {
+  return store->bounds[index];
+}
+
+inline Vec3 entity_position(EntityStore *store, u32 index) {
+  return store->positions[index];
+}
+
+inline Vec2 entity_size(EntityStore *store, u32 index) {
+  return store->sizes[index];
+}
+
+inline u32 entity_link_id(EntityStore *store, u32 index) {
+  return store->link_ids[index];
+}
+
+inline b8 entity_is_alive(EntityStore *store, u32 index) {
+  return store->generations[index] & 1;
+}
+
+// @description: the slot still holds the level entity entity_store_load put there,
+// it was not despawned and no spawn took the slot over
+inline b8 entity_is_from_level(EntityStore *store, u32 index) {
+  return entity_is_alive(store, index) && !store->spawned[index];
+}
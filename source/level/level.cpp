@@ -0,0 +1,835 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "SDL2/SDL_rwops.h"
+#include "SDL2/SDL_stdinc.h"
+#include "level.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#define LEVEL_SSE2 1
+#include <emmintrin.h>
+#else
+#define LEVEL_SSE2 0
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LEVEL_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define LEVEL_MMAP 0
+#endif
+
+void level_default_entity_z(r32 *entity_z) {
+  entity_z[TEXT] = -3.0f;
+  entity_z[DEBUG_LINE] = -4.0f;
+  r32 entity_base_z = -5.0f;
+  entity_z[OBSTACLE] = entity_base_z - 1.0f;
+  entity_z[GOAL] = entity_base_z - 2.0f;
+  {
+    entity_z[TELEPORT] = entity_base_z - 3.0f;
+    entity_z[INVERT_GRAVITY] = entity_base_z - 3.0f;
+  }
+  entity_z[PLAYER] = entity_base_z - 4.0f;
+}
+
+void level_scale_entities(Entity *entities, u32 count, Vec2 render_scale, Vec2 atom_size) {
+  for (u32 i = 0; i < count; i++) {
+    Entity *e = &entities[i];
+    e->position = Vec3{
+      e->raw_position.x * render_scale.x,
+      e->raw_position.y * render_scale.y,
+      e->raw_position.z
+    };
+    e->size = e->raw_size * atom_size;
+    e->bounds = rect(e->position.v2(), e->size);
+  }
+}
+
+// ==================== TOKENIZER ====================
+// @note: the text is classified 64 bytes at a time into bit masks, one bit per byte:
+// two 32 byte compares per class with AVX2 (simd_avx2 in build.sh), four 16 byte
+// ones with SSE2, a byte loop on other targets and for the last partial block.
+// Tokens and line ends are then found by walking the bits of the block under the
+// cursor, a block is only classified again once the cursor leaves it.
+#define LEVEL_SCAN_BLOCK 64
+
+struct LevelScan {
+  const char *data;
+  size_t end;
+  size_t base;		// first byte of the classified block
+  size_t block_end;	// MIN(base + LEVEL_SCAN_BLOCK, end)
+  u64 content;		// not ' ', '\t' or '\r'
+  u64 newline;		// '\n'
+};
+
+static inline u32 level_ctz64(u64 mask) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, mask);
+  return (u32)index;
+#else
+  return (u32)__builtin_ctzll(mask);
+#endif
+}
+
+static inline LevelScan level_scan_init(const char *data, size_t begin, size_t end) {
+  LevelScan scan;
+  scan.data = data;
+  scan.end = end;
+  scan.base = begin;
+  scan.block_end = begin;	// nothing classified yet
+  scan.content = 0;
+  scan.newline = 0;
+  return scan;
+}
+
+// @description: classifies the block starting at base, bits past the end stay 0
+static void level_scan_block(LevelScan *scan, size_t base) {
+  scan->base = base;
+  scan->block_end = MIN(base + LEVEL_SCAN_BLOCK, scan->end);
+  const char *block = scan->data + base;
+  u64 blank = 0;
+  u64 newline = 0;
+  if (scan->block_end - base == LEVEL_SCAN_BLOCK) {
+#if defined(__AVX2__)
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i nl = _mm256_set1_epi8('\n');
+    for (u32 k = 0; k < LEVEL_SCAN_BLOCK; k += 32) {
+      __m256i chunk = _mm256_loadu_si256((const __m256i*)(block + k));
+      __m256i is_blank = _mm256_or_si256(
+	_mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), _mm256_cmpeq_epi8(chunk, tab)),
+	_mm256_cmpeq_epi8(chunk, cr)
+      );
+      blank |= (u64)(u32)_mm256_movemask_epi8(is_blank) << k;
+      newline |= (u64)(u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, nl)) << k;
+    }
+    scan->content = ~blank;
+    scan->newline = newline;
+    return;
+#elif LEVEL_SSE2
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (u32 k = 0; k < LEVEL_SCAN_BLOCK; k += 16) {
+      __m128i chunk = _mm_loadu_si128((const __m128i*)(block + k));
+      __m128i is_blank = _mm_or_si128(
+	_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+	_mm_cmpeq_epi8(chunk, cr)
+      );
+      blank |= (u64)(u32)_mm_movemask_epi8(is_blank) << k;
+      newline |= (u64)(u32)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl)) << k;
+    }
+    scan->content = ~blank;
+    scan->newline = newline;
+    return;
+#endif
+  }
+  u64 content = 0;
+  for (u32 k = 0; k < (u32)(scan->block_end - base); k++) {
+    char ele = block[k];
+    content |= (u64)(ele != ' ' && ele != '\t' && ele != '\r') << k;
+    newline |= (u64)(ele == '\n') << k;
+  }
+  scan->content = content;
+  scan->newline = newline;
+}
+
+// @description: index of the first byte at or after i whose bit is set in the
+// newline mask (find_newline) or the content mask, or end
+static inline size_t level_scan_next(LevelScan *scan, size_t i, b8 find_newline) {
+  while (i < scan->end) {
+    if (i < scan->base || i >= scan->block_end) {
+      level_scan_block(scan, i);
+    }
+    u64 bits = (find_newline ? scan->newline : scan->content) >> (i - scan->base);
+    if (bits) {
+      return i + level_ctz64(bits);
+    }
+    i = scan->block_end;
+  }
+  return scan->end;
+}
+
+// @description: index of the first byte at or after i that is not ' ', '\t' or '\r'
+static inline size_t level_scan_skip_blank(LevelScan *scan, size_t i) {
+  return level_scan_next(scan, i, 0);
+}
+
+// @description: index of the first '\n' at or after i, or end. Used to skip comments.
+static inline size_t level_scan_find_newline(LevelScan *scan, size_t i) {
+  return level_scan_next(scan, i, 1);
+}
+
+static size_t level_find_newline(const char *data, size_t i, size_t size) {
+  LevelScan scan = level_scan_init(data, i, size);
+  return level_scan_find_newline(&scan, i);
+}
+
+// @description: lines in [begin, end) with something other than whitespace before a '#'.
+// A line has content when its first non blank byte is neither '\n' nor '#'.
+static u32 level_count_lines(const char *data, size_t begin, size_t end) {
+  LevelScan scan = level_scan_init(data, begin, end);
+  u32 line_count = 0;
+  size_t i = begin;
+  while (1) {
+    i = level_scan_skip_blank(&scan, i);
+    if (i >= end) {
+      break;
+    }
+    line_count += data[i] != '\n' && data[i] != '#';
+    i = level_scan_find_newline(&scan, i) + 1;
+  }
+  return line_count;
+}
+
+static inline b8 level_is_separator(char ele) {
+  return ele == ' ' || ele == '\t' || ele == '\r' || ele == '\n' || ele == '#';
+}
+
+// @description: parses the integer token starting at data[i] in place (no temporary
+// string). Like strtol, parsing stops at the first character that is not a digit,
+// the rest of the token is skipped. Returns the index right after the token.
+static size_t level_parse_int(const char *data, size_t i, size_t size, u32 base, s32 *value) {
+  b8 negative = 0;
+  if (i < size && (data[i] == '-' || data[i] == '+')) {
+    negative = data[i] == '-';
+    i++;
+  }
+  if (base == 16 && i + 1 < size && data[i] == '0' && (data[i + 1] == 'x' || data[i + 1] == 'X')) {
+    i += 2;
+  }
+
+  s32 res = 0;
+  for (; i < size; i++) {
+    char ele = data[i];
+    s32 digit = -1;
+    if (ele >= '0' && ele <= '9') {
+      digit = ele - '0';
+    } else if (base == 16 && ele >= 'a' && ele <= 'f') {
+      digit = ele - 'a' + 10;
+    } else if (base == 16 && ele >= 'A' && ele <= 'F') {
+      digit = ele - 'A' + 10;
+    }
+    if (digit < 0) {
+      break;
+    }
+    res = res*(s32)base + digit;
+  }
+  for (; i < size && !level_is_separator(data[i]); i++) {
+  }
+
+  *value = negative ? -res : res;
+  return i;
+}
+
+// @description: parses the lines in [chunk->begin, chunk->end) into entities.
+// Auto-generated ids continue from chunk->id_base, so a level parsed in chunks
+// gets the same ids as one parsed front to back.
+static void level_parse_chunk(LevelParseChunk *chunk, const char *data, Entity *entities,
+			      const r32 *entity_z) {
+  u32 entity_id_counter = chunk->id_base;
+  Entity level_entity;
+  memset(&level_entity, 0, sizeof(Entity));
+  b8 expect_version = chunk->has_version;
+  u32 sub_prop_flag = 0;
+  chunk->has_version = 0;
+  chunk->entity_count = 0;
+
+  size_t i = chunk->begin;
+  size_t size = chunk->end;
+  LevelScan scan = level_scan_init(data, i, size);
+  while (1) {
+    // @note: this will help ignore ' ', '\t', '\r' characters
+    // allowing us to type those in the file for better readability
+    i = level_scan_skip_blank(&scan, i);
+    b8 end_of_line = i >= size || data[i] == '\n' || data[i] == '#';
+    if (end_of_line) {
+      if (sub_prop_flag > 0) {
+	SDL_assert(chunk->entity_count < chunk->entity_capacity);
+	entities[chunk->entity_count] = level_entity;
+	chunk->entity_count++;
+	entity_id_counter++;
+	sub_prop_flag = 0;
+	memset(&level_entity, 0, sizeof(Entity));
+      }
+      if (i >= size) {
+	break;
+      }
+      // handling comments in level file, they run until the end of the line
+      i = data[i] == '#' ? level_scan_find_newline(&scan, i) : i + 1;
+      continue;
+    }
+
+    s32 value = 0;
+    if (expect_version) {
+      i = level_parse_int(data, i, size, 16, &value);
+      chunk->version = value;
+      chunk->has_version = 1;
+      expect_version = 0;
+      continue;
+    }
+
+    i = level_parse_int(data, i, size, 10, &value);
+    switch (sub_prop_flag) {
+      case 0: {
+	// auto-generated id
+	// @note: will be overwritten when id is explicitly defined
+	level_entity.id = entity_id_counter;
+
+	// type
+	level_entity.type = (ENTITY_TYPE)value;
+
+	// set z index based off of entity type
+	level_entity.raw_position.z = entity_z[level_entity.type];
+      } break;
+      case 1: {
+	// posx
+	level_entity.raw_position.x = value;
+      } break;
+      case 2: {
+	// posy
+	level_entity.raw_position.y = value;
+      } break;
+      case 3: {
+	// sizex
+	level_entity.raw_size.x = value;
+      } break;
+      case 4: {
+	// sizey
+	level_entity.raw_size.y = value;
+      } break;
+      case 5: {
+	// pre-defined id
+	level_entity.id = value;
+      } break;
+      case 6: {
+	// linked id
+	level_entity.link_id = value;
+      } break;
+      default: {
+      } break;
+    }
+    sub_prop_flag++;
+  }
+}
+
+// ==================== PARALLEL PARSE ====================
+// @note: big levels are split at line boundaries into chunks. The pool first counts
+// the entity lines of every chunk, a prefix sum over those counts gives each chunk
+// its slice of the entity table and its first auto id, then the pool parses every
+// chunk straight into its slice. No merge step, the slices are already in file order.
+struct LevelParseJob {
+  const char *data;
+  Entity *entities;
+  const r32 *entity_z;
+  LevelParseChunk *chunks;
+};
+
+static void level_count_job(void *data, u32 job_index) {
+  LevelParseJob *job = (LevelParseJob*)data;
+  LevelParseChunk *chunk = &job->chunks[job_index];
+  chunk->line_count = level_count_lines(job->data, chunk->begin, chunk->end);
+}
+
+static void level_parse_job(void *data, u32 job_index) {
+  LevelParseJob *job = (LevelParseJob*)data;
+  LevelParseChunk *chunk = &job->chunks[job_index];
+  level_parse_chunk(chunk, job->data, job->entities + chunk->entity_offset, job->entity_z);
+}
+
+// a few chunks per thread, so one slow chunk does not hold up the whole load
+static inline u32 level_max_chunks(ThreadPool *pool) {
+  return MIN((pool->worker_count + 1)*4, (u32)LEVEL_PARSE_MAX_CHUNKS);
+}
+
+// @description: splits data into at most max_chunks chunks of at least
+// LEVEL_PARSE_CHUNK_MIN bytes, every chunk but the last ends right after a '\n'
+static u32 level_split_chunks(const char *data, size_t size, LevelParseChunk *chunks, u32 max_chunks) {
+  u32 chunk_count = (u32)MIN((size_t)max_chunks, size/LEVEL_PARSE_CHUNK_MIN);
+  chunk_count = MAX(chunk_count, 1u);
+  size_t target_size = size/chunk_count;
+
+  u32 count = 0;
+  size_t begin = 0;
+  while (begin < size && count < chunk_count) {
+    size_t end = size;
+    if (count + 1 < chunk_count && begin + target_size < size) {
+      end = level_find_newline(data, begin + target_size, size);
+      end = MIN(end + 1, size);
+    }
+    memset(&chunks[count], 0, sizeof(LevelParseChunk));
+    chunks[count].begin = begin;
+    chunks[count].end = end;
+    count++;
+    begin = end;
+  }
+  return count;
+}
+
+// @description: counting pre-pass over a text level. Every line with something
+// other than whitespace before a '#' is an entity, except the version line.
+u32 level_count_entities(const char *data, size_t size, ThreadPool *pool) {
+  u32 line_count = 0;
+  if (pool != NULL && size >= LEVEL_PARALLEL_PARSE_MIN) {
+    LevelParseChunk chunks[LEVEL_PARSE_MAX_CHUNKS];
+    u32 chunk_count = level_split_chunks(data, size, chunks, level_max_chunks(pool));
+    LevelParseJob job = {data, NULL, NULL, chunks};
+    thread_pool_run(pool, level_count_job, &job, chunk_count);
+    for (u32 i = 0; i < chunk_count; i++) {
+      line_count += chunks[i].line_count;
+    }
+  } else {
+    line_count = level_count_lines(data, 0, size);
+  }
+
+  // first line with content is the version number
+  return line_count > 0 ? line_count - 1 : 0;
+}
+
+// @note: entity_capacity comes from level_count_entities, the arena must have room
+// for entity_capacity entities (see arena_reserve).
+// With a pool, levels of LEVEL_PARALLEL_PARSE_MIN bytes or more are parsed in parallel.
+b8 level_parse_text(Level *level, Arena *arena, const char *data, size_t size,
+		    u32 entity_capacity, const r32 *entity_z, ThreadPool *pool) {
+  level->entities = (Entity*)arena_alloc(arena, entity_capacity*sizeof(Entity));
+  level->entity_count = 0;
+
+  LevelParseChunk chunks[LEVEL_PARSE_MAX_CHUNKS];
+  u32 chunk_count = 1;
+  if (pool != NULL && size >= LEVEL_PARALLEL_PARSE_MIN) {
+    chunk_count = level_split_chunks(data, size, chunks, level_max_chunks(pool));
+  }
+
+  LevelParseJob job = {data, level->entities, entity_z, chunks};
+  if (chunk_count == 1) {
+    memset(&chunks[0], 0, sizeof(LevelParseChunk));
+    chunks[0].end = size;
+    chunks[0].has_version = 1;
+    chunks[0].entity_capacity = entity_capacity;
+    level_parse_job(&job, 0);
+  } else {
+    thread_pool_run(pool, level_count_job, &job, chunk_count);
+
+    // @step: prefix sum, the first line with content in the file is the version line
+    u32 entity_offset = 0;
+    b8 version_found = 0;
+    for (u32 i = 0; i < chunk_count; i++) {
+      LevelParseChunk *chunk = &chunks[i];
+      chunk->entity_capacity = chunk->line_count;
+      if (!version_found && chunk->line_count > 0) {
+	chunk->has_version = 1;
+	chunk->entity_capacity--;
+	version_found = 1;
+      }
+      chunk->entity_offset = entity_offset;
+      chunk->id_base = entity_offset;
+      entity_offset += chunk->entity_capacity;
+    }
+    SDL_assert(entity_offset <= entity_capacity);
+
+    thread_pool_run(pool, level_parse_job, &job, chunk_count);
+  }
+
+  b8 has_version = 0;
+  for (u32 i = 0; i < chunk_count; i++) {
+    LevelParseChunk *chunk = &chunks[i];
+    if (chunk->has_version) {
+      level->version = chunk->version;
+      has_version = 1;
+    }
+    // @note: holds as long as every chunk parsed as many entities as it counted
+    SDL_assert(chunk->entity_offset == level->entity_count);
+    level->entity_count += chunk->entity_count;
+  }
+
+  return has_version;
+}
+
+b8 level_load_text(Level *level, Arena *arena, const char *path, const r32 *entity_z,
+		   Vec2 render_scale, Vec2 atom_size, ThreadPool *pool) {
+  size_t fsize = 0;
+  char *level_data = (char*)SDL_LoadFile(path, &fsize);
+  if (level_data == NULL || fsize == 0) {
+    SDL_free(level_data);
+    return 0;
+  }
+
+  u32 entity_capacity = level_count_entities(level_data, fsize, pool);
+  arena_reserve(arena, entity_capacity*sizeof(Entity) + ALIGNMENT);
+  b8 res = level_parse_text(level, arena, level_data, fsize, entity_capacity, entity_z, pool);
+  level_scale_entities(level->entities, level->entity_count, render_scale, atom_size);
+
+  SDL_free(level_data);
+  return res;
+}
+
+// @description: diffs an edited copy of a level against the running one and only
+// copies over the entities that changed. The entity at keep_index (the player)
+// keeps its runtime position. Returns the number of patched entities, their
+// indices in patched (room for entity_count), or -1 without touching level when
+// entities were added, removed or reordered and the edited table has to replace
+// the running one.
+s32 level_patch_entities(Level *level, Level *edited, u32 keep_index, u32 *patched, b8 *types_changed) {
+  *types_changed = 0;
+  if (level->entity_count != edited->entity_count) {
+    return -1;
+  }
+  for (u32 i = 0; i < level->entity_count; i++) {
+    if (level->entities[i].id != edited->entities[i].id) {
+      return -1;
+    }
+  }
+
+  s32 changed = 0;
+  for (u32 i = 0; i < level->entity_count; i++) {
+    Entity *e = &level->entities[i];
+    Entity n = edited->entities[i];
+    b8 same = (
+      e->type == n.type && e->link_id == n.link_id &&
+      memcmp(e->raw_position.data, n.raw_position.data, sizeof(Vec3)) == 0 &&
+      memcmp(e->raw_size.data, n.raw_size.data, sizeof(Vec2)) == 0
+    );
+    if (same) {
+      continue;
+    }
+
+    *types_changed |= e->type != n.type;
+    if (i == keep_index) {
+      n.position = e->position;
+      n.bounds = rect(n.position.v2(), n.size);
+    }
+    *e = n;
+    patched[changed++] = i;
+  }
+
+  return changed;
+}
+
+b8 level_file_is_newer(const char *path, const char *than_path) {
+#if LEVEL_MMAP
+  struct stat a, b;
+  if (stat(path, &a) != 0) {
+    return 0;
+  }
+  if (stat(than_path, &b) != 0) {
+    return 1;
+  }
+  return a.st_mtime >= b.st_mtime;
+#else
+  // @note: no cheap way to compare timestamps, trust the compiled file
+  return 1;
+#endif
+}
+
+// @description: maps a whole file, writable mappings are private (copy-on-write)
+static unsigned char *level_map_file(const char *path, size_t *size, b8 writable) {
+#if LEVEL_MMAP
+  s32 fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    close(fd);
+    return NULL;
+  }
+  *size = (size_t)st.st_size;
+  s32 protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  void *mapping = mmap(NULL, *size, protection, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return NULL;
+  }
+  return (unsigned char*)mapping;
+#else
+  return (unsigned char*)SDL_LoadFile(path, size);
+#endif
+}
+
+static void level_unmap_file(void *base, size_t size) {
+#if LEVEL_MMAP
+  munmap(base, size);
+#else
+  SDL_free(base);
+#endif
+}
+
+// @description: checks that a compiled level blob matches this build's Entity layout
+static b8 level_binary_is_valid(unsigned char *base, size_t size) {
+  LevelHeader0x2 *header = (LevelHeader0x2*)base;
+  return (
+    size >= sizeof(LevelHeader0x2) &&
+    header->magic == LEVEL_BINARY_MAGIC &&
+    header->version == LEVEL_BINARY_VERSION &&
+    header->entity_size == sizeof(Entity) &&
+    header->entity_offset >= sizeof(LevelHeader0x2) &&
+    (u64)header->entity_offset + (u64)header->entity_count*sizeof(Entity) <= size
+  );
+}
+
+static b8 level_binary_needs_rescale(LevelHeader0x2 *header, Vec2 render_scale, Vec2 atom_size) {
+  return (
+    header->render_scale.x != render_scale.x || header->render_scale.y != render_scale.y ||
+    header->atom_size.x != atom_size.x || header->atom_size.y != atom_size.y
+  );
+}
+
+// @description: maps a compiled level and points level->entities into the mapping.
+// Returns 0 (and leaves level untouched) if the file is missing or was compiled
+// against a different Entity layout, so the caller can fall back to the text level.
+b8 level_load_binary(Level *level, const char *path, Vec2 render_scale, Vec2 atom_size) {
+  size_t fsize = 0;
+  // @note: writable so the player write back (and a rescale) is copy-on-write
+  unsigned char *base = level_map_file(path, &fsize, 1);
+  if (base == NULL) {
+    return 0;
+  }
+  if (!level_binary_is_valid(base, fsize)) {
+    level_unmap_file(base, fsize);
+    return 0;
+  }
+
+  LevelHeader0x2 *header = (LevelHeader0x2*)base;
+  level->version = header->version;
+  level->entity_count = header->entity_count;
+  level->entities = (Entity*)(base + header->entity_offset);
+  level->mapped = base;
+  level->mapped_size = fsize;
+
+  if (level_binary_needs_rescale(header, render_scale, atom_size)) {
+    // @note: compiled for another resolution, rescale in place from the raw values
+    level_scale_entities(level->entities, level->entity_count, render_scale, atom_size);
+  }
+
+  return 1;
+}
+
+u32 level_checksum(const void *data, size_t size, u32 checksum) {
+  // FNV-1a
+  const unsigned char *bytes = (const unsigned char*)data;
+  for (size_t i = 0; i < size; i++) {
+    checksum ^= bytes[i];
+    checksum *= 16777619u;
+  }
+  return checksum;
+}
+
+// @description: writes a compiled level to an open file, returns the number of
+// bytes written (0 on failure) and the checksum of those bytes
+static size_t level_write_binary_file(FILE *file, Level *level, Vec2 render_scale, Vec2 atom_size,
+				      u32 *checksum) {
+  LevelHeader0x2 header;
+  memset(&header, 0, sizeof(LevelHeader0x2));
+  header.magic = LEVEL_BINARY_MAGIC;
+  header.version = LEVEL_BINARY_VERSION;
+  header.entity_size = sizeof(Entity);
+  header.entity_count = level->entity_count;
+  header.entity_offset = align_forward(sizeof(LevelHeader0x2), LEVEL_BINARY_ALIGNMENT);
+  header.render_scale = render_scale;
+  header.atom_size = atom_size;
+
+  unsigned char padding[LEVEL_BINARY_ALIGNMENT] = {0};
+  size_t padding_size = header.entity_offset - sizeof(LevelHeader0x2);
+
+  b8 res = (
+    fwrite(&header, sizeof(LevelHeader0x2), 1, file) == 1 &&
+    fwrite(padding, 1, padding_size, file) == padding_size &&
+    fwrite(level->entities, sizeof(Entity), level->entity_count, file) == level->entity_count
+  );
+  if (!res) {
+    return 0;
+  }
+
+  *checksum = level_checksum(&header, sizeof(LevelHeader0x2), LEVEL_CHECKSUM_SEED);
+  *checksum = level_checksum(padding, padding_size, *checksum);
+  *checksum = level_checksum(level->entities, level->entity_count*sizeof(Entity), *checksum);
+
+  return header.entity_offset + level->entity_count*sizeof(Entity);
+}
+
+b8 level_write_binary(Level *level, const char *path, Vec2 render_scale, Vec2 atom_size) {
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    return 0;
+  }
+
+  u32 checksum = 0;
+  b8 res = level_write_binary_file(file, level, render_scale, atom_size, &checksum) > 0;
+
+  fclose(file);
+  return res;
+}
+
+void level_unload(Level *level) {
+  if (level->mapped == NULL) {
+    return;
+  }
+  level_unmap_file(level->mapped, level->mapped_size);
+  level->mapped = NULL;
+  level->mapped_size = 0;
+}
+
+// ==================== LEVEL PACK ====================
+b8 level_pack_open(LevelPack *pack, const char *path) {
+  memset(pack, 0, sizeof(LevelPack));
+  size_t size = 0;
+  unsigned char *base = level_map_file(path, &size, 0);
+  if (base == NULL) {
+    return 0;
+  }
+
+  LevelPackHeader *header = (LevelPackHeader*)base;
+  b8 valid = (
+    size >= sizeof(LevelPackHeader) &&
+    header->magic == LEVEL_PACK_MAGIC &&
+    header->version == LEVEL_PACK_VERSION &&
+    (u64)header->entry_offset + (u64)header->level_count*sizeof(LevelPackEntry) <= size
+  );
+  if (!valid) {
+    level_unmap_file(base, size);
+    return 0;
+  }
+
+  pack->base = base;
+  pack->size = size;
+  pack->level_count = header->level_count;
+  pack->entries = (LevelPackEntry*)(base + header->entry_offset);
+  return 1;
+}
+
+void level_pack_close(LevelPack *pack) {
+  if (pack->base) {
+    level_unmap_file(pack->base, pack->size);
+  }
+  memset(pack, 0, sizeof(LevelPack));
+}
+
+// @description: index of the level called name, -1 if the pack does not have it
+s32 level_pack_find(LevelPack *pack, const char *name) {
+  for (u32 i = 0; i < pack->level_count; i++) {
+    if (strncmp(pack->entries[i].name, name, sizeof(pack->entries[i].name)) == 0) {
+      return (s32)i;
+    }
+  }
+  return -1;
+}
+
+// @description: returns the entry's level blob if it is in bounds, intact and valid
+static LevelHeader0x2 *level_pack_entry_level(LevelPack *pack, u32 index) {
+  if (index >= pack->level_count) {
+    return NULL;
+  }
+  LevelPackEntry *entry = &pack->entries[index];
+  if (entry->offset > pack->size || entry->size > pack->size - entry->offset) {
+    return NULL;
+  }
+  unsigned char *blob = pack->base + entry->offset;
+  if (!level_binary_is_valid(blob, entry->size)) {
+    return NULL;
+  }
+  return (LevelHeader0x2*)blob;
+}
+
+u32 level_pack_entity_count(LevelPack *pack, u32 index) {
+  LevelHeader0x2 *header = level_pack_entry_level(pack, index);
+  return header ? header->entity_count : 0;
+}
+
+// @description: loads level `index` out of the pack mapping. The entity table is
+// copied into the arena (no parse, no file io) so the pack mapping stays pristine
+// for the next load of the same level.
+b8 level_pack_load(LevelPack *pack, u32 index, Level *level, Arena *arena,
+		   Vec2 render_scale, Vec2 atom_size) {
+  LevelHeader0x2 *header = level_pack_entry_level(pack, index);
+  if (header == NULL) {
+    return 0;
+  }
+  LevelPackEntry *entry = &pack->entries[index];
+  if (level_checksum(header, entry->size, LEVEL_CHECKSUM_SEED) != entry->checksum) {
+    return 0;
+  }
+
+  size_t table_size = header->entity_count*sizeof(Entity);
+  level->version = header->version;
+  level->entity_count = header->entity_count;
+  level->entities = (Entity*)arena_alloc(arena, table_size);
+  memcpy(level->entities, (unsigned char*)header + header->entity_offset, table_size);
+
+  if (level_binary_needs_rescale(header, render_scale, atom_size)) {
+    level_scale_entities(level->entities, level->entity_count, render_scale, atom_size);
+  }
+
+  return 1;
+}
+
+b8 level_pack_writer_begin(LevelPackWriter *writer, const char *path, u32 level_count) {
+  memset(writer, 0, sizeof(LevelPackWriter));
+  writer->file = fopen(path, "wb");
+  if (writer->file == NULL) {
+    return 0;
+  }
+  writer->level_count = level_count;
+  writer->entries = (LevelPackEntry*)calloc(level_count, sizeof(LevelPackEntry));
+  if (writer->entries == NULL) {
+    fclose(writer->file);
+    writer->file = NULL;
+    return 0;
+  }
+
+  // @note: header and entry table are written last, once the offsets are known
+  writer->offset = align_forward(
+    sizeof(LevelPackHeader) + level_count*sizeof(LevelPackEntry), LEVEL_BINARY_ALIGNMENT
+  );
+  return fseek(writer->file, writer->offset, SEEK_SET) == 0;
+}
+
+b8 level_pack_writer_add(LevelPackWriter *writer, const char *name, Level *level,
+			 Vec2 render_scale, Vec2 atom_size) {
+  SDL_assert(writer->entry_count < writer->level_count);
+  LevelPackEntry *entry = &writer->entries[writer->entry_count];
+  strncpy(entry->name, name, sizeof(entry->name) - 1);
+  entry->offset = writer->offset;
+  entry->size = level_write_binary_file(writer->file, level, render_scale, atom_size, &entry->checksum);
+  if (entry->size == 0) {
+    return 0;
+  }
+  writer->entry_count++;
+
+  // keep every level blob aligned
+  size_t next_offset = align_forward(writer->offset + entry->size, LEVEL_BINARY_ALIGNMENT);
+  unsigned char padding[LEVEL_BINARY_ALIGNMENT] = {0};
+  size_t padding_size = next_offset - (writer->offset + entry->size);
+  writer->offset = next_offset;
+  return fwrite(padding, 1, padding_size, writer->file) == padding_size;
+}
+
+b8 level_pack_writer_end(LevelPackWriter *writer) {
+  LevelPackHeader header;
+  memset(&header, 0, sizeof(LevelPackHeader));
+  header.magic = LEVEL_PACK_MAGIC;
+  header.version = LEVEL_PACK_VERSION;
+  header.level_count = writer->entry_count;
+  header.entry_offset = sizeof(LevelPackHeader);
+
+  b8 res = (
+    fseek(writer->file, 0, SEEK_SET) == 0 &&
+    fwrite(&header, sizeof(LevelPackHeader), 1, writer->file) == 1 &&
+    fwrite(writer->entries, sizeof(LevelPackEntry), writer->entry_count, writer->file) == writer->entry_count
+  );
+
+  fclose(writer->file);
+  free(writer->entries);
+  memset(writer, 0, sizeof(LevelPackWriter));
+  return res;
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <stdio.h>
+#include "../core.h"
+#include "../math.h"
+#include "../memory/arena.h"
+#include "../threads/thread_pool.h"
+
+enum ENTITY_TYPE {
+    PLAYER = 0,
+    OBSTACLE = 1,
+    GOAL = 2,
+    INVERT_GRAVITY = 3,
+    TELEPORT = 4,
+    DEBUG_LINE = 5,
+    TEXT = 6,
+    ENTITY_TYPE_COUNT,
+};
+
+struct Entity {
+    // @todo: set a base resolution and design the game elements around it
+    s32 id;
+    ENTITY_TYPE type;
+    // raw property values in pixels
+    Vec3 raw_position;
+    Vec2 raw_size;
+    // these properties will have scaling applied
+    Vec3 position;
+    Vec2 size;
+    Rect bounds;
+    // teleporter
+    u32 link_id;    // which portal this is linked to
+};
+
+// @note: runtime level. The entity table either lives in the level arena
+// (text levels) or is mapped straight out of a compiled level file.
+struct Level0x2 {
+    u32 version = 0x2;
+    u32 entity_count;
+    Entity *entities;
+    // compiled level backing memory, NULL when entities live in the level arena
+    void *mapped;
+    size_t mapped_size;
+};
+
+typedef struct Level0x2 Level;
+
+// ==================== COMPILED LEVELS ====================
+// @note: a compiled level is a header followed by the Entity table, already
+// scaled for header.render_scale/header.atom_size. Loading it is a mmap,
+// the table is used in place (MAP_PRIVATE, so hot reload patches stay in memory).
+#define LEVEL_BINARY_MAGIC 0x564c5053 // "SPLV"
+#define LEVEL_BINARY_VERSION 0x2
+#define LEVEL_BINARY_ALIGNMENT 64
+
+struct LevelHeader0x2 {
+    u32 magic;
+    u32 version;
+    u32 entity_size;	// sizeof(Entity) the table was compiled with
+    u32 entity_count;
+    u32 entity_offset;	// byte offset of the entity table from the start of the file
+    u32 reserved;
+    Vec2 render_scale;
+    Vec2 atom_size;
+};
+
+// ==================== LEVEL PACK ====================
+// @note: a pack is one file holding many compiled levels:
+// [LevelPackHeader][LevelPackEntry * level_count][level blob]...
+// Each blob is a compiled level (LevelHeader0x2 + Entity table) with its own checksum.
+// The pack is mapped once, levels are loaded by index out of that mapping.
+#define LEVEL_PACK_MAGIC 0x504c5053 // "SPLP"
+#define LEVEL_PACK_VERSION 0x1
+#define LEVEL_CHECKSUM_SEED 2166136261u
+
+struct LevelPackHeader {
+    u32 magic;
+    u32 version;
+    u32 level_count;
+    u32 entry_offset;	// byte offset of the entry table
+};
+
+struct LevelPackEntry {
+    char name[48];	// level name without extension, e.g. "level0"
+    u64 offset;		// byte offset of the level blob from the start of the pack
+    u32 size;		// level blob size in bytes
+    u32 checksum;	// level_checksum of the level blob
+};
+
+struct LevelPack {
+    unsigned char *base;
+    size_t size;
+    u32 level_count;
+    LevelPackEntry *entries;
+};
+
+struct LevelPackWriter {
+    FILE *file;
+    size_t offset;
+    u32 level_count;
+    u32 entry_count;
+    LevelPackEntry *entries;
+};
+
+// ==================== EMBEDDED LEVELS ====================
+// @note: LEVELS_EMBEDDED builds compile the levels into the binary, as constexpr
+// Entity tables generated by `level_compiler -embed` (see build.sh)
+struct EmbeddedLevel {
+    const char *name;
+    const Entity *entities;
+    u32 entity_count;
+};
+
+// ==================== TEXT LEVELS ====================
+// @note: text levels of at least LEVEL_PARALLEL_PARSE_MIN bytes are split at line
+// boundaries and parsed on a thread pool, see level_parse_text
+#define LEVEL_PARALLEL_PARSE_MIN MB(1)
+#define LEVEL_PARSE_CHUNK_MIN KB(256)
+#define LEVEL_PARSE_MAX_CHUNKS 64
+
+struct LevelParseChunk {
+    size_t begin;		// byte range [begin, end) of the text, starts at a line
+    size_t end;
+    u32 line_count;		// lines with content, from the counting pass
+    u32 entity_offset;	// first entity of the chunk's slice in the entity table
+    u32 entity_capacity;
+    u32 id_base;		// auto id of the first entity in the chunk
+    u32 entity_count;
+    u32 version;
+    b8 has_version;		// in: the chunk holds the version line, out: the version was parsed
+};
+
+void level_default_entity_z(r32 *entity_z);
+void level_scale_entities(Entity *entities, u32 count, Vec2 render_scale, Vec2 atom_size);
+u32 level_count_entities(const char *data, size_t size, ThreadPool *pool);
+b8 level_parse_text(Level *level, Arena *arena, const char *data, size_t size,
+		    u32 entity_capacity, const r32 *entity_z, ThreadPool *pool);
+b8 level_load_text(Level *level, Arena *arena, const char *path, const r32 *entity_z,
+		   Vec2 render_scale, Vec2 atom_size, ThreadPool *pool);
+b8 level_load_binary(Level *level, const char *path, Vec2 render_scale, Vec2 atom_size);
+b8 level_write_binary(Level *level, const char *path, Vec2 render_scale, Vec2 atom_size);
+s32 level_patch_entities(Level *level, Level *edited, u32 keep_index, u32 *patched, b8 *types_changed);
+b8 level_file_is_newer(const char *path, const char *than_path);
+void level_unload(Level *level);
+u32 level_checksum(const void *data, size_t size, u32 checksum);
+
+b8 level_pack_open(LevelPack *pack, const char *path);
+void level_pack_close(LevelPack *pack);
+s32 level_pack_find(LevelPack *pack, const char *name);
+u32 level_pack_entity_count(LevelPack *pack, u32 index);
+b8 level_pack_load(LevelPack *pack, u32 index, Level *level, Arena *arena,
+		   Vec2 render_scale, Vec2 atom_size);
+b8 level_pack_writer_begin(LevelPackWriter *writer, const char *path, u32 level_count);
+b8 level_pack_writer_add(LevelPackWriter *writer, const char *name, Level *level,
+			 Vec2 render_scale, Vec2 atom_size);
+b8 level_pack_writer_end(LevelPackWriter *writer);
@@ -0,0 +1,77 @@
+#include <string.h>
+#include "level_watch.h"
+
+#if defined(__linux__)
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+b8 level_watch_init(LevelWatcher *watcher, const char *dir) {
+  watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  watcher->watch = -1;
+  if (watcher->fd < 0) {
+    return 0;
+  }
+  // @note: editors either write the file in place or write a temp file and
+  // rename it over the level, so listen for both
+  watcher->watch = inotify_add_watch(watcher->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (watcher->watch < 0) {
+    level_watch_close(watcher);
+    return 0;
+  }
+  return 1;
+}
+
+// @description: drains pending events, bit i of the result is set if file_names[i]
+// was saved since the last poll
+u32 level_watch_poll(LevelWatcher *watcher, const char **file_names, u32 file_count) {
+  if (watcher->fd < 0) {
+    return 0;
+  }
+
+  u32 changed = 0;
+  char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  while (1) {
+    ssize_t size = read(watcher->fd, buffer, sizeof(buffer));
+    if (size <= 0) {
+      // EAGAIN: nothing left to read
+      break;
+    }
+    for (char *ptr = buffer; ptr < buffer + size;) {
+      struct inotify_event *event = (struct inotify_event*)ptr;
+      for (u32 i = 0; event->len > 0 && i < file_count && i < 32; i++) {
+	if (file_names[i] != NULL && strcmp(event->name, file_names[i]) == 0) {
+	  changed |= 1u << i;
+	}
+      }
+      ptr += sizeof(struct inotify_event) + event->len;
+    }
+  }
+
+  return changed;
+}
+
+void level_watch_close(LevelWatcher *watcher) {
+  if (watcher->fd >= 0) {
+    close(watcher->fd);
+  }
+  watcher->fd = -1;
+  watcher->watch = -1;
+}
+
+#else
+
+b8 level_watch_init(LevelWatcher *watcher, const char *dir) {
+  watcher->fd = -1;
+  watcher->watch = -1;
+  return 0;
+}
+
+u32 level_watch_poll(LevelWatcher *watcher, const char **file_names, u32 file_count) {
+  return 0;
+}
+
+void level_watch_close(LevelWatcher *watcher) {
+}
+
+#endif
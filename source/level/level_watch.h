@@ -0,0 +1,14 @@
+#pragma once
+
+#include "../core.h"
+
+// @note: watches a level directory for saved files (inotify on linux).
+// On other platforms the watcher never reports a change, use F5 there.
+struct LevelWatcher {
+    s32 fd;
+    s32 watch;
+};
+
+b8 level_watch_init(LevelWatcher *watcher, const char *dir);
+u32 level_watch_poll(LevelWatcher *watcher, const char **file_names, u32 file_count);
+void level_watch_close(LevelWatcher *watcher);
@@ -16,6 +16,21 @@
 #include "memory/arena.h"
 #include "math.h"
 #include "array/array.cpp"
+#include "threads/thread_pool.cpp"
+#include "level/level.cpp"
+#include "level/level_watch.cpp"
+#include "entity/entity_store.cpp"
+#include "physics/colliders.cpp"
+#include "physics/collision_grid.cpp"
+#include "physics/occupancy.cpp"
+#include "physics/contact_batch.cpp"
+#include "physics/swept.cpp"
+#include "physics/level_query.cpp"
+#include "sim/sim.cpp"
+#include "sim/replay.cpp"
+#if defined(LEVELS_EMBEDDED)
+#include "embedded_levels.h"
+#endif
 #include "renderer/renderer.h"
 #include "renderer/renderer.cpp"
 //-----------------------------
@@ -82,51 +97,10 @@ enum PMoveState {
   FALL_MOVE     = 2,
 };
 
-enum PlatformKey {
-  PK_NIL = 0,
-  PK_W = 1,
-  PK_A = 2,
-  PK_S = 3,
-  PK_D = 4,
-};
-
-struct Rect {
-  Vec2 lb;
-  Vec2 rt;
-};
-
 #define PLAYER_Z -1.0f
 #define OBSTACLE_Z -2.0f
 #define GOAL_Z -3.0f
 
-enum ENTITY_TYPE {
-    PLAYER = 0,
-    OBSTACLE = 1,
-    GOAL = 2,
-    INVERT_GRAVITY = 3,
-    TELEPORT = 4,
-    DEBUG_LINE = 5,
-    TEXT = 6,
-};
-
-static r32 entity_z[10];
-static Vec3 entity_colors[10];
-
-struct Entity {
-    // @todo: set a base resolution and design the game elements around it
-    s32 id;
-    ENTITY_TYPE type;
-    // raw property values in pixels
-    Vec3 raw_position;
-    Vec2 raw_size;
-    // these properties will have scaling applied
-    Vec3 position;
-    Vec2 size;
-    Rect bounds;
-    // teleporter
-    u32 link_id;    // which portal this is linked to
-};
-
 struct EntityInfo {
     u32 id;
     u32 index; // index into Level->Entities array
@@ -139,43 +113,28 @@ struct EntityInfoArr {
 };
 
 #define ARR_SIZE(arr) (sizeof(arr)/sizeof((arr)[0]))
-#define LEVEL_MAX_ENTITIES 100
 static const char* base_level_path = "./levels/";
+// @note: output of build/level_compiler, see build.sh
+static const char* compiled_level_path = "./build/levels/";
+static const char* level_pack_path = "./build/levels.pack";
 static const char *level_names[] = {
-    "level0.txt",
-    "level1.txt",
-    "level2.txt",
-    "level3.txt",
-    "level4.txt",
-    "level5.txt",
-    "level6.txt",
-    "level7.txt",
-    "level8.txt",
-    "level9.txt",
-    "level10.txt",
-    "hello_portal.txt",
-    "portal_wind_up_no_jump.txt",
-    "portal_thereNback.txt",
+    "level0",
+    "level1",
+    "level2",
+    "level3",
+    "level4",
+    "level5",
+    "level6",
+    "level7",
+    "level8",
+    "level9",
+    "level10",
+    "hello_portal",
+    "portal_wind_up_no_jump",
+    "portal_thereNback",
 };
 const int level_count = ARR_SIZE(level_names);
 
-struct Level0x1 {
-    u32 version = 0x1;
-    u32 entity_count;
-    Entity *entities;
-};
-
-typedef struct Level0x1 Level;
-
-
-struct Controller {
-  b8 move_up;
-  b8 move_down;
-  b8 move_left;
-  b8 move_right;
-  b8 jump;
-  b8 toggle_gravity;
-};
 
 struct FrameTimer {
   u64 tCurr;
@@ -227,211 +186,201 @@ struct GameState {
     Rect camera_bounds;
     
     // level
-    // 0: in progress, 1: complete
-    b8 level_state;
     s32 level_index;
-    Str256 level_path_base;
     Str256 level_name;
+    // a level played from a file instead of level_names[level_index], empty for the
+    // shipped levels. level_name is then its file name without directory and extension
+    Str256 level_file;
     Level game_level;
+    // runtime copy of game_level's entities, the gameplay loops read and write this
+    EntityStore entity_store;
     EntityInfo player;
-    EntityInfo goal;
     EntityInfoArr obstacles;
+    // obstacles merged into collision and render rects
+    ColliderSet colliders;
+    // broad phase for the player vs obstacles pass
+    CollisionGrid collision_grid;
+    // solid atoms of the level, for O(1) "is this atom solid" queries
+    OccupancyMap occupancy;
+    // raycasts, boxcasts and overlap queries against the colliders
+    LevelQuery level_query;
     // interaction
     IVec2 mouse_position;
     b8 mouse_down;
     b8 mouse_up;
-    // gameplay
-    b8 flip_gravity;
-    b8 inside_teleporter;
-    b8 teleporting;
-    r32 gravity_diry;
-    r32 effective_force;
-    Vec2 player_velocity;
-    r64 gravity_flip_timer;
+    // gameplay, advanced in fixed ticks by sim_step
+    SimState sim;
+    SimTuning tuning;
+    // player and camera as of the tick before the last one, the frame is drawn between the two
+    Vec2 previous_player_position;
+    Vec3 previous_cam_pos;
     // rendering
     GLRenderer renderer;
+    r32 entity_z[ENTITY_TYPE_COUNT];
+    Vec3 entity_colors[ENTITY_TYPE_COUNT];
 };
 
-Rect rect(Vec2 position, Vec2 size) {
-  Rect r = {0};
-
-  r.lb.x = position.x;
-  r.lb.y = position.y;
-
-  r.rt.x = position.x + size.x;
-  r.rt.y = position.y + size.y;
-
-  return r;
-}
-
-b8 aabb_collision_rect(Rect a, Rect b) {
-    r32 a_left = a.lb.x;
-    r32 a_bottom = a.lb.y;
-    r32 a_right = a.rt.x;
-    r32 a_top = a.rt.y;
-
-    r32 b_left = b.lb.x;
-    r32 b_bottom = b.lb.y;
-    r32 b_right = b.rt.x;
-    r32 b_top = b.rt.y;
+// @note: level storage is double buffered. The level being played lives in
+// arenas[active], the next level is parsed into the other arena on a loader
+// thread while the current one is played.
+struct LevelLoader {
+    Arena arenas[2];
+    u32 active;
+    // hot reload, edited levels are parsed here and diffed against the active level
+    Arena reload_arena;
+    // collision grid and occupancy map of the level being played, rebuilt whenever the level is bound
+    Arena collision_arena;
+    Str256 level_path_base;
+    Str256 compiled_level_path_base;
+    // shipped levels, mapped once. Loose files win when they are newer (development)
+    LevelPack pack;
+    // parses big text levels in parallel, shared by the main and loader threads
+    ThreadPool pool;
+    Vec2 render_scale;
+    Vec2 atom_size;
+    r32 entity_z[ENTITY_TYPE_COUNT];
+    // prefetch
+    b8 prefetch_disabled;	// every level is loaded when it is set up, no loader thread
+    SDL_Thread *thread;
+    s32 prefetch_index;	// -1 when nothing is prefetched
+    b8 prefetch_loaded;
+    Str256 prefetch_name;
+    Arena *prefetch_arena;
+    Level prefetch_level;
+};
 
-    return !(
-	    a_left > b_right || a_right < b_left ||
-	    a_top < b_bottom || a_bottom > b_top);
+// @description: grows the (empty) level arena to fit everything a level with
+// entity_count entities allocates in load_level and bind_level_entities
+void level_arena_reserve(Arena *level_arena, u32 entity_count) {
+    u32 store_capacity = entity_count + ENTITY_SPAWN_RESERVE;
+    size_t size = entity_count*sizeof(Entity) + store_capacity*sizeof(EntityInfo) + 2*ALIGNMENT;
+    size += entity_store_size(store_capacity);
+    arena_reserve(level_arena, size);
 }
 
-Entity get_entity_by_id(GameState state, u32 id) {
-    Entity res;
-    res.id = -1;
-
-    for (int i = 0; i < state.game_level.entity_count; i++) {
-	Entity e = state.game_level.entities[i];
-	if (e.id == id) {
-	    res = e;
-	    break;
-	}
+// @description: parses the text level at path into level_arena
+b8 load_level_text(LevelLoader *loader, Level *level, Arena *level_arena, const char *path) {
+    size_t fsize = 0;
+    char* level_data = (char*)SDL_LoadFile(path, &fsize);
+    if (level_data == NULL || fsize == 0) {
+	SDL_free(level_data);
+	return 0;
     }
+#if defined(LEVELS_EMBEDDED)
+    // no parse pool in embedded builds
+    ThreadPool *pool = NULL;
+#else
+    ThreadPool *pool = &loader->pool;
+#endif
 
-    // We should always have the entity we are trying to look for
-    SDL_assert(res.id != -1);
+    // @step: counting pre-pass, so the arena is sized from the real entity count
+    u32 entity_capacity = level_count_entities(level_data, fsize, pool);
+    level_arena_reserve(level_arena, entity_capacity);
+    b8 loaded = level_parse_text(level, level_arena, level_data, fsize,
+				 entity_capacity, loader->entity_z, pool);
+    level_scale_entities(level->entities, level->entity_count,
+			 loader->render_scale, loader->atom_size);
 
-    return res;
+    SDL_free(level_data);
+    return loaded;
 }
 
-void load_level(GameState *state, Arena *level_arena, Str256 level_path) {
+// @note: touches nothing but level and level_arena, so it is safe to run on the loader thread
+b8 load_level(LevelLoader *loader, Level *level, Arena *level_arena, Str256 level_name) {
     // @step: initialise level state variables
     arena_clear(level_arena);
-    memset(&state->game_level, 0, sizeof(Level));
-    state->level_state = 0;
-
-    size_t fsize;
-    char* level_data = (char*)SDL_LoadFile(level_path.buffer, &fsize);
-    SDL_assert(fsize != 0);
-
-    u32 feature_flag = 0;
-    u32 entity_flag = 0;
-    u32 entity_id_counter = 0;
-    Str256 level_property;
-    str_init(&level_property);
-
-    Entity level_entity;
-    b8 is_comment = 0;
-    u32 prop_flag = 0;
-    u32 sub_prop_flag = 0;
-
-
-    // @note: just decide beforehand, that a level should allow (AT MAX) 100 elements
-    // this should be way overkill
-    state->game_level.entities = (Entity*)arena_alloc(level_arena, LEVEL_MAX_ENTITIES*sizeof(Entity));
-
-    for (int i = 0; i < fsize; i++) {
-	char ele = level_data[i];
-
-	// handling comments in level file
-	if (ele == '#') {
-	    is_comment = true;
+    *level = Level{};
+
+#if defined(LEVELS_EMBEDDED)
+    // @note: embedded build, the tables are compiled in and already scaled. Gameplay
+    // only writes to the entity store, so the table is used in place (read-only memory)
+    // and only copied when it has to be rescaled.
+    for (u32 i = 0; i < ARR_SIZE(embedded_levels); i++) {
+	EmbeddedLevel embedded = embedded_levels[i];
+	if (strcmp(embedded.name, level_name.buffer) != 0) {
 	    continue;
 	}
-	if (ele == '\n' && is_comment) {
-	    is_comment = false;
-	    continue;
+	level_arena_reserve(level_arena, embedded.entity_count);
+	level->version = LEVEL_BINARY_VERSION;
+	level->entity_count = embedded.entity_count;
+	level->entities = (Entity*)embedded.entities;
+	if (embedded_levels_atom_size.x != loader->atom_size.x ||
+	    embedded_levels_atom_size.y != loader->atom_size.y ||
+	    embedded_levels_render_scale.x != loader->render_scale.x ||
+	    embedded_levels_render_scale.y != loader->render_scale.y) {
+	    level->entities = (Entity*)arena_alloc(level_arena, embedded.entity_count*sizeof(Entity));
+	    memcpy(level->entities, embedded.entities, embedded.entity_count*sizeof(Entity));
+	    level_scale_entities(level->entities, level->entity_count,
+				 loader->render_scale, loader->atom_size);
 	}
-	if (is_comment) {
-	    continue;
+	return 1;
+    }
+    return 0;
+#endif
+
+    Str256 text_path = loader->level_path_base;
+    str_push256(&text_path, level_name);
+    str_push256(&text_path, str256(".txt"));
+
+    Str256 compiled_path = loader->compiled_level_path_base;
+    str_push256(&compiled_path, level_name);
+    str_push256(&compiled_path, str256(".lvl"));
+
+    // @step: prefer the level pack, then the compiled level (one mmap, no parse,
+    // already scaled) and fall back to parsing the text level when both are missing or stale
+    b8 loaded = 0;
+    s32 pack_index = level_pack_find(&loader->pack, level_name.buffer);
+    if (pack_index >= 0 && level_file_is_newer(level_pack_path, text_path.buffer)) {
+	level_arena_reserve(level_arena, level_pack_entity_count(&loader->pack, pack_index));
+	if (level_pack_load(&loader->pack, pack_index, level, level_arena,
+			    loader->render_scale, loader->atom_size)) {
+	    return 1;
 	}
+	arena_clear(level_arena);
+    }
+    if (level_file_is_newer(compiled_path.buffer, text_path.buffer)) {
+	loaded = level_load_binary(level, compiled_path.buffer,
+				   loader->render_scale, loader->atom_size);
+    }
+    if (loaded) {
+	level_arena_reserve(level_arena, level->entity_count);
+    } else {
+	loaded = load_level_text(loader, level, level_arena, text_path.buffer);
+    }
 
-	if (ele == '\t' || ele == ' ' || ele == '\n') {
-	    if (level_property.size == 0) {
-		// @note: this will help ignore ' ', '\t', '\n' characters
-		// allowing us to type those in the file for better readability
-		continue;
-	    }
-	    switch (prop_flag) {
-		case 0: {
-		    state->game_level.version = strtol(level_property.buffer, NULL, 16);
-		    str_clear(&level_property);
-		    prop_flag++;
-		    continue;
-		} break;
-		case 1: {
-		    switch (sub_prop_flag) {
-			case 0: {
-			    // auto-generated id
-			    // @note: will be overwritten when id is explicitly defined
-			    level_entity.id = entity_id_counter;
-
-			    // type
-			    level_entity.type = (ENTITY_TYPE)strtol(level_property.buffer, NULL, 10);
-
-	  	            // set z index based off of entity type
-			    level_entity.raw_position.z = entity_z[level_entity.type];
-	  	        } break;
-	  	        case 1: {
-	  	            // posx
-	  	            level_entity.raw_position.x = strtol(level_property.buffer, NULL, 10);
-	  	        } break;
-	  	        case 2: {
-	  	            // posy
-	  	            level_entity.raw_position.y = strtol(level_property.buffer, NULL, 10);
-	  	        } break;
-	  	        case 3: {
-	  	            // sizex
-	  	            level_entity.raw_size.x = strtol(level_property.buffer, NULL, 10);
-	  	        } break;
-	  	        case 4: {
-	  	            // sizey
-	  	            level_entity.raw_size.y = strtol(level_property.buffer, NULL, 10);
-	  	        } break;
-			case 5: {
-			    // pre-defined id
-			    level_entity.id = strtol(level_property.buffer, NULL, 10);
-			} break;
-			case 6: {
-			    // linked id
-			    level_entity.link_id = strtol(level_property.buffer, NULL, 10);
-			}
-	  	        default: {
-	  	        } break;
-	  	    }
-	  	    str_clear(&level_property);
-	  	    sub_prop_flag++;
-
-	  	    if (ele == '\n') {
-			state->game_level.entities[state->game_level.entity_count] = level_entity;
-			state->game_level.entity_count++;
-	  	        entity_id_counter++;
-	  	        sub_prop_flag = 0;
-	  	        memset(&level_entity, 0, sizeof(Entity));
-	  	    }
-		    SDL_assert(state->game_level.entity_count <= LEVEL_MAX_ENTITIES);
-	  	    continue;
-	  	}
-		default: {
-		} break;
-	    }
+    return loaded;
+}
+
+// @description: loads the level file at path (a compiled .lvl, text otherwise) instead
+// of a level from the level directory, for levels that are not shipped with the game
+b8 load_level_file(LevelLoader *loader, Level *level, Arena *level_arena, const char *path) {
+    arena_clear(level_arena);
+    *level = Level{};
+
+    size_t length = strlen(path);
+    if (length > 4 && strcmp(path + length - 4, ".lvl") == 0) {
+	if (!level_load_binary(level, path, loader->render_scale, loader->atom_size)) {
+	    return 0;
 	}
-	str_pushc(&level_property, ele);
+	level_arena_reserve(level_arena, level->entity_count);
+	return 1;
     }
+    return load_level_text(loader, level, level_arena, path);
+}
 
-    // @function: load_entities_info and scale
-    state->obstacles.buffer = (EntityInfo*)arena_alloc(level_arena, state->game_level.entity_count*sizeof(EntityInfo));
+// @description: rebuilds the EntityInfo indices for state->entity_store in place
+void index_level_entities(GameState *state) {
+    EntityStore *store = &state->entity_store;
     state->obstacles.size = 0;
-    state->obstacles.capacity = state->game_level.entity_count;
-    for (u32 i = 0; i < state->game_level.entity_count; i++) {
-	Entity e = state->game_level.entities[i];
-	e.position = Vec3{
-	    e.raw_position.x * state->render_scale.x,
-	    e.raw_position.y * state->render_scale.y,
-	    e.raw_position.z
-	};
-	e.size = e.raw_size * state->atom_size;
-	e.bounds = rect(e.position.v2(), e.size);
-
+    for (u32 i = 0; i < store->count; i++) {
+	if (!entity_is_alive(store, i)) {
+	    continue;
+	}
 	EntityInfo o;
-	o.id = e.id;
+	o.id = entity_id(store, i);
 	o.index = i;
 
-	switch (e.type) {
+	switch (entity_type(store, i)) {
 	    case PLAYER: {
 		state->player = o;
 	    } break;
@@ -440,53 +389,360 @@ void load_level(GameState *state, Arena *level_arena, Str256 level_path) {
 		state->obstacles.buffer[state->obstacles.size] = o;
 		state->obstacles.size++;
 	    } break;
-	    case GOAL: {
-		state->goal = o;
-	    } break;
 	    default: {
 	    } break;
 	}
-	state->game_level.entities[i] = e;
     }
+}
 
-    SDL_free(level_data);
+// @description: rebuilds the colliders, the collision grid, the occupancy map and the
+// level query from the entity store
+void build_level_collision(GameState *state, Arena *collision_arena) {
+    EntityStore *store = &state->entity_store;
+    arena_clear(collision_arena);
+    arena_reserve(collision_arena, collider_set_size(store) +
+				   collision_grid_size(store, state->atom_size) +
+				   occupancy_size(store, state->atom_size) +
+				   level_query_size(store));
+    collider_set_build(&state->colliders, collision_arena, store);
+    collision_grid_build(&state->collision_grid, collision_arena, &state->colliders, state->atom_size);
+    occupancy_build(&state->occupancy, collision_arena, store, state->atom_size);
+    level_query_build(&state->level_query, collision_arena, &state->colliders);
 }
 
-void setup_level(GameState *state, GLRenderer *renderer, Arena *arena) 
-{
-    Str256 _level_name = str256(level_names[state->level_index]);
-    Str256 level_path = state->level_path_base;
-    str_push256(&level_path, _level_name);
+// @description: builds the entity store and the EntityInfo indices for state->game_level,
+// allocated from the arena the level was loaded into, and the collision data
+void bind_level_entities(GameState *state, Arena *level_arena, Arena *collision_arena) {
+    u32 store_capacity = state->game_level.entity_count + ENTITY_SPAWN_RESERVE;
+    entity_store_init(&state->entity_store, level_arena, store_capacity);
+    entity_store_load(&state->entity_store, state->game_level.entities, state->game_level.entity_count);
+    state->obstacles.buffer = (EntityInfo*)arena_alloc(level_arena, store_capacity*sizeof(EntityInfo));
+    state->obstacles.capacity = store_capacity;
+    index_level_entities(state);
+    build_level_collision(state, collision_arena);
+}
+
+// @description: adds an entity to the running level. Existing slots and the
+// player/obstacles indices into them stay valid.
+EntityHandle spawn_level_entity(GameState *state, Entity e) {
+    EntityHandle handle = entity_spawn(&state->entity_store, e);
+    if (handle.index == ENTITY_INVALID_INDEX) {
+	return handle;
+    }
+    if (e.type == OBSTACLE || e.type == INVERT_GRAVITY) {
+	// @note: obstacles are kept in slot order, collision resolution depends on it
+	EntityInfoArr *obstacles = &state->obstacles;
+	u32 insert_at = obstacles->size;
+	while (insert_at > 0 && obstacles->buffer[insert_at - 1].index > handle.index) {
+	    insert_at--;
+	}
+	memmove(&obstacles->buffer[insert_at + 1], &obstacles->buffer[insert_at],
+		(obstacles->size - insert_at)*sizeof(EntityInfo));
+	obstacles->buffer[insert_at] = EntityInfo{(u32)e.id, handle.index};
+	obstacles->size++;
+	u32 collider = collider_set_add(&state->colliders, &state->entity_store, handle.index);
+	if (collider != ENTITY_INVALID_INDEX) {
+	    collision_grid_add(&state->collision_grid, collider);
+	}
+    }
+    return handle;
+}
+
+// @description: removes an entity from the running level. The player can not be despawned.
+// Despawning an obstacle that was merged with others rebuilds the collision data, a lone
+// one is taken out of the collision grid and the occupancy map in place.
+b8 despawn_level_entity(GameState *state, Arena *collision_arena, EntityHandle handle) {
+    EntityStore *store = &state->entity_store;
+    u32 index = entity_resolve(store, handle);
+    if (index == ENTITY_INVALID_INDEX || index == state->player.index) {
+	return 0;
+    }
+    EntityInfoArr *obstacles = &state->obstacles;
+    for (u32 i = 0; i < obstacles->size; i++) {
+	if (obstacles->buffer[i].index == index) {
+	    memmove(&obstacles->buffer[i], &obstacles->buffer[i + 1],
+		    (obstacles->size - i - 1)*sizeof(EntityInfo));
+	    obstacles->size--;
+	    break;
+	}
+    }
+    u32 collider = collider_set_find(&state->colliders, index);
+    if (collider == ENTITY_INVALID_INDEX) {
+	return entity_despawn(store, handle);
+    }
+    if (collider_source_count(&state->colliders, collider) == 1) {
+	state->colliders.types[collider] = COLLIDER_DEAD;
+	collision_grid_remove(&state->collision_grid, collider);
+	Rect bounds = entity_bounds(store, index);
+	b8 despawned = entity_despawn(store, handle);
+	occupancy_remove(&state->occupancy, store, bounds);
+	return despawned;
+    }
+    b8 despawned = entity_despawn(store, handle);
+    build_level_collision(state, collision_arena);
+    return despawned;
+}
+
+// @description: slot of the obstacle (or gravity inverter) under point, the first one
+// in slot order, ENTITY_INVALID_INDEX if there is none. Points over free atoms are
+// answered by the occupancy map, the slot is only looked up under a solid atom.
+u32 find_obstacle_at(GameState *state, Vec2 point) {
+    EntityStore *store = &state->entity_store;
+    ColliderSet *colliders = &state->colliders;
+    Rect probe = rect(point, Vec2{0.0f, 0.0f});
+    // @note: obstacles spawned at runtime are not in the occupancy map, same gate as sim_step
+    if (state->collision_grid.spawned_count == 0 && !occupancy_touches(&state->occupancy, probe)) {
+	return ENTITY_INVALID_INDEX;
+    }
+    u32 found = ENTITY_INVALID_INDEX;
+    ColliderQuery candidates = collision_grid_query(&state->collision_grid, colliders, probe);
+    for (u32 i = 0; i < candidates.count; i++) {
+	u32 c = candidates.indices[i];
+	if (!collider_is_alive(colliders, c) || !aabb_collision_rect(colliders->bounds[c], probe)) {
+	    continue;
+	}
+	// a merged collider covers several obstacles, find the one under point
+	for (u32 k = colliders->source_offsets[c]; k < colliders->source_offsets[c + 1]; k++) {
+	    u32 index = colliders->source_slots[k];
+	    if (index < found && entity_is_alive(store, index) &&
+		aabb_collision_rect(entity_bounds(store, index), probe)) {
+		found = index;
+	    }
+	}
+    }
+    return found;
+}
+
+int level_prefetch_thread(void *data) {
+    LevelLoader *loader = (LevelLoader*)data;
+    loader->prefetch_loaded = load_level(loader, &loader->prefetch_level,
+					 loader->prefetch_arena, loader->prefetch_name);
+    return 0;
+}
+
+// @description: waits for the loader thread and drops whatever it prefetched
+void level_prefetch_cancel(LevelLoader *loader) {
+    if (loader->thread) {
+	SDL_WaitThread(loader->thread, NULL);
+	loader->thread = NULL;
+    }
+    level_unload(&loader->prefetch_level);
+    loader->prefetch_level = Level{};
+    loader->prefetch_loaded = 0;
+    loader->prefetch_index = -1;
+}
+
+void level_prefetch_start(LevelLoader *loader, s32 level_index) {
+    if (loader->prefetch_disabled || level_index < 0 || level_index >= level_count) {
+	return;
+    }
+    if (loader->prefetch_index == level_index) {
+	// already in flight (or done)
+	return;
+    }
+    level_prefetch_cancel(loader);
+
+    loader->prefetch_index = level_index;
+    loader->prefetch_name = str256(level_names[level_index]);
+    loader->prefetch_arena = &loader->arenas[1 - loader->active];
+    loader->thread = SDL_CreateThread(level_prefetch_thread, "level_prefetch", loader);
+    if (loader->thread == NULL) {
+	// @note: no thread, the level gets loaded synchronously when needed
+	loader->prefetch_index = -1;
+    }
+}
+
+// @description: takes the prefetched level if it is the one being asked for.
+// The loader thread is usually long done by now, otherwise this waits for it.
+b8 level_prefetch_take(LevelLoader *loader, s32 level_index, Level *level) {
+    if (loader->prefetch_index != level_index) {
+	return 0;
+    }
+    if (loader->thread) {
+	SDL_WaitThread(loader->thread, NULL);
+	loader->thread = NULL;
+    }
+    b8 taken = loader->prefetch_loaded;
+    if (taken) {
+	level_unload(level);
+	*level = loader->prefetch_level;
+	loader->prefetch_level = Level{};
+	loader->active = 1 - loader->active;
+    }
+    level_prefetch_cancel(loader);
+
+    return taken;
+}
+
+// @description: level arenas, the level pack and the loader thread pool, sized for
+// a typical level. load_level grows the arenas to the real entity count.
+// worker_count is the size of the parse pool, < 0 for one worker per remaining core
+void level_loader_init(LevelLoader *loader, GameState *state, s32 worker_count) {
+    size_t max_level_entities = 255;
+    size_t arena_size = max_level_entities*(sizeof(Entity) + sizeof(EntityInfo));
+    *loader = {0};
+    loader->level_path_base = str256(base_level_path);
+    loader->compiled_level_path_base = str256(compiled_level_path);
+    loader->render_scale = state->render_scale;
+    loader->atom_size = state->atom_size;
+    memcpy(loader->entity_z, state->entity_z, sizeof(loader->entity_z));
+    loader->prefetch_index = -1;
+#if !defined(LEVELS_EMBEDDED)
+    level_pack_open(&loader->pack, level_pack_path);
+    thread_pool_init(&loader->pool, worker_count);
+#endif
+    for (u32 i = 0; i < ARR_SIZE(loader->arenas); i++) {
+	arena_init(&loader->arenas[i], (unsigned char*)malloc(arena_size), arena_size);
+    }
+    arena_init(&loader->reload_arena, (unsigned char*)malloc(arena_size), arena_size);
+    arena_init(&loader->collision_arena, (unsigned char*)malloc(arena_size), arena_size);
+}
+
+void level_loader_shutdown(LevelLoader *loader, GameState *state) {
+    level_prefetch_cancel(loader);
+    level_unload(&state->game_level);
+    level_pack_close(&loader->pack);
+    thread_pool_shutdown(&loader->pool);
+    for (u32 i = 0; i < ARR_SIZE(loader->arenas); i++) {
+	free(loader->arenas[i].buffer);
+    }
+    free(loader->reload_arena.buffer);
+    free(loader->collision_arena.buffer);
+}
+
+// @description: the level sim_step runs against
+SimLevel sim_level(GameState *state) {
+    SimLevel level = {};
+    level.store = &state->entity_store;
+    level.colliders = &state->colliders;
+    level.collision_grid = &state->collision_grid;
+    level.occupancy = &state->occupancy;
+    level.player = state->player.index;
+    return level;
+}
 
-    load_level(state, arena, level_path);
+// @description: draw the player and camera where they are now, without
+// interpolating from where they were (level loads, teleports)
+void snap_interpolation(GameState *state) {
+    state->previous_player_position = entity_position(&state->entity_store, state->player.index).v2();
+    state->previous_cam_pos = state->renderer.cam_pos;
+}
+
+void setup_level(GameState *state, GLRenderer *renderer, LevelLoader *loader) 
+{
+    b8 from_file = state->level_file.size > 0;
+    if (from_file) {
+	level_unload(&state->game_level);
+	b8 loaded = load_level_file(loader, &state->game_level, &loader->arenas[loader->active],
+				    state->level_file.buffer);
+	SDL_assert(loaded);
+    } else if (!level_prefetch_take(loader, state->level_index, &state->game_level)) {
+	Str256 level_name = str256(level_names[state->level_index]);
+	level_unload(&state->game_level);
+	b8 loaded = load_level(loader, &state->game_level, &loader->arenas[loader->active], level_name);
+	SDL_assert(loaded);
+    }
+    bind_level_entities(state, &loader->arenas[loader->active], &loader->collision_arena);
+    sim_level_reset(&state->sim);
 
-    Entity goal = state->game_level.entities[state->goal.index];
+    // @note: levels can have many goals, the camera starts on the first one
+    EntityQuery goals = entity_query(&state->entity_store, GOAL);
+    SDL_assert(goals.count > 0);
+    Vec3 goal_position = goals.count > 0 ? entity_position(&state->entity_store, goals.indices[0]) : Vec3{};
     Vec2 scr_dims;
-    renderer->cam_pos.x = goal.position.x - (state->screen_size.x/2.0f * state->render_scale.x);
-    renderer->cam_pos.y = goal.position.y - (state->screen_size.y/2.0f * state->render_scale.y);
-    state->effective_force = 0.0f;
-    state->player_velocity = Vec2{0.0f, 0.0f};
-    state->gravity_diry = 1.0f;
+    renderer->cam_pos.x = goal_position.x - (state->screen_size.x/2.0f * state->render_scale.x);
+    renderer->cam_pos.y = goal_position.y - (state->screen_size.y/2.0f * state->render_scale.y);
     renderer->cam_update = 1;
-}
+    snap_interpolation(state);
 
+    // @step: start parsing the next level while this one is played, a level
+    // file has no next level
+    if (!from_file) {
+	level_prefetch_start(loader, state->level_index + 1);
+    }
+}
+// @description: hot reload of the level being played, after its text file was saved.
+// Only the entities that changed are patched in place and the player keeps its state.
+// If entities were added or removed the edited table replaces the running one.
+// Entities spawned at runtime survive both.
+void hot_reload_level(GameState *state, LevelLoader *loader) {
+    Str256 text_path = loader->level_path_base;
+    str_push256(&text_path, str256(level_names[state->level_index]));
+    str_push256(&text_path, str256(".txt"));
 
-Vec2 get_move_dir(Controller c) {
-  Vec2 dir = {};
-  if (c.move_up) {
-    dir.y = 1.0f;
-  }
-  if (c.move_down) {
-    dir.y = -1.0f;
-  }
-  if (c.move_left) {
-    dir.x = -1.0f;
-  }
-  if (c.move_right) {
-    dir.x = 1.0f;
-  }
+    size_t fsize = 0;
+    char* level_data = (char*)SDL_LoadFile(text_path.buffer, &fsize);
+    if (level_data == NULL || fsize == 0) {
+	// @note: caught the file mid-save, the next write event will retry
+	SDL_free(level_data);
+	return;
+    }
 
-  return dir;
+    Arena *reload_arena = &loader->reload_arena;
+    arena_clear(reload_arena);
+    Level edited = {};
+    u32 entity_capacity = level_count_entities(level_data, fsize, &loader->pool);
+    level_arena_reserve(reload_arena, entity_capacity);
+    b8 parsed = level_parse_text(&edited, reload_arena, level_data, fsize, entity_capacity,
+				   loader->entity_z, &loader->pool);
+    SDL_free(level_data);
+    if (!parsed) {
+	return;
+    }
+    level_scale_entities(edited.entities, edited.entity_count, loader->render_scale, loader->atom_size);
+
+    b8 types_changed = 0;
+    EntityStore *store = &state->entity_store;
+    Vec3 player_position = entity_position(store, state->player.index);
+    // @note: not from the reload arena, it is sized for exactly the level and may
+    // become the active level arena below
+    u32 *patched_indices = (u32*)malloc(MAX(edited.entity_count, 1)*sizeof(u32));
+    s32 patched = level_patch_entities(&state->game_level, &edited, state->player.index,
+				       patched_indices, &types_changed);
+    if (patched >= 0) {
+	// @step: rewrite the patched slots, spawned entities and the other slots stay.
+	// A level entity that was despawned at runtime stays despawned, its slot may
+	// hold a spawned entity by now.
+	for (s32 i = 0; i < patched; i++) {
+	    u32 index = patched_indices[i];
+	    if (entity_is_from_level(store, index)) {
+		entity_store_set(store, index, &state->game_level.entities[index]);
+	    }
+	}
+	free(patched_indices);
+	if (patched > 0) {
+	    entity_store_set_position(store, state->player.index, player_position);
+	    build_level_collision(state, &loader->collision_arena);
+	}
+	if (types_changed) {
+	    index_level_entities(state);
+	}
+	return;
+    }
+    free(patched_indices);
+
+    // @step: entities were added or removed, swap in the edited table. The old store
+    // stays readable in the old arena (now the reload arena) until the next reload.
+    EntityStore previous_store = *store;
+    Arena active_arena = loader->arenas[loader->active];
+    loader->arenas[loader->active] = *reload_arena;
+    *reload_arena = active_arena;
+
+    level_unload(&state->game_level);
+    state->game_level = edited;
+    bind_level_entities(state, &loader->arenas[loader->active], &loader->collision_arena);
+    if (entity_type(store, state->player.index) == PLAYER) {
+	// keep the player where it is
+	entity_store_set_position(store, state->player.index, player_position);
+    }
+    // @step: spawn the runtime entities into the new table, spawns reuse despawned
+    // level slots so they can be anywhere in the old store
+    for (u32 i = 0; i < previous_store.count; i++) {
+	if (entity_is_alive(&previous_store, i) && previous_store.spawned[i]) {
+	    spawn_level_entity(state, entity_store_get(&previous_store, i));
+	}
+    }
+    snap_interpolation(state);
 }
 
 void update_camera(GLRenderer *renderer) {
@@ -500,6 +756,217 @@ void update_camera(GLRenderer *renderer) {
   }
 }
 
+// @description: index of the level called name in level_names, -1 if there is none
+s32 find_level_index(const char *name) {
+    for (s32 i = 0; i < level_count; i++) {
+	if (strcmp(level_names[i], name) == 0) {
+	    return i;
+	}
+    }
+    return -1;
+}
+
+// @description: makes level the one state plays from the next setup_level on, a name
+// in level_names or else the path of a level file. Returns 0 if it is neither.
+b8 game_set_level(GameState *state, const char *level) {
+    s32 index = find_level_index(level);
+    if (index >= 0) {
+	state->level_index = index;
+	str_clear(&state->level_file);
+	str_clear(&state->level_name);
+	return 1;
+    }
+    FILE *file = strlen(level) < sizeof(state->level_file.buffer) ? fopen(level, "rb") : NULL;
+    if (file == NULL) {
+	return 0;
+    }
+    fclose(file);
+    state->level_index = 0;
+    state->level_file = str256(level);
+    // @step: the file name is the level's name, what replays recorded on it hold
+    const char *name = strrchr(level, '/');
+    name = name ? name + 1 : level;
+    str_clear(&state->level_name);
+    for (; *name != 0 && *name != '.'; name++) {
+	str_pushc(&state->level_name, *name);
+    }
+    return 1;
+}
+
+// @description: name of the level state plays
+const char *game_level_name(GameState *state) {
+    return state->level_file.size > 0 ? state->level_name.buffer : level_names[state->level_index];
+}
+
+// @description: whether name (a level name or level file path) is the level state plays
+b8 game_level_is(GameState *state, const char *name) {
+    return strcmp(game_level_name(state), name) == 0 ||
+	   (state->level_file.size > 0 && strcmp(state->level_file.buffer, name) == 0);
+}
+
+// @description: one fixed tick of gameplay, the game loop and headless runs both
+// step through this. Moves on to the next level once the current one is complete,
+// returns 1 when it did.
+b8 game_tick(GameState *state, LevelLoader *loader, Controller *controller, const r32 *key_down_time, r32 dt) {
+    b8 level_changed = 0;
+    // @section: state based loading
+    if (state->sim.level_state == 1) {
+	// a level file has no next level, it starts over like the last level does
+	if (state->level_file.size == 0) {
+	    state->level_index = clampi(state->level_index+1, 0, level_count-1);
+	}
+	setup_level(state, &state->renderer, loader);
+	level_changed = 1;
+    }
+    SimLevel level = sim_level(state);
+    sim_step(&state->sim, &level, &state->tuning, controller, key_down_time, dt);
+    return level_changed;
+}
+
+// @description: a GameState for running the first level without a window: unscaled,
+// as if rendering at the size the game is designed around
+void headless_state_init(GameState *state) {
+    *state = GameState{};
+    state->screen_size = Vec2{1920, 1080};
+    state->render_scale = Vec2{1.0f, 1.0f};
+    state->atom_size = Vec2{64.0f, 64.0f};
+    state->camera_bounds = rect(Vec2{0.0f, 0.0f}, state->screen_size);
+    level_default_entity_z(state->entity_z);
+    sim_init(&state->sim);
+    state->tuning = sim_tuning(state->render_scale);
+}
+
+// @section: batch simulation
+// @note: independent games stepped side by side, one ThreadPool job per instance.
+// An instance owns its GameState, level arenas and input, the only things the
+// instances share are read-only (level pack, embedded tables), so a batch is as
+// deterministic as a single game: an instance ends where it would have alone.
+typedef void (*BatchInputFn)(void *data, u32 instance, u64 tick, Controller *controller, r32 *key_down_time);
+
+struct BatchInstance {
+    GameState state;
+    LevelLoader loader;
+    Controller controller;
+    r32 key_down_time[5];
+    // input, the recorded run when replay.header is set, the batch's input_fn otherwise
+    ReplayPlayer replay;
+    r32 tick_seconds;	// the rate the replay was recorded at, SIM_TICK_SECONDS otherwise
+    u64 tick;
+    u32 levels_completed;
+    b8 finished;	// the replay ran out
+};
+
+struct SimBatch {
+    BatchInstance *instances;
+    u32 instance_count;
+    ThreadPool pool;
+    BatchInputFn input_fn;	// NULL: no input
+    void *input_data;
+    u64 step_ticks;		// ticks the running sim_batch_step takes every instance through
+};
+
+// @description: instance_count games of level, a name in level_names or the path of a
+// level file (see game_set_level), returns 0 if it is neither. The instances load their
+// levels on their own thread, with no parse pool of their own, the batch already uses
+// the cores. worker_count is the size of the pool the instances are stepped on, < 0 for
+// one per core.
+b8 sim_batch_init(SimBatch *batch, u32 instance_count, const char *level, s32 worker_count,
+		  BatchInputFn input_fn, void *input_data) {
+    memset(batch, 0, sizeof(SimBatch));
+    batch->instances = (BatchInstance*)calloc(instance_count, sizeof(BatchInstance));
+    SDL_assert(batch->instances != NULL);
+    headless_state_init(&batch->instances[0].state);
+    if (!game_set_level(&batch->instances[0].state, level)) {
+	free(batch->instances);
+	memset(batch, 0, sizeof(SimBatch));
+	return 0;
+    }
+    batch->instance_count = instance_count;
+    batch->input_fn = input_fn;
+    batch->input_data = input_data;
+    thread_pool_init(&batch->pool, worker_count);
+    for (u32 i = 0; i < instance_count; i++) {
+	BatchInstance *instance = &batch->instances[i];
+	if (i > 0) {
+	    instance->state = batch->instances[0].state;
+	}
+	instance->tick_seconds = (r32)SIM_TICK_SECONDS;
+	level_loader_init(&instance->loader, &instance->state, 0);
+	// @note: a loader thread per instance would compete with the batch for the
+	// cores, the next level is loaded when the instance gets to it
+	instance->loader.prefetch_disabled = 1;
+    }
+    return 1;
+}
+
+static void sim_batch_setup_job(void *data, u32 job_index) {
+    BatchInstance *instance = &((SimBatch*)data)->instances[job_index];
+    setup_level(&instance->state, &instance->state.renderer, &instance->loader);
+}
+
+// @description: loads the first level of every instance, in parallel
+void sim_batch_start(SimBatch *batch) {
+    thread_pool_run(&batch->pool, sim_batch_setup_job, batch, batch->instance_count);
+}
+
+// @description: has the instance play the run recorded in path instead of the batch
+// input, from the recorded start. Call it after sim_batch_start. The run has to start
+// on the instance's level (a level file plays runs recorded on its file name). The
+// instance ticks at the rate the run was recorded at, the others keep their own.
+b8 sim_batch_play_replay(SimBatch *batch, u32 instance_index, const char *path) {
+    BatchInstance *instance = &batch->instances[instance_index];
+    ReplayPlayer replay;
+    if (!replay_open(&replay, path)) {
+	return 0;
+    }
+    if (!game_level_is(&instance->state, replay.header->level_name)) {
+	replay_close(&replay);
+	return 0;
+    }
+    replay_close(&instance->replay);
+    instance->replay = replay;
+    instance->state.sim = replay.header->start;
+    instance->tick_seconds = replay_tick_seconds(&replay);
+    return 1;
+}
+
+static void sim_batch_step_job(void *data, u32 job_index) {
+    SimBatch *batch = (SimBatch*)data;
+    BatchInstance *instance = &batch->instances[job_index];
+    for (u64 t = 0; t < batch->step_ticks && !instance->finished; t++) {
+	if (instance->replay.header) {
+	    if (!replay_play_tick(&instance->replay, &instance->controller, instance->key_down_time)) {
+		instance->finished = 1;
+		break;
+	    }
+	} else if (batch->input_fn) {
+	    batch->input_fn(batch->input_data, job_index, instance->tick,
+			    &instance->controller, instance->key_down_time);
+	}
+	instance->levels_completed += game_tick(&instance->state, &instance->loader, &instance->controller,
+						instance->key_down_time, instance->tick_seconds);
+	instance->tick++;
+    }
+}
+
+// @description: advances every instance by tick_count ticks (instances whose replay
+// ended stop early) and waits for all of them
+void sim_batch_step(SimBatch *batch, u64 tick_count) {
+    batch->step_ticks = tick_count;
+    thread_pool_run(&batch->pool, sim_batch_step_job, batch, batch->instance_count);
+}
+
+void sim_batch_shutdown(SimBatch *batch) {
+    thread_pool_shutdown(&batch->pool);
+    for (u32 i = 0; i < batch->instance_count; i++) {
+	BatchInstance *instance = &batch->instances[i];
+	replay_close(&instance->replay);
+	level_loader_shutdown(&instance->loader, &instance->state);
+    }
+    free(batch->instances);
+    memset(batch, 0, sizeof(SimBatch));
+}
+
 Vec2 get_screen_position_from_percent(GameState state, Vec2 v) {
   Vec2 screen_pos = v;
   screen_pos.x = state.render_scale.x*state.screen_size.x*v.x/100.0f;
@@ -508,6 +975,122 @@ Vec2 get_screen_position_from_percent(GameState state, Vec2 v) {
   return screen_pos;
 }
 
+// @description: moves the camera after a tick, dt_ms long, towards the player
+void follow_player_camera(GameState *state, Vec2 cam_lt_limit, Vec2 cam_rb_limit, Vec2 camera_pan_slow, r64 dt_ms) {
+    // camera movement and handling
+    // Cases:
+    // - A new level loads, the camera position needs to be on the player 
+    // (part of level loading) [Focus on Player]
+    // - Player is moving and camera needs to follow
+    // - Player has stopped moving and camera needs to slowly adjust (linearly)
+    // - Player teleports, camera needs to move to the player:
+    //  - if player is within view camera needs to slowly adjust the player, 
+    //  and pan linearly until player is in level focus
+    //  - if player is out of camera view, jump 
+    //  (linearly but slightly faster) to the player
+    // - If player is outside, pan quickly (linearly) to player
+    // - If player is at the boundary of a level, 
+    // respect the level boundary and do not center the player. 
+    //  Pan camera, up until the edge of the level boundary. 
+    //  Do no move the camera beyond the level boundary.
+    //
+    //  Based off of these cases, this is the behavior I can see:
+    //  1. Player is moving at the edges of the screen, follow.
+    //  2. Player is stopped, pan slowly until player is in the focus region 
+    //  (need to define focus region)
+    //  3. Player is outside the screen, pan to player 
+    //  (go from current camera position to player position linearly)
+    GLRenderer *renderer = &state->renderer;
+    SimState *sim = &state->sim;
+    Vec2 player_position = entity_position(&state->entity_store, state->player.index).v2();
+    Rect player_bounds = entity_bounds(&state->entity_store, state->player.index);
+
+    // @step: player is at the edge of the screen
+    // get players visible bounds (padding around the player to consider it be visible for the camera)
+    Vec2 vis_lb = player_bounds.lb - (Vec2{120.0f, 60.0f} * state->render_scale.x);
+    Vec2 vis_rt = player_bounds.rt + (Vec2{120.0f, 60.0f} * state->render_scale.y);
+    Rect vis_bounds;
+    vis_bounds.lb = vis_lb;
+    vis_bounds.rt = vis_rt;
+    Rect cam_bounds = state->camera_bounds;
+
+    Vec2 camera_center = Vec2{state->camera_bounds.rt.x/2.0f, state->camera_bounds.rt.y/2.0f};
+    Vec2 player_camera_offset = player_position - camera_center;
+    // check if vis_bounds inside camera_bounds
+    b8 is_player_in_camera = (
+	    vis_bounds.lb.x >= cam_bounds.lb.x && vis_bounds.lb.y >= cam_bounds.lb.y &&
+	    vis_bounds.rt.x <= cam_bounds.rt.x && vis_bounds.rt.y <= cam_bounds.rt.y
+    );
+
+    if (!is_player_in_camera) {
+	r32 stepx_multiplier = player_camera_offset.x < 0 ? -1.0f : 1.0f;
+	r32 stepy_multiplier = player_camera_offset.y < 0 ? -1.0f : 1.0f;
+
+	r32 camera_stepx = stepx_multiplier * MIN(ABS(player_camera_offset.x), camera_pan_slow.x);
+	r32 camera_stepy = stepy_multiplier * MIN(ABS(player_camera_offset.y), camera_pan_slow.y);
+
+	Vec2 distance_scaler;	    
+	{
+	    // @step: calculate distance scaler
+	    // @note: this is to help scale how quickly the camera needs to pan
+	    // this is based off of how far the player is from the camera position.
+	    // The reason this is discrete instead of continuous is to give better predictability
+	    // (at this stage)
+	    // @note: make this continuous, so it pans smoothly. Movement is jerky at step boundaries
+	    u32 dist_stepx = (u32)SDL_floorf(ABS(player_camera_offset.x) / 100);
+	    u32 dist_stepy = (u32)SDL_floorf(ABS(player_camera_offset.y) / 100);
+
+	    if (dist_stepx >= 0 && dist_stepx < 4) {
+		distance_scaler.x = 8.0f;
+	    } else if (dist_stepx >= 4 && dist_stepx < 8) {
+		distance_scaler.x = 6.0f;
+	    } else {
+		distance_scaler.x = 4.0f;
+	    }
+
+	    if (dist_stepy >= 0 && dist_stepy < 4) {
+		distance_scaler.y = 8.0f;
+	    } else if (dist_stepy >= 4 && dist_stepy < 8) {
+		distance_scaler.y = 6.0f;
+	    } else {
+		distance_scaler.y = 4.0f;
+	    }
+	}
+	renderer->cam_pos.x += camera_stepx*dt_ms/distance_scaler.x;
+	renderer->cam_pos.y += camera_stepy*dt_ms/distance_scaler.y;
+
+	renderer->cam_update = 1;
+    }
+
+
+    b8 player_moving_up = sim->motion_dir.y == sim->gravity_diry*1 && !sim->collidey;
+    b8 player_moving_down = sim->motion_dir.y == sim->gravity_diry*-1 && !sim->collidey;
+
+    player_camera_offset = player_position - renderer->cam_pos.v2();
+    // @step: player moving at edges of the screen
+    if (player_camera_offset.x <= cam_lt_limit.x && sim->motion_dir.x == -1) {
+	renderer->cam_pos.x += sim->motion.x;
+	renderer->cam_update = 1;
+    }
+    if (player_camera_offset.y >= cam_lt_limit.y && 
+	    player_moving_up) {
+	renderer->cam_pos.y += sim->motion.y;
+	renderer->cam_update = 1;
+    }
+    if (player_camera_offset.x >= cam_rb_limit.x && sim->motion_dir.x == 1) {
+	renderer->cam_pos.x += sim->motion.x;
+	renderer->cam_update = 1;
+    }
+    if (player_camera_offset.y <= cam_rb_limit.y && 
+	    player_moving_down) {
+	renderer->cam_pos.y += sim->motion.y;
+	renderer->cam_update = 1;
+    }
+    if (renderer->cam_update) {
+	state->camera_bounds = rect(renderer->cam_pos.v2(), state->screen_size*state->render_scale);
+    }
+}
+
 struct DropdownOption {
     Str256 label;
 };
@@ -650,33 +1233,214 @@ ButtonState ui_button(GameState state, UiButton button) {
     return btn_state;
 }
 
+// @description: scripted input for headless runs, a random walk seeded by the
+// instance: every HEADLESS_WANDER_TICKS it picks left, right or standing still and
+// maybe jumps
+#define HEADLESS_WANDER_TICKS 45
+void headless_wander_input(void *data, u32 instance, u64 tick, Controller *controller, r32 *key_down_time) {
+    u64 segment = tick/HEADLESS_WANDER_TICKS;
+    if (tick % HEADLESS_WANDER_TICKS != 0) {
+	return;
+    }
+    // @note: splitmix64 of (instance, segment), the input does not depend on the thread or the order
+    u64 x = ((u64)instance << 32) + segment + 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30))*0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27))*0x94D049BB133111EBull;
+    x = x ^ (x >> 31);
+    u32 move = (u32)(x % 3);
+    controller->move_left = move == 1;
+    controller->move_right = move == 2;
+    key_down_time[PK_A] = move == 1 ? 1.0f : 0.0f;
+    key_down_time[PK_D] = move == 2 ? 1.0f : 0.0f;
+    controller->jump = ((x >> 8) & 1) != 0;
+}
+
 // @section: main
+// @description: runs the game without a window, a GL context or a frame limiter,
+// as many ticks as it can. Same level loading and gameplay code as the game, for
+// CI and performance runs on machines without a GPU.
+// -level takes a level name or the path of a level file (text or compiled .lvl).
+// With -replay the input, the level and the tick count come from a recorded run
+// and the player has to end where it did in the recording. A run recorded on a
+// level file that is not where the replay names it, like the solver's replays of
+// generated levels, plays with -level pointing at the file.
+// -instances runs that many independent games at once, one per core (see SimBatch),
+// -wander gives each of them its own scripted input instead of none.
+// usage: main -headless [-level <name|file>] [-ticks <n>] [-gravity] [-replay <file>]
+//                       [-instances <n>] [-threads <n>] [-wander]
+int run_headless(int argc, char* argv[]) {
+    u64 tick_count = 100000;
+    const char *level_name = NULL;
+    const char *replay_path = NULL;
+    b8 start_with_gravity = 0;
+    b8 wander = 0;
+    u32 instance_count = 1;
+    s32 worker_count = -1;
+    for (int i = 1; i < argc; i++) {
+	if (strcmp(argv[i], "-headless") == 0) {
+	    continue;
+	} else if (strcmp(argv[i], "-level") == 0 && i + 1 < argc) {
+	    level_name = argv[++i];
+	} else if (strcmp(argv[i], "-ticks") == 0 && i + 1 < argc) {
+	    tick_count = strtoull(argv[++i], NULL, 10);
+	} else if (strcmp(argv[i], "-gravity") == 0) {
+	    start_with_gravity = 1;
+	} else if (strcmp(argv[i], "-replay") == 0 && i + 1 < argc) {
+	    replay_path = argv[++i];
+	} else if (strcmp(argv[i], "-instances") == 0 && i + 1 < argc) {
+	    s32 count = atoi(argv[++i]);
+	    instance_count = (u32)MAX(count, 1);
+	} else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc) {
+	    worker_count = atoi(argv[++i]) - 1;
+	} else if (strcmp(argv[i], "-wander") == 0) {
+	    wander = 1;
+	} else {
+	    printf("usage: %s -headless [-level <name|file>] [-ticks <n>] [-gravity] [-replay <file>]"
+		   " [-instances <n>] [-threads <n>] [-wander]\n", argv[0]);
+	    return -1;
+	}
+    }
+
+    if (SDL_Init(SDL_INIT_TIMER) != 0) {
+	printf("Error initialising SDL2: %s\n", SDL_GetError());
+	return -1;
+    }
+
+    ReplayHeader replay_header = {};
+    if (replay_path) {
+	ReplayPlayer replay;
+	if (!replay_open(&replay, replay_path)) {
+	    printf("ERROR :: could not read replay %s\n", replay_path);
+	    SDL_Quit();
+	    return -1;
+	}
+	replay_header = *replay.header;
+	replay_close(&replay);
+	if (level_name == NULL) {
+	    level_name = replay_header.level_name;
+	}
+	tick_count = replay_header.tick_count;
+    }
+    if (level_name == NULL) {
+	level_name = level_names[0];
+    }
+
+    SimBatch batch;
+    if (!sim_batch_init(&batch, instance_count, level_name, worker_count,
+			wander ? headless_wander_input : NULL, NULL)) {
+	printf("ERROR :: %s is neither a level nor a level file\n", level_name);
+	SDL_Quit();
+	return -1;
+    }
+    sim_batch_start(&batch);
+    for (u32 i = 0; i < instance_count; i++) {
+	batch.instances[i].controller.toggle_gravity = start_with_gravity;
+	if (replay_path && !sim_batch_play_replay(&batch, i, replay_path)) {
+	    printf("ERROR :: %s was recorded on level %s, not %s\n",
+		   replay_path, replay_header.level_name, level_name);
+	    sim_batch_shutdown(&batch);
+	    SDL_Quit();
+	    return -1;
+	}
+    }
+
+    u64 start = SDL_GetPerformanceCounter();
+    sim_batch_step(&batch, tick_count);
+    r64 elapsed = (r64)(SDL_GetPerformanceCounter() - start)/(r64)SDL_GetPerformanceFrequency();
+
+    u64 total_ticks = 0;
+    r64 total_seconds = 0.0;
+    u32 diverged = 0;
+    for (u32 i = 0; i < instance_count; i++) {
+	BatchInstance *instance = &batch.instances[i];
+	GameState *state = &instance->state;
+	Vec3 player_position = entity_position(&state->entity_store, state->player.index);
+	total_ticks += instance->tick;
+	total_seconds += instance->tick*(r64)instance->tick_seconds;
+	if (replay_path && (player_position.x != replay_header.end_position.x ||
+			    player_position.y != replay_header.end_position.y)) {
+	    diverged++;
+	}
+	if (i < 16) {
+	    printf("headless: [%u] level %s, player at (%.2f, %.2f), %u levels completed\n",
+		   i, game_level_name(state), player_position.x, player_position.y,
+		   instance->levels_completed);
+	}
+    }
+    printf("headless: %u instance(s) on %u thread(s), %llu ticks (%.1fs of gameplay) in %.3fs, %.0f ticks/s\n",
+	   instance_count, batch.pool.worker_count + 1, (unsigned long long)total_ticks,
+	   total_seconds, elapsed, elapsed > 0.0 ? total_ticks/elapsed : 0.0);
+
+    s32 result = 0;
+    if (replay_path) {
+	if (diverged == 0) {
+	    printf("headless: replay matches the recording\n");
+	} else {
+	    printf("headless: replay diverged in %u instance(s), the recording ended at (%.2f, %.2f)\n",
+		   diverged, replay_header.end_position.x, replay_header.end_position.y);
+	    result = 1;
+	}
+    }
+
+    sim_batch_shutdown(&batch);
+    SDL_Quit();
+    return result;
+}
+
+// @description: writes the recording to *record_path and stops it, nothing happens when
+// nothing is being recorded
+void end_recording(ReplayRecorder *recorder, const char **record_path, GameState *state) {
+    if (*record_path == NULL) {
+	return;
+    }
+    Vec3 end_position = entity_position(&state->entity_store, state->player.index);
+    if (!replay_record_end(recorder, *record_path, end_position)) {
+	printf("ERROR :: could not write replay %s\n", *record_path);
+    }
+    *record_path = NULL;
+}
+
+// usage: main [-level <name|file>] [-record <file>] [-replay <file>] [-vsync] [-fps <n>],
+// or main -headless ... (see run_headless). -level starts on a level other than the first
+// one, or on a level file. -record writes the gameplay input of the session to file on
+// quit, from the start of the first level. A replay only holds input, so a level switch
+// (HOME/END/F5), a hot reload or an edit (DELETE removes the obstacle under the mouse)
+// ends the recording there, the level it plays on changes under it.
+// Gameplay runs on a fixed tick whatever the display rate, frames are not limited by
+// default: -vsync waits for the display, -fps caps the frame rate at n.
 int main(int argc, char* argv[])
 {
+    const char *record_path = NULL;
+    const char *replay_path = NULL;
+    const char *level_name = NULL;
+    b8 vsync = 0;
+    u32 frame_rate_cap = 0;	// 0 is no cap
+    for (int i = 1; i < argc; i++) {
+	if (strcmp(argv[i], "-headless") == 0) {
+	    return run_headless(argc, argv);
+	} else if (strcmp(argv[i], "-vsync") == 0) {
+	    vsync = 1;
+	} else if (strcmp(argv[i], "-fps") == 0 && i + 1 < argc) {
+	    frame_rate_cap = (u32)atoi(argv[++i]);
+	} else if (strcmp(argv[i], "-record") == 0 && i + 1 < argc) {
+	    record_path = argv[++i];
+	} else if (strcmp(argv[i], "-replay") == 0 && i + 1 < argc) {
+	    replay_path = argv[++i];
+	} else if (strcmp(argv[i], "-level") == 0 && i + 1 < argc) {
+	    level_name = argv[++i];
+	}
+    }
+    ReplayPlayer replay = {};
+    if (replay_path && !replay_open(&replay, replay_path)) {
+	printf("ERROR :: could not read replay %s\n", replay_path);
+	return -1;
+    }
+
+
     Vec2 scr_dims = Vec2{1920, 1080};
 
     Vec2 render_dims = Vec2{1920, 1080};
   
-  {
-      // entity configs setup
-    entity_colors[PLAYER] = Vec3{0.45f, 0.8f, 0.2f};
-    entity_colors[OBSTACLE] = Vec3{1.0f, 1.0f, 1.0f};
-    entity_colors[GOAL] = Vec3{ 0.93f, 0.7f, 0.27f };
-    entity_colors[INVERT_GRAVITY] = Vec3{1.0f, 0.0f, 0.0f};
-    entity_colors[TELEPORT] = Vec3{0.0f, 0.0f, 0.0f};
-
-    entity_z[TEXT] = -3.0f;
-    entity_z[DEBUG_LINE] = -4.0f;
-    r32 entity_base_z = -5.0f;
-    entity_z[OBSTACLE] = entity_base_z - 1.0f;
-    entity_z[GOAL] = entity_base_z - 2.0f;
-    {
-	entity_z[TELEPORT] = entity_base_z - 3.0f; 
-	entity_z[INVERT_GRAVITY] = entity_base_z - 3.0f;
-    }
-    entity_z[PLAYER] = entity_base_z - 4.0f;
-  }
-
   if (SDL_Init(SDL_INIT_VIDEO) != 0)
   {
     printf("Error initialising SDL2: %s\n", SDL_GetError());
@@ -709,9 +1473,19 @@ int main(int argc, char* argv[])
     }
   
   // vsync controls: 0 = OFF | 1 = ON (Default)
-  SDL_GL_SetSwapInterval(0);
+  SDL_GL_SetSwapInterval(vsync ? 1 : 0);
   
   GameState state = {0};
+  {
+      // entity configs setup
+    state.entity_colors[PLAYER] = Vec3{0.45f, 0.8f, 0.2f};
+    state.entity_colors[OBSTACLE] = Vec3{1.0f, 1.0f, 1.0f};
+    state.entity_colors[GOAL] = Vec3{ 0.93f, 0.7f, 0.27f };
+    state.entity_colors[INVERT_GRAVITY] = Vec3{1.0f, 0.0f, 0.0f};
+    state.entity_colors[TELEPORT] = Vec3{0.0f, 0.0f, 0.0f};
+
+    level_default_entity_z(state.entity_z);
+  }
   enum GameScreen game_screen = GAMEPLAY;
   GLRenderer *renderer = &state.renderer;
   memset(renderer, 0, sizeof(GLRenderer));
@@ -819,42 +1593,54 @@ int main(int argc, char* argv[])
   state.screen_size = scr_dims;
   state.render_scale = render_scale;
   Vec2 camera_screen_size = state.screen_size * state.render_scale;
-  state.level_path_base = str256(base_level_path);
 
   // @section: gameplay variables
-  u32 jump_count = 1;
-  r64 jump_timer = 0;
   r32 motion_scale = 2.0f*state.render_scale.x;
-  state.gravity_diry = 1.0f;
-  r32 fall_accelx = 3.0f*motion_scale;
-  r32 move_accelx = 4.0f*motion_scale;
-  r32 max_speedx = 5.0f*motion_scale;
-  r32 freefall_accel = -11.8f*motion_scale;
-  r32 jump_force = 6.5f*motion_scale;
-  state.effective_force = 0.0f;
+  sim_init(&state.sim);
+  state.tuning = sim_tuning(state.render_scale);
   Vec2 camera_pan_slow = Vec2{2.0f, 2.0f}*motion_scale;
 
-  state.player_velocity = Vec2{0.0f, 0.0f};
-  Vec2 p_move_dir = Vec2{0.0f, 0.0f};
-  // direction in which player is effectively travelling
-  Vec2 p_motion_dir = Vec2{0.0f, 0.0f};
-
 
   // @todo: rename rect members (makes more sense)
   // tl -> lt
   // br -> rb
   state.camera_bounds = rect(renderer->cam_pos.v2(), camera_screen_size);
 
+  // @step: the level to start on, the replay's unless -level names one
+  if (level_name == NULL) {
+    level_name = replay_path ? replay.header->level_name : level_names[0];
+  }
+  if (!game_set_level(&state, level_name)) {
+    printf("ERROR :: %s is neither a level nor a level file\n", level_name);
+    return -1;
+  }
+  if (replay_path && !game_level_is(&state, replay.header->level_name)) {
+    printf("ERROR :: %s was recorded on level %s, not %s\n",
+	   replay_path, replay.header->level_name, level_name);
+    return -1;
+  }
+
   // @section: level elements
   
   // @step: init_level_arena
-  size_t max_level_entities = 255;
-  size_t arena_mem_size = GB(1);
-  void* level_mem = malloc(arena_mem_size);
-  Arena level_arena;
-  size_t arena_size = max_level_entities*(sizeof(Entity) + sizeof(EntityInfo));
-  arena_init(&level_arena, (unsigned char*)level_mem, arena_size);
-  setup_level(&state, &state.renderer, &level_arena);
+  LevelLoader level_loader;
+  level_loader_init(&level_loader, &state, -1);
+  r32 tick_seconds = (r32)SIM_TICK_SECONDS;
+  setup_level(&state, &state.renderer, &level_loader);
+  if (replay_path) {
+    state.sim = replay.header->start;
+    tick_seconds = replay_tick_seconds(&replay);
+  }
+  ReplayRecorder recorder = {};
+  if (record_path) {
+    replay_record_begin(&recorder, game_level_name(&state), &state.sim);
+  }
+
+  // @step: hot reload, watch the level directory for saves to the active level
+  LevelWatcher level_watcher = {-1, -1};
+#if !defined(LEVELS_EMBEDDED)
+  level_watch_init(&level_watcher, base_level_path);
+#endif
 
   // gameplay camera movement stuff
   Vec2 cam_lt_limit = {0};
@@ -868,28 +1654,18 @@ int main(int argc, char* argv[])
 
   Controller controller = {0};
   r32 key_down_time[5] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
-  b8 is_key_down_x = false;
-  
-  // gravity calculations
-  b8 was_colliding = 0;
-  b8 collidex = 0;
-  b8 collidey = 0;
-    b8 is_collide_bottom = 0;
-    b8 is_collide_top = 0;
-  b8 is_gravity = 0;
   
   b8 game_running = 1;
 
   FrameTimer timer = frametimer();
+  // frame time not simulated yet, less than a tick
+  r64 sim_accumulator = 0.0;
 
   while (game_running) 
   {
-    controller.jump = 0;
-    controller.toggle_gravity = 0;
     state.mouse_up = 0;
+    b8 despawn_under_mouse = 0;
 
-    IVec2 mouse_position_world;
-    IVec2 mouse_position_clamped;
     SDL_Event ev;
     while(SDL_PollEvent(&ev))
     {
@@ -920,13 +1696,6 @@ int main(int argc, char* argv[])
 	      SDL_GetMouseState(&state.mouse_position.x, &state.mouse_position.y);
 	      // flip mouse y to map it Y at Top -> Y at Bottom (like in maths)
 	      state.mouse_position.y = render_dims.y - state.mouse_position.y;
-	      // get mouse world position
-	      mouse_position_world.x = state.mouse_position.x + (s32)renderer->cam_pos.x;
-	      mouse_position_world.y = state.mouse_position.y + (s32)renderer->cam_pos.y;
-	      // clamp mouse position based off of the grids we draw (this will make level object placement easier)
-	      mouse_position_clamped.x = mouse_position_world.x - ((mouse_position_world.x) % (s32)(atom_size.x));
-	      mouse_position_clamped.y = mouse_position_world.y - ((mouse_position_world.y) % (s32)(atom_size.y));
-
 	  } break;
         case (SDL_KEYDOWN):
           {
@@ -992,17 +1761,28 @@ int main(int argc, char* argv[])
 	    // @todo: fix this janky manual camera movement 
 	    if (ev.key.keysym.sym == SDLK_HOME)
 	    {
-		state.level_index = MAX(state.level_index - 1, 0);
-		setup_level(&state, &state.renderer, &level_arena);
+		end_recording(&recorder, &record_path, &state);
+		// back to the shipped levels from a level file
+		state.level_index = state.level_file.size > 0 ? state.level_index : MAX(state.level_index - 1, 0);
+		str_clear(&state.level_file);
+		setup_level(&state, &state.renderer, &level_loader);
 	    }
 	    if (ev.key.keysym.sym == SDLK_END)
 	    {
-		state.level_index = MIN(state.level_index + 1, level_count-1);
-		setup_level(&state, &state.renderer, &level_arena);
+		end_recording(&recorder, &record_path, &state);
+		state.level_index = state.level_file.size > 0 ? state.level_index : MIN(state.level_index + 1, level_count-1);
+		str_clear(&state.level_file);
+		setup_level(&state, &state.renderer, &level_loader);
 	    }
 	    if (ev.key.keysym.sym == SDLK_F5)
 	    {
-		setup_level(&state, &state.renderer, &level_arena);
+		end_recording(&recorder, &record_path, &state);
+		setup_level(&state, &state.renderer, &level_loader);
+	    }
+	    if (ev.key.keysym.sym == SDLK_DELETE)
+	    {
+		// the mouse is only in world space after the events
+		despawn_under_mouse = 1;
 	    }
           } break;
         case (SDL_KEYUP):
@@ -1027,7 +1807,7 @@ int main(int argc, char* argv[])
             }
 	    if (ev.key.keysym.sym == SDLK_i)
 	    {
-		state.flip_gravity = 1;
+		controller.flip_gravity = 1;
 	    }
           } break;
         default:
@@ -1037,514 +1817,81 @@ int main(int argc, char* argv[])
       }
     }
 
-    if (game_screen == GAMEPLAY) {
-	// @section: state based loading
-	if (state.level_state == 1) {
-	    state.level_index = clampi(state.level_index+1, 0, level_count-1);
-	    setup_level(&state, &state.renderer, &level_arena);
-	}
-	
-	// @section: input processing
-	if (controller.toggle_gravity)
-	{
-	  is_gravity = !is_gravity;
-	  state.player_velocity = Vec2{0.0f, 0.0f};
-	  p_move_dir.x = 0.0f;
-	  state.effective_force = 0.0f;
-	  p_motion_dir = {0};
-	}
-	if (controller.move_up)
-	{
-	  p_move_dir.y = 1.0f;
-	}
-	if (controller.move_down)
-	{
-	  p_move_dir.y = -1.0f;
-	}
-
-	PlatformKey horizontal_move = PK_NIL;
-	is_key_down_x = false;
-	if (
-	  key_down_time[PK_A] != 0.0f || 
-	  key_down_time[PK_D] != 0.0f
-	) {
-	  horizontal_move = (
-	    key_down_time[PK_A] > key_down_time[PK_D] ? PK_A : PK_D
-	  );
-	}
-
-	if (horizontal_move == PK_A && controller.move_left) 
-	{
-	  p_move_dir.x = -1.0f;
-	  is_key_down_x = true;
-	} 
-	if (horizontal_move == PK_D && controller.move_right) 
-	{
-	  p_move_dir.x = 1.0f;
-	  is_key_down_x = true;
-	}
-
-	if (controller.jump && jump_count > 0 && jump_timer > 100.0f) {
-	    controller.jump = 1;
-	    jump_count--;
-	    jump_timer = 0.0f;
-	} else {
-	    controller.jump = 0;
-	}
-
-	// jump increment
-	jump_timer += timer.tDeltaMS;
-	if (is_collide_bottom == 1 && state.gravity_diry > 0.0f) {
-	    jump_count = 1;
-	}
-	if (is_collide_top == 1 && state.gravity_diry < 0.0f) {
-	    jump_count = 1;
-	}
-
-
-	// @section: gravity
-	if (state.flip_gravity)
-	{
-	    // @resume: I need to add a buffer zone, something like some iframes, so that once I touch a gravity block
-	    // I don't reflip gravity if I am in contact with the block for 1-2 seconds right after first colliding
-	    state.gravity_diry = state.gravity_diry > 0.0f ? -0.8f : 1.0f;
-	    //gravity_diry *= -1.0f;
-	    state.flip_gravity = 0;
-	}
-	Vec2 pd_1 = Vec2{0.0f, 0.0f};
-	p_motion_dir = {0};
-	if (collidey)
-	{
-	  state.player_velocity.y = 0.0f;
-	}
-	if (collidex)
-	{
-	  state.player_velocity.x = 0.0f;
-	}
-	if (is_gravity)
-	{
-	    // @section: game_movement
-
-	  // calculate force acting on player
-	  if (collidey) {
-	      // @note: can I reduce the states here like I did in the falling case
-	      // without separate checks
-	      if (collidex) {
-		  state.effective_force = 0.0f;
-	      } else if (is_key_down_x) {
-		  r32 updated_force = (
-			  state.effective_force + p_move_dir.x*move_accelx*timer.tDelta
-			  );
-		  updated_force = clampf(
-			  updated_force, -max_speedx, max_speedx
-			  );
-		  state.effective_force = updated_force;
-	      } else {
-		  r32 friction = 0.0f;
-		  if (state.effective_force > 0.0f) {
-		    friction = -move_accelx*timer.tDelta;
-		  } else if (state.effective_force < 0.0f) {
-		    friction = move_accelx*timer.tDelta;
-		  }
-		  r32 updated_force = state.effective_force + friction;
-		  state.effective_force = (
-		    ABS(updated_force) < 0.5f ? 
-		    0.0f : updated_force
-		  );
-	      }
-	  } else {
-	    r32 smoothing_force = state.effective_force;
-	    r32 net_force = 0.0f;
-	    r32 active_force = 0.0f;
-	    if (!collidex) { 
-	      net_force = state.effective_force;
-	      if (controller.jump) {
-		  // @step: if in the air and jumping in a different direction
-		  // allow more immediate feeling force, instead of the jump adding into net_force
-		  // which gives off, more of a floaty feeling.
-		  r32 threshed_force = roundf(net_force);
-		  b8 move_dir_different = (threshed_force >= 0 && p_move_dir.x < 0) || (threshed_force <= 0 && p_move_dir.x > 0);
-		  if (move_dir_different) {
-		      active_force = p_move_dir.x*fall_accelx/2.0f;
-		      net_force = active_force;
-		  }
-	      } else {
-		  if (is_key_down_x) {
-		      // player is slowing down, in that case, we allow this movement.
-		      b8 move_dir_opposite = (net_force > 0 && p_move_dir.x < 0) || (net_force < 0 && p_move_dir.x > 0);
-		      if (move_dir_opposite || ABS(net_force) < fall_accelx*0.15f)
-		      {
-			  active_force = p_move_dir.x*fall_accelx*timer.tDelta;
-			  net_force = clampf(net_force + active_force, -fall_accelx, fall_accelx);
-		      }
-		  } 
-		  if (ABS(net_force) >= fall_accelx) {
-		      // @note: air resistance 
-		      // (arbitrary force in opposite direction to reduce speed)
-		      // reason: seems that it would work well for the case where
-		      // player moves from platform move to free_fall
-		      // since the max speed in respective stages is different this can
-		      // function as a speed smoother, without too many checks and 
-		      // explicit checking
-		      b8 is_force_pos = state.effective_force > 0.0f;
-		      b8 is_force_neg = state.effective_force < 0.0f;
-		      r32 friction = 0.0f;
-		      if (is_force_pos) {
-			friction = -fall_accelx*timer.tDelta;
-		      } else if (is_force_neg) {
-			friction = fall_accelx*timer.tDelta;
-		      }
-		      net_force += friction;
-		  }
-	      }
-	    }
-	    state.effective_force = net_force;
-	  }
-	  
-	  {
-	    // horizontal motion setting
-	    r32 dx1 = state.effective_force;
-	    if ( dx1 == 0.0f ) {
-	      p_move_dir.x = 0.0f;
-	    }
-
-	    if (dx1 < 0.0f) {
-	      p_motion_dir.x = -1.0f;
-	    } else if (dx1 > 0.0f) {
-	      p_motion_dir.x = 1.0f;
-	    }
-	    state.player_velocity.x = dx1;
-	    pd_1.x = dx1;
-	  }
-
-	  {
-	    // vertical motion when falling
-	    r32 dy1 = state.player_velocity.y; 
-	    dy1 = dy1 + state.gravity_diry * freefall_accel * timer.tDelta;
-	    if (controller.jump) {
-	      dy1 = state.gravity_diry*jump_force;
-	      if (!collidey) {
-		  // if we are in the air, the jump force is 75% of normal
-		  dy1 = state.gravity_diry * jump_force * 0.75f;
-	      }
-	    }
-	    if (dy1 < state.gravity_diry * -0.01f) {
-	      p_motion_dir.y = -state.gravity_diry;
-	    } else if (dy1 > state.gravity_diry * 0.01f) {
-	      p_motion_dir.y = state.gravity_diry;
-	    }
-	    state.player_velocity.y = dy1;
-	    pd_1.y = dy1;
-	  }
-	}
-	else 
-	{
-	    // @no_clip_movement
-	    Vec2 dir = get_move_dir(controller);
-	    pd_1 = dir * 8.0f * render_scale.x;
-	    if (pd_1.x < 0.0f) {
-	      p_motion_dir.x = -1.0f;
-	    } else if (pd_1.x > 0.0f) {
-	      p_motion_dir.x = 1.0f;
-	    }
-	    if (pd_1.y < 0.0f) {
-	      p_motion_dir.y = -1.0f;
-	    } else if (pd_1.y > 0.0f) {
-	      p_motion_dir.y = 1.0f;
-	    }
-	}
-
-     
-	// @section: collision
-	Entity player = state.game_level.entities[state.player.index];
-	Vec3 next_player_position;
-	next_player_position.x = player.position.x + pd_1.x;
-	next_player_position.y = player.position.y + pd_1.y;
-
-	Rect player_next = rect(next_player_position.v2(), player.size);
-	
-	b8 is_collide_x = 0;
-	b8 is_collide_y = 0;
-	is_collide_bottom = 0;
-	is_collide_top = 0;
-
-	for (u32 i = 0; i < state.obstacles.size; i++) {
-	    // @step: check_obstacle_collisions
-
-	    // @func: check_if_player_colliding_with_target
-	    u32 index = state.obstacles.buffer[i].index;
-	    Entity e = state.game_level.entities[index];
-	    Rect target = e.bounds;
-
-	    b8 t_collide_x = 0;
-	    // need to adjust player position in case of vertical collisions
-	    // so need to check which player side collides
-	    b8 t_collide_bottom = 0;
-	    b8 t_collide_top = 0;
-
-	    r32 prev_left   = player.bounds.lb.x;
-	    r32 prev_bottom = player.bounds.lb.y;
-	    r32 prev_right  = player.bounds.rt.x;
-	    r32 prev_top    = player.bounds.rt.y;
-
-	    r32 p_left    = player_next.lb.x;
-	    r32 p_bottom  = player_next.lb.y;
-	    r32 p_right   = player_next.rt.x;
-	    r32 p_top     = player_next.rt.y;
-
-	    r32 t_left    = target.lb.x;
-	    r32 t_bottom  = target.lb.y;
-	    r32 t_right   = target.rt.x;
-	    r32 t_top     = target.rt.y;
-
-	    if (!is_collide_y) {
-		b8 prev_collide_x = !(prev_left > t_right || prev_right < t_left);
-		b8 new_collide_target_top = (p_bottom < t_top && p_top > t_top);
-		b8 new_collide_target_bottom = (p_top > t_bottom && p_bottom < t_bottom);
-		if (prev_collide_x && new_collide_target_top) {
-		  t_collide_top = 1;
-		}
-		if (prev_collide_x && new_collide_target_bottom) {
-		  t_collide_bottom = 1;
-		}
-	    }
-
-	    {
-		b8 prev_collide_y = !(prev_top < t_bottom + 0.2f || prev_bottom > t_top);
-		b8 new_collide_x = !(p_right < t_left || p_left > t_right);
-		if (prev_collide_y && new_collide_x) {
-		  t_collide_x = 1;
-		}
-	    }
-
-	    // @func: update_player_positions_if_sides_colliding
-	    if (t_collide_top) {
-	      player.position.y -= (prev_bottom - t_top - 0.1f);
-	    } else if (t_collide_bottom) {
-	      player.position.y += (t_bottom - prev_top - 0.1f);
-	    }
-
-	    if (e.type == INVERT_GRAVITY && (t_collide_x || t_collide_top || t_collide_bottom)) {
-		// @note: gravity inverter mechanic
-		// 1. touch block, gravity flips
-		// 2. for 2 second, after gravity is flipped, gravity will not be flipped 
-		// (this will collapse various cases where the player is trying to reflip gravity, 
-		// but immediate contact after flipping makes this awkward and infeasible)
-		if (state.gravity_flip_timer <= 0) {
-		    state.gravity_flip_timer = 500.0f;
-		    state.flip_gravity = 1;
-		}
-	    }
-
-	    is_collide_x = is_collide_x || t_collide_x;
-	    is_collide_y = is_collide_y || t_collide_top || t_collide_bottom;
-	    is_collide_bottom = is_collide_bottom || t_collide_top;
-	    is_collide_top = is_collide_top || t_collide_bottom;
-	}
-
-	if (!is_collide_x) {
-	  player.position.x = next_player_position.x;
-	}
-	if (!is_collide_y) {
-	  player.position.y = next_player_position.y;
-	}
-
-	// check collision with goal
-	{
-	    Entity goal = state.game_level.entities[state.goal.index];
-	    Rect target = goal.bounds;
-
-	    state.level_state = aabb_collision_rect(player_next, target);
+    // @step: get mouse world position, every frame since the camera moves without the mouse
+    IVec2 mouse_position_world;
+    mouse_position_world.x = state.mouse_position.x + (s32)renderer->cam_pos.x;
+    mouse_position_world.y = state.mouse_position.y + (s32)renderer->cam_pos.y;
+    // unrounded, for the line of sight ray
+    Vec2 mouse_world = Vec2{(r32)state.mouse_position.x, (r32)state.mouse_position.y} + renderer->cam_pos.v2();
+    // clamp mouse position based off of the grids we draw (this will make level object placement easier)
+    IVec2 mouse_position_clamped;
+    mouse_position_clamped.x = mouse_position_world.x - ((mouse_position_world.x) % (s32)(atom_size.x));
+    mouse_position_clamped.y = mouse_position_world.y - ((mouse_position_world.y) % (s32)(atom_size.y));
+
+    if (despawn_under_mouse && game_screen == GAMEPLAY) {
+	// @step: level editing, DELETE removes the obstacle under the mouse until the
+	// level is set up again. The level changes under the recording, so it ends here.
+	u32 index = find_obstacle_at(&state, mouse_world);
+	if (index != ENTITY_INVALID_INDEX) {
+	    end_recording(&recorder, &record_path, &state);
+	    despawn_level_entity(&state, &level_loader.collision_arena, entity_handle(&state.entity_store, index));
 	}
+    }
 
-	// @section: teleport
-	b8 inside_teleporter_now = 0;
-	b8 teleporting_now = state.teleporting;
-	Vec2 teleported_position = Vec2{player.position.x, player.position.y};
-	for (u32 i = 0; i < state.game_level.entity_count; i++) {
-	    /*
-	     * @note;
-	     * TELEPORT START ...
-	     * 1. go inside a teleport block, player marked as in block
-	     * 2. hit teleport block center, player marked as teleporting
-	     * 3. player teleported to new block
-	     * 4. once player exits the new block, player marked as in block false
-	     * 5. then player marked as teleporting false
-	     * ... TELEPORT COMPLETE
-	     */
-	    Entity e = state.game_level.entities[i];
-	    if (e.type != TELEPORT) {
-		continue;
-	    }
-
-	    Rect target = e.bounds;
-
-	    if (teleporting_now) {
-		// check if player is outside of this teleport block or not
-		b8 t_collide = aabb_collision_rect(player.bounds, target);
-		inside_teleporter_now |= t_collide;
-
-		continue;
-	    }
-	    // check if player is completely inside teleport block
-	    b8 t_collide = aabb_collision_rect(player.bounds, target);
-	    if (!t_collide) {
-		continue;
-	    }
-
-	    inside_teleporter_now |= t_collide;
-	    
-	    // check if player x-axis is within teleport x-axis
-	    Vec2 player_center = player.position.v2() + player.size/2.0f;
-	    Vec2 entity_center = e.position.v2() + e.size/2.0f;
-	    Vec2 displacement = player_center - entity_center;
-
-	    if (ABS(displacement.x) <= 5.0f*render_scale.x || ABS(displacement.y) <= 5.0f*render_scale.x) {
-		teleporting_now = 1;
-		{
-		    // @step: teleport_player
-		    Entity teleport_to = get_entity_by_id(state, e.link_id);
-		    Vec2 teleport_to_center = teleport_to.position.v2() + teleport_to.size/2.0f;
-		    // set next position
-		    Vec2 teleported_position_center = teleport_to_center + displacement;
-		    teleported_position = teleported_position_center - player.size/2.0f;
-		}
-	    }
-	}
-	{
-	    // update teleport variable
-	    state.inside_teleporter = inside_teleporter_now;
-	    state.teleporting = teleporting_now && state.inside_teleporter;
-	    if (state.teleporting) {
-		player.position.x = teleported_position.x;
-		player.position.y = teleported_position.y;
-	    }
+    if (state.level_file.size == 0) {
+	// @step: hot reload the active level when its file is saved, and parse the
+	// next one again if it is saved while prefetched. Only the level directory
+	// is watched, a level file is not.
+	Str256 level_file = str256(level_names[state.level_index]);
+	str_push256(&level_file, str256(".txt"));
+	s32 next_index = state.level_index + 1;
+	Str256 next_file = str256(next_index < level_count ? level_names[next_index] : "");
+	str_push256(&next_file, str256(".txt"));
+	const char *watched[2] = {level_file.buffer, next_index < level_count ? next_file.buffer : NULL};
+	u32 saved = level_watch_poll(&level_watcher, watched, 2);
+	if (saved & 1) {
+	    end_recording(&recorder, &record_path, &state);
+	    hot_reload_level(&state, &level_loader);
 	}
-	{
-	    state.gravity_flip_timer = MAX(state.gravity_flip_timer - timer.tDeltaMS, 0.0f);
+	if ((saved & 2) && level_loader.prefetch_index == next_index) {
+	    level_prefetch_cancel(&level_loader);
+	    level_prefetch_start(&level_loader, next_index);
 	}
+    }
 
-	{
-	    // @step: update player variables
-	    player.bounds = rect(player.position.v2(), player.size);
-	    was_colliding = collidex || collidey;
-	    collidex = is_collide_x;
-	    collidey = is_collide_y;
-
-	    state.game_level.entities[state.player.index] = player;
-	}
-
-	// @section: camera_update
-	{
-	    // camera movement and handling
-	    // Cases:
-	    // - A new level loads, the camera position needs to be on the player 
-	    // (part of level loading) [Focus on Player]
-	    // - Player is moving and camera needs to follow
-	    // - Player has stopped moving and camera needs to slowly adjust (linearly)
-	    // - Player teleports, camera needs to move to the player:
-	    //  - if player is within view camera needs to slowly adjust the player, 
-	    //  and pan linearly until player is in level focus
-	    //  - if player is out of camera view, jump 
-	    //  (linearly but slightly faster) to the player
-	    // - If player is outside, pan quickly (linearly) to player
-	    // - If player is at the boundary of a level, 
-	    // respect the level boundary and do not center the player. 
-	    //  Pan camera, up until the edge of the level boundary. 
-	    //  Do no move the camera beyond the level boundary.
-	    //
-	    //  Based off of these cases, this is the behavior I can see:
-	    //  1. Player is moving at the edges of the screen, follow.
-	    //  2. Player is stopped, pan slowly until player is in the focus region 
-	    //  (need to define focus region)
-	    //  3. Player is outside the screen, pan to player 
-	    //  (go from current camera position to player position linearly)
-
-	    // @step: player is at the edge of the screen
-	    // get players visible bounds (padding around the player to consider it be visible for the camera)
-	    Vec2 vis_lb = player.bounds.lb - (Vec2{120.0f, 60.0f} * state.render_scale.x);
-	    Vec2 vis_rt = player.bounds.rt + (Vec2{120.0f, 60.0f} * state.render_scale.y);
-	    Rect vis_bounds;
-	    vis_bounds.lb = vis_lb;
-	    vis_bounds.rt = vis_rt;
-	    Rect cam_bounds = state.camera_bounds;
-
-	    Vec2 camera_center = Vec2{state.camera_bounds.rt.x/2.0f, state.camera_bounds.rt.y/2.0f};
-	    Vec2 player_camera_offset = player.position.v2() - camera_center;
-	    // check if vis_bounds inside camera_bounds
-	    b8 is_player_in_camera = (
-		    vis_bounds.lb.x >= cam_bounds.lb.x && vis_bounds.lb.y >= cam_bounds.lb.y &&
-		    vis_bounds.rt.x <= cam_bounds.rt.x && vis_bounds.rt.y <= cam_bounds.rt.y
-	    );
-
-	    if (!is_player_in_camera) {
-		r32 stepx_multiplier = player_camera_offset.x < 0 ? -1.0f : 1.0f;
-		r32 stepy_multiplier = player_camera_offset.y < 0 ? -1.0f : 1.0f;
-
-		r32 camera_stepx = stepx_multiplier * MIN(ABS(player_camera_offset.x), camera_pan_slow.x);
-		r32 camera_stepy = stepy_multiplier * MIN(ABS(player_camera_offset.y), camera_pan_slow.y);
-
-		Vec2 distance_scaler;	    
-		{
-		    // @step: calculate distance scaler
-		    // @note: this is to help scale how quickly the camera needs to pan
-		    // this is based off of how far the player is from the camera position.
-		    // The reason this is discrete instead of continuous is to give better predictability
-		    // (at this stage)
-		    // @note: make this continuous, so it pans smoothly. Movement is jerky at step boundaries
-		    u32 dist_stepx = (u32)SDL_floorf(ABS(player_camera_offset.x) / 100);
-		    u32 dist_stepy = (u32)SDL_floorf(ABS(player_camera_offset.y) / 100);
-
-		    if (dist_stepx >= 0 && dist_stepx < 4) {
-			distance_scaler.x = 8.0f;
-		    } else if (dist_stepx >= 4 && dist_stepx < 8) {
-			distance_scaler.x = 6.0f;
-		    } else {
-			distance_scaler.x = 4.0f;
-		    }
-
-		    if (dist_stepy >= 0 && dist_stepy < 4) {
-			distance_scaler.y = 8.0f;
-		    } else if (dist_stepy >= 4 && dist_stepy < 8) {
-			distance_scaler.y = 6.0f;
-		    } else {
-			distance_scaler.y = 4.0f;
-		    }
-		}
-		renderer->cam_pos.x += camera_stepx*timer.tDeltaMS/distance_scaler.x;
-		renderer->cam_pos.y += camera_stepy*timer.tDeltaMS/distance_scaler.y;
-
-		renderer->cam_update = 1;
-	    }
-
-
-	    b8 player_moving_up = p_motion_dir.y == state.gravity_diry*1 && !is_collide_y;
-	    b8 player_moving_down = p_motion_dir.y == state.gravity_diry*-1 && !is_collide_y;
-
-	    player_camera_offset = player.position.v2() - renderer->cam_pos.v2();
-	    // @step: player moving at edges of the screen
-	    if (player_camera_offset.x <= cam_lt_limit.x && p_motion_dir.x == -1) {
-		renderer->cam_pos.x += pd_1.x;
-		renderer->cam_update = 1;
-	    }
-	    if (player_camera_offset.y >= cam_lt_limit.y && 
-		    player_moving_up) {
-		renderer->cam_pos.y += pd_1.y;
-		renderer->cam_update = 1;
+    if (game_screen == GAMEPLAY) {
+	// @section: fixed timestep, run the ticks the last frame covered
+	sim_accumulator += MIN(timer.tDelta, SIM_MAX_FRAME_SECONDS);
+	while (sim_accumulator >= SIM_TICK_SECONDS) {
+	    sim_accumulator -= SIM_TICK_SECONDS;
+
+	    state.previous_player_position = entity_position(&state.entity_store, state.player.index).v2();
+	    state.previous_cam_pos = renderer->cam_pos;
+	    if (replay_path && !replay_play_tick(&replay, &controller, key_down_time)) {
+		// the recorded run is over
+		game_running = 0;
+		break;
 	    }
-	    if (player_camera_offset.x >= cam_rb_limit.x && p_motion_dir.x == 1) {
-		renderer->cam_pos.x += pd_1.x;
-		renderer->cam_update = 1;
+	    if (record_path) {
+		replay_record_tick(&recorder, &controller, key_down_time);
 	    }
-	    if (player_camera_offset.y <= cam_rb_limit.y && 
-		    player_moving_down) {
-		renderer->cam_pos.y += pd_1.y;
-		renderer->cam_update = 1;
+	    game_tick(&state, &level_loader, &controller, key_down_time, tick_seconds);
+	    if (state.sim.teleported) {
+		state.previous_player_position = entity_position(&state.entity_store, state.player.index).v2();
 	    }
 
+	    // @section: camera_update
+	    follow_player_camera(&state, cam_lt_limit, cam_rb_limit, camera_pan_slow, SIM_TICK_SECONDS*1000.0);
 	}
+    } else {
+	// presses in the menus do not carry over into gameplay
+	controller.jump = 0;
+	controller.toggle_gravity = 0;
+	controller.flip_gravity = 0;
     }
 
+    Rect view_bounds = state.camera_bounds;
+    Vec2 player_render_position = entity_position(&state.entity_store, state.player.index).v2();
     {
 	// @step: update camera variables
 	if (renderer->cam_update == true) {
@@ -1555,6 +1902,23 @@ int main(int argc, char* argv[])
 		    );
 	    renderer->cam_update = false;
 	    state.camera_bounds = rect(renderer->cam_pos.v2(), camera_screen_size);
+	    view_bounds = state.camera_bounds;
+	}
+	if (game_screen == GAMEPLAY) {
+	    // @step: gameplay is drawn between the last two ticks, alpha of the way to the
+	    // last one, so motion stays smooth whatever the display rate is
+	    r32 alpha = (r32)(sim_accumulator/SIM_TICK_SECONDS);
+	    Vec3 view_position = renderer->cam_pos;
+	    view_position.x = state.previous_cam_pos.x + (renderer->cam_pos.x - state.previous_cam_pos.x)*alpha;
+	    view_position.y = state.previous_cam_pos.y + (renderer->cam_pos.y - state.previous_cam_pos.y)*alpha;
+	    renderer->cam_view = camera_create4m(
+		    view_position,
+		    add3v(view_position, renderer->cam_look),
+		    renderer->preset_up_dir
+		    );
+	    view_bounds = rect(view_position.v2(), camera_screen_size);
+	    player_render_position = state.previous_player_position +
+				     (player_render_position - state.previous_player_position)*alpha;
 	}
     }
     
@@ -1567,18 +1931,18 @@ int main(int argc, char* argv[])
     if (game_screen == GAMEPLAY) {
 	{
 	    // @step: draw vertical lines
-	    s32 line_index = (s32)state.camera_bounds.lb.x/atom_size.x;
-	    for (s32 x = state.camera_bounds.lb.x; x <= state.camera_bounds.rt.x; x += atom_size.x) {
+	    s32 line_index = (s32)view_bounds.lb.x/atom_size.x;
+	    for (s32 x = view_bounds.lb.x; x <= view_bounds.rt.x; x += atom_size.x) {
 		s32 offset = line_index*atom_size.x - x;
 		Vec3 start = Vec3{ 
 		    (r32)(x + offset), 
-		    state.camera_bounds.lb.y, 
-		    entity_z[DEBUG_LINE]
+		    view_bounds.lb.y, 
+		    state.entity_z[DEBUG_LINE]
 		};
 		Vec3 end = Vec3{
 		    (r32)(x + offset),
-		    state.camera_bounds.rt.y, 
-		    entity_z[DEBUG_LINE]
+		    view_bounds.rt.y, 
+		    state.entity_z[DEBUG_LINE]
 		};
 
 		gl_draw_line_batch(
@@ -1591,19 +1955,19 @@ int main(int argc, char* argv[])
 		line_index++;
 	    }
 
-	    line_index = (s32)state.camera_bounds.lb.y/atom_size.y;
+	    line_index = (s32)view_bounds.lb.y/atom_size.y;
 	    // @step: draw horizontal lines
-	    for (s32 y = state.camera_bounds.lb.y; y <= state.camera_bounds.rt.y; y += atom_size.x) {
+	    for (s32 y = view_bounds.lb.y; y <= view_bounds.rt.y; y += atom_size.x) {
 		s32 offset = line_index * atom_size.y - y;
 		Vec3 start = Vec3{
-		    state.camera_bounds.lb.x, 
+		    view_bounds.lb.x, 
 			(r32)(y + offset), 
-			entity_z[DEBUG_LINE]
+			state.entity_z[DEBUG_LINE]
 		};
 		Vec3 end = Vec3{
-		    state.camera_bounds.rt.x, 
+		    view_bounds.rt.x, 
 			(r32)(y + offset), 
-			entity_z[DEBUG_LINE]
+			state.entity_z[DEBUG_LINE]
 		};
 
 		gl_draw_line_batch(
@@ -1619,18 +1983,52 @@ int main(int argc, char* argv[])
 	}
 
 	// render_entities
-	for (int i = 0; i < state.game_level.entity_count; i++) {
-	    Entity entity = state.game_level.entities[i];
+	// @step: obstacles are drawn merged, one quad per collider
+	ColliderSet *colliders = &state.colliders;
+	for (u32 c = 0; c < colliders->count; c++) {
+	    if (!collider_is_alive(colliders, c)) {
+		continue;
+	    }
+	    Rect bounds = colliders->bounds[c];
+	    Vec2 size = bounds.rt - bounds.lb;
+	    Vec3 center = Vec3{
+		bounds.lb.x + size.x/2.0f,
+		bounds.lb.y + size.y/2.0f,
+		colliders->z[c]
+	    };
+	    gl_draw_colored_quad_optimized(
+		    &state.renderer,
+		    center,
+		    size,
+		    state.entity_colors[colliders->types[c]]
+	    );
+	}
+
+	EntityStore *store = &state.entity_store;
+	for (u32 i = 0; i < store->count; i++) {
+	    if (!entity_is_alive(store, i)) {
+		continue;
+	    }
+	    ENTITY_TYPE type = entity_type(store, i);
+	    if (type == OBSTACLE || type == INVERT_GRAVITY) {
+		continue;
+	    }
+	    Vec3 position = entity_position(store, i);
+	    if (i == state.player.index) {
+		position.x = player_render_position.x;
+		position.y = player_render_position.y;
+	    }
+	    Vec2 size = entity_size(store, i);
 	    Vec3 entity_center = Vec3{
-		entity.position.x + entity.size.x/2.0f,
-		entity.position.y + entity.size.y/2.0f, 
-		entity.position.z
+		position.x + size.x/2.0f,
+		position.y + size.y/2.0f, 
+		position.z
 	    };
-	    Vec3 color = entity_colors[entity.type];
+	    Vec3 color = state.entity_colors[type];
 	    gl_draw_colored_quad_optimized(
 		    &state.renderer,
 		    entity_center,
-		    entity.size,
+		    size,
 		    color
 	    );
 	}
@@ -1645,18 +2043,58 @@ int main(int argc, char* argv[])
 	sprintf(fmt_buffer, "frametime: %f", timer.tDelta);
 	gl_render_text(&state.renderer,
 		       fmt_buffer,
-		       Vec3{900.0f, 90.0f, entity_z[TEXT]},      // position
+		       Vec3{900.0f, 90.0f, state.entity_z[TEXT]},      // position
 		       Vec3{0.0f, 0.0f, 0.0f},
 		       28.0f*render_scale.x);   // color
 	
+	// @note: debug text rows are 40 apart, 0 and 40 (MouseX/MouseY, drawn last) are taken
 	sprintf(fmt_buffer, "GridX: %d, GridY: %d", mouse_position_clamped.x, mouse_position_clamped.y);
 	gl_render_text(
 		&state.renderer,
 		fmt_buffer,
-		Vec3{0.0f, 0.0f, entity_z[TEXT]},
+		Vec3{0.0f, 0.0f, state.entity_z[TEXT]},
 		Vec3{0.0f, 0.0f, 0.0f}, 
 		28.0f*render_scale.x);
 
+	{
+	    // @step: mouse picking, is the atom under the mouse solid and how far is the next wall
+	    s32 atom_x = (s32)SDL_floorf(mouse_position_clamped.x/atom_size.x);
+	    s32 atom_y = (s32)SDL_floorf(mouse_position_clamped.y/atom_size.y);
+	    b8 is_solid = occupancy_test(&state.occupancy, atom_x, atom_y);
+	    s32 wall_x = occupancy_find_right(&state.occupancy, atom_y, atom_x + 1);
+	    if (wall_x == OCCUPANCY_NOT_FOUND) {
+		snprintf(fmt_buffer, sizeof(fmt_buffer), "Solid: %d, Wall: none", is_solid);
+	    } else {
+		snprintf(fmt_buffer, sizeof(fmt_buffer), "Solid: %d, Wall: +%d", is_solid, wall_x - atom_x);
+	    }
+	    gl_render_text(
+		    &state.renderer,
+		    fmt_buffer,
+		    Vec3{0.0f, 80.0f, state.entity_z[TEXT]},
+		    Vec3{0.0f, 0.0f, 0.0f}, 
+		    28.0f*render_scale.x);
+	}
+
+	{
+	    // @step: line of sight, the first solid between the player and the mouse
+	    Vec2 eye = entity_position(store, state.player.index).v2() + entity_size(store, state.player.index)/2.0f;
+	    Vec2 to_mouse = mouse_world - eye;
+	    r32 mouse_distance = sqrtf(to_mouse.x*to_mouse.x + to_mouse.y*to_mouse.y);
+	    QueryHit hit;
+	    if (level_query_raycast(&state.level_query, &state.colliders, eye, to_mouse, mouse_distance,
+				    LEVEL_QUERY_SOLIDS, &hit)) {
+		snprintf(fmt_buffer, sizeof(fmt_buffer), "Sight: blocked at %d", (s32)hit.distance);
+	    } else {
+		snprintf(fmt_buffer, sizeof(fmt_buffer), "Sight: clear");
+	    }
+	    gl_render_text(
+		    &state.renderer,
+		    fmt_buffer,
+		    Vec3{0.0f, 120.0f, state.entity_z[TEXT]},
+		    Vec3{0.0f, 0.0f, 0.0f}, 
+		    28.0f*render_scale.x);
+	}
+
     } else {
 	    renderer->ui_cam.update = 1;
 
@@ -1667,19 +2105,19 @@ int main(int argc, char* argv[])
 	    button.bgd_color_pressed = Vec3{1.0f, 0.5f, 0.5f};
 
 	    button.text = str256("Resume");
-	    button.position = Vec3{10.0f, 40.0f, entity_z[TEXT]}; 
+	    button.position = Vec3{10.0f, 40.0f, state.entity_z[TEXT]}; 
 	    if (ui_button(state, button) == ButtonState::CLICK) {
 		game_screen = GAMEPLAY;
 	    }
 
 	    button.text = str256("Settings");
-	    button.position = Vec3{10.0f, 32.0f, entity_z[TEXT]};
+	    button.position = Vec3{10.0f, 32.0f, state.entity_z[TEXT]};
 	    if (ui_button(state, button) == ButtonState::CLICK) {
 		game_screen = SETTINGS_MENU;
 	    }
 
 	    button.text = str256("Quit");
-	    button.position = Vec3{10.0f, 24.0f, entity_z[TEXT]};
+	    button.position = Vec3{10.0f, 24.0f, state.entity_z[TEXT]};
 	    if (ui_button(state, button) == ButtonState::CLICK) {
 		game_running = 0;
 	    }
@@ -1689,15 +2127,15 @@ int main(int argc, char* argv[])
 		UiButton back_button = button;
 
 		back_button.text = str256("Apply");
-		back_button.position = Vec3{30.0f, 40.0f, entity_z[TEXT]};
+		back_button.position = Vec3{30.0f, 40.0f, state.entity_z[TEXT]};
 		gl_render_text(
 		    renderer, "Resolution", 
-		    Vec3{800, 800, entity_z[TEXT]}, 
+		    Vec3{800, 800, state.entity_z[TEXT]}, 
 		    Vec3{0.0f, 0.0f, 0.0f}, 24.0f*state.render_scale.y
 		);
 		{
 		    // @params
-		    Vec3 ms_value_pos = Vec3{1000.0f, 800.0f, entity_z[TEXT]};
+		    Vec3 ms_value_pos = Vec3{1000.0f, 800.0f, state.entity_z[TEXT]};
 		    Vec2 ms_value_size = Vec2{120.0f, 40.0f};
 
 		    Vec3 ms_value_pos_adjusted = ms_value_pos; 
@@ -1793,18 +2231,23 @@ int main(int argc, char* argv[])
     gl_render_text(
 	    &state.renderer,
 	    fmt_buffer,
-	    Vec3{0.0f, 40.0f, entity_z[TEXT]},
+	    Vec3{0.0f, 40.0f, state.entity_z[TEXT]},
 	    Vec3{0.0f, 0.0f, 0.0f}, 
 	    28.0f*render_scale.x);
 
     SDL_GL_SwapWindow(window);
 
     update_frame_timer(&timer);
-    enforce_frame_rate(&timer, 60);
+    if (frame_rate_cap > 0) {
+	enforce_frame_rate(&timer, frame_rate_cap);
+    }
   }
   
   //ma_engine_uninit(&engine);
-  free(level_mem);
+  end_recording(&recorder, &record_path, &state);
+  replay_close(&replay);
+  level_watch_close(&level_watcher);
+  level_loader_shutdown(&level_loader, &state);
   free(batch_memory);
   free(state.renderer.ui_text.transforms);
   free(state.renderer.ui_text.char_indexes);
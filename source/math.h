@@ -616,4 +616,49 @@ Mat4 camera_create4m(Vec3 camera_pos, Vec3 camera_look, Vec3 camera_up)
 	return res;
 }
 
+// ==== Rect ====
+struct Rect {
+  Vec2 lb;
+  Vec2 rt;
+};
+
+Rect rect(Vec2 position, Vec2 size) {
+  Rect r = {0};
+
+  r.lb.x = position.x;
+  r.lb.y = position.y;
+
+  r.rt.x = position.x + size.x;
+  r.rt.y = position.y + size.y;
+
+  return r;
+}
+
+b8 aabb_collision_rect(Rect a, Rect b) {
+    r32 a_left = a.lb.x;
+    r32 a_bottom = a.lb.y;
+    r32 a_right = a.rt.x;
+    r32 a_top = a.rt.y;
+
+    r32 b_left = b.lb.x;
+    r32 b_bottom = b.lb.y;
+    r32 b_right = b.rt.x;
+    r32 b_top = b.rt.y;
+
+    return !(
+	    a_left > b_right || a_right < b_left ||
+	    a_top < b_bottom || a_bottom > b_top);
+}
+
+// @description: smallest rect containing both a and b
+Rect rect_union(Rect a, Rect b) {
+  Rect r;
+  r.lb.x = MIN(a.lb.x, b.lb.x);
+  r.lb.y = MIN(a.lb.y, b.lb.y);
+  r.rt.x = MAX(a.rt.x, b.rt.x);
+  r.rt.y = MAX(a.rt.y, b.rt.y);
+
+  return r;
+}
+
 #endif
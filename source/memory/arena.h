@@ -1,6 +1,7 @@
 #pragma once
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include "../core.h"
 
@@ -22,6 +23,7 @@ uintptr_t align_forward(uintptr_t ptr, uintptr_t alignment);
 void arena_init(Arena* a, unsigned char *memory, size_t capacity);
 void* arena_alloc(Arena* a, size_t size);
 void arena_clear(Arena* a);
+void arena_reserve(Arena* a, size_t capacity);
 
 
 // implementation
@@ -80,3 +82,16 @@ void arena_clear(Arena* a) {
   a->curr_offset = 0;
   a->prev_offset = 0;
 }
+
+// @note: only for arenas whose buffer came from malloc. Growing moves the buffer,
+// so this is only allowed on an empty arena (right after arena_clear).
+void arena_reserve(Arena* a, size_t capacity) {
+  assert(a->curr_offset == 0);
+  if (capacity <= a->capacity) {
+    return;
+  }
+
+  a->buffer = (unsigned char*)realloc(a->buffer, capacity);
+  assert(a->buffer != NULL);
+  a->capacity = capacity;
+}
@@ -0,0 +1,376 @@
+#include "aabb_tree.h"
+
+// deep enough for any tree that fits in memory, AVL keeps the height at about 1.44*log2(n)
+#define AABB_TREE_STACK_SIZE 128
+
+static inline r32 aabb_perimeter(Rect r) {
+  return 2.0f*((r.rt.x - r.lb.x) + (r.rt.y - r.lb.y));
+}
+
+static inline b8 aabb_contains(Rect outer, Rect inner) {
+  return outer.lb.x <= inner.lb.x && outer.lb.y <= inner.lb.y &&
+	 outer.rt.x >= inner.rt.x && outer.rt.y >= inner.rt.y;
+}
+
+static inline b8 aabb_tree_is_leaf(AabbTreeNode *node) {
+  return node->left == AABB_TREE_NULL;
+}
+
+size_t aabb_tree_size(u32 proxy_capacity) {
+  return (2*(size_t)proxy_capacity)*sizeof(AabbTreeNode) + ALIGNMENT;
+}
+
+void aabb_tree_init(AabbTree *tree, Arena *arena, u32 proxy_capacity, Vec2 margin) {
+  // a tree with n leaves has n - 1 inner nodes
+  tree->node_capacity = (s32)(2*proxy_capacity);
+  tree->nodes = (AabbTreeNode*)arena_alloc(arena, tree->node_capacity*sizeof(AabbTreeNode));
+  tree->root = AABB_TREE_NULL;
+  tree->proxy_count = 0;
+  tree->margin = margin;
+  tree->free_list = tree->node_capacity > 0 ? 0 : AABB_TREE_NULL;
+  for (s32 i = 0; i < tree->node_capacity; i++) {
+    tree->nodes[i].parent = i + 1 < tree->node_capacity ? i + 1 : AABB_TREE_NULL;
+    tree->nodes[i].height = -1;
+  }
+}
+
+static s32 aabb_tree_alloc_node(AabbTree *tree) {
+  SDL_assert(tree->free_list != AABB_TREE_NULL);
+  s32 index = tree->free_list;
+  AabbTreeNode *node = &tree->nodes[index];
+  tree->free_list = node->parent;
+  node->parent = AABB_TREE_NULL;
+  node->left = AABB_TREE_NULL;
+  node->right = AABB_TREE_NULL;
+  node->height = 0;
+  node->user = 0;
+  return index;
+}
+
+static void aabb_tree_free_node(AabbTree *tree, s32 index) {
+  tree->nodes[index].parent = tree->free_list;
+  tree->nodes[index].height = -1;
+  tree->free_list = index;
+}
+
+// @description: AVL rotation, if node a is out of balance its taller child
+// is rotated up in its place. Returns the index of the subtree's new root.
+static s32 aabb_tree_balance(AabbTree *tree, s32 ia) {
+  AabbTreeNode *a = &tree->nodes[ia];
+  if (aabb_tree_is_leaf(a) || a->height < 2) {
+    return ia;
+  }
+  s32 ib = a->left;
+  s32 ic = a->right;
+  AabbTreeNode *b = &tree->nodes[ib];
+  AabbTreeNode *c = &tree->nodes[ic];
+  s32 balance = c->height - b->height;
+
+  if (balance > 1) {
+    // rotate c up
+    s32 i_f = c->left;
+    s32 i_g = c->right;
+    AabbTreeNode *f = &tree->nodes[i_f];
+    AabbTreeNode *g = &tree->nodes[i_g];
+
+    c->left = ia;
+    c->parent = a->parent;
+    a->parent = ic;
+    if (c->parent != AABB_TREE_NULL) {
+      AabbTreeNode *p = &tree->nodes[c->parent];
+      if (p->left == ia) {
+	p->left = ic;
+      } else {
+	p->right = ic;
+      }
+    } else {
+      tree->root = ic;
+    }
+
+    if (f->height > g->height) {
+      c->right = i_f;
+      a->right = i_g;
+      g->parent = ia;
+      a->box = rect_union(b->box, g->box);
+      c->box = rect_union(a->box, f->box);
+      a->height = 1 + MAX(b->height, g->height);
+      c->height = 1 + MAX(a->height, f->height);
+    } else {
+      c->right = i_g;
+      a->right = i_f;
+      f->parent = ia;
+      a->box = rect_union(b->box, f->box);
+      c->box = rect_union(a->box, g->box);
+      a->height = 1 + MAX(b->height, f->height);
+      c->height = 1 + MAX(a->height, g->height);
+    }
+    return ic;
+  }
+
+  if (balance < -1) {
+    // rotate b up
+    s32 i_d = b->left;
+    s32 i_e = b->right;
+    AabbTreeNode *d = &tree->nodes[i_d];
+    AabbTreeNode *e = &tree->nodes[i_e];
+
+    b->left = ia;
+    b->parent = a->parent;
+    a->parent = ib;
+    if (b->parent != AABB_TREE_NULL) {
+      AabbTreeNode *p = &tree->nodes[b->parent];
+      if (p->left == ia) {
+	p->left = ib;
+      } else {
+	p->right = ib;
+      }
+    } else {
+      tree->root = ib;
+    }
+
+    if (d->height > e->height) {
+      b->right = i_d;
+      a->left = i_e;
+      e->parent = ia;
+      a->box = rect_union(c->box, e->box);
+      b->box = rect_union(a->box, d->box);
+      a->height = 1 + MAX(c->height, e->height);
+      b->height = 1 + MAX(a->height, d->height);
+    } else {
+      b->right = i_e;
+      a->left = i_d;
+      d->parent = ia;
+      a->box = rect_union(c->box, d->box);
+      b->box = rect_union(a->box, e->box);
+      a->height = 1 + MAX(c->height, d->height);
+      b->height = 1 + MAX(a->height, e->height);
+    }
+    return ib;
+  }
+
+  return ia;
+}
+
+// @description: refits boxes and heights from index up to the root, rebalancing on the way
+static void aabb_tree_refit(AabbTree *tree, s32 index) {
+  while (index != AABB_TREE_NULL) {
+    index = aabb_tree_balance(tree, index);
+    AabbTreeNode *node = &tree->nodes[index];
+    AabbTreeNode *left = &tree->nodes[node->left];
+    AabbTreeNode *right = &tree->nodes[node->right];
+    node->height = 1 + MAX(left->height, right->height);
+    node->box = rect_union(left->box, right->box);
+    index = node->parent;
+  }
+}
+
+static void aabb_tree_insert_leaf(AabbTree *tree, s32 leaf) {
+  if (tree->root == AABB_TREE_NULL) {
+    tree->root = leaf;
+    tree->nodes[leaf].parent = AABB_TREE_NULL;
+    return;
+  }
+
+  // @step: find the best sibling, descending while it is cheaper (surface area
+  // heuristic, perimeter in 2d) to push the leaf further down
+  Rect leaf_box = tree->nodes[leaf].box;
+  s32 index = tree->root;
+  while (!aabb_tree_is_leaf(&tree->nodes[index])) {
+    AabbTreeNode *node = &tree->nodes[index];
+    r32 area = aabb_perimeter(node->box);
+    r32 combined_area = aabb_perimeter(rect_union(node->box, leaf_box));
+    // cost of making a new parent for this node and the leaf
+    r32 cost = 2.0f*combined_area;
+    // minimum cost of pushing the leaf further down
+    r32 inheritance_cost = 2.0f*(combined_area - area);
+
+    r32 child_cost[2];
+    s32 children[2] = {node->left, node->right};
+    for (u32 i = 0; i < 2; i++) {
+      AabbTreeNode *child = &tree->nodes[children[i]];
+      r32 new_area = aabb_perimeter(rect_union(leaf_box, child->box));
+      if (aabb_tree_is_leaf(child)) {
+	child_cost[i] = new_area + inheritance_cost;
+      } else {
+	child_cost[i] = (new_area - aabb_perimeter(child->box)) + inheritance_cost;
+      }
+    }
+    if (cost < child_cost[0] && cost < child_cost[1]) {
+      break;
+    }
+    index = child_cost[0] < child_cost[1] ? children[0] : children[1];
+  }
+  s32 sibling = index;
+
+  // @step: new parent for the sibling and the leaf
+  s32 old_parent = tree->nodes[sibling].parent;
+  s32 new_parent = aabb_tree_alloc_node(tree);
+  AabbTreeNode *parent = &tree->nodes[new_parent];
+  parent->parent = old_parent;
+  parent->box = rect_union(leaf_box, tree->nodes[sibling].box);
+  parent->height = tree->nodes[sibling].height + 1;
+  parent->left = sibling;
+  parent->right = leaf;
+  if (old_parent != AABB_TREE_NULL) {
+    AabbTreeNode *p = &tree->nodes[old_parent];
+    if (p->left == sibling) {
+      p->left = new_parent;
+    } else {
+      p->right = new_parent;
+    }
+  } else {
+    tree->root = new_parent;
+  }
+  tree->nodes[sibling].parent = new_parent;
+  tree->nodes[leaf].parent = new_parent;
+
+  aabb_tree_refit(tree, new_parent);
+}
+
+static void aabb_tree_remove_leaf(AabbTree *tree, s32 leaf) {
+  if (leaf == tree->root) {
+    tree->root = AABB_TREE_NULL;
+    return;
+  }
+  s32 parent = tree->nodes[leaf].parent;
+  s32 grand_parent = tree->nodes[parent].parent;
+  s32 sibling = tree->nodes[parent].left == leaf ? tree->nodes[parent].right : tree->nodes[parent].left;
+
+  if (grand_parent != AABB_TREE_NULL) {
+    // the sibling takes the parent's place
+    AabbTreeNode *g = &tree->nodes[grand_parent];
+    if (g->left == parent) {
+      g->left = sibling;
+    } else {
+      g->right = sibling;
+    }
+    tree->nodes[sibling].parent = grand_parent;
+    aabb_tree_free_node(tree, parent);
+    aabb_tree_refit(tree, grand_parent);
+  } else {
+    tree->root = sibling;
+    tree->nodes[sibling].parent = AABB_TREE_NULL;
+    aabb_tree_free_node(tree, parent);
+  }
+}
+
+static Rect aabb_tree_fatten(AabbTree *tree, Rect box) {
+  box.lb = box.lb - tree->margin;
+  box.rt = box.rt + tree->margin;
+  return box;
+}
+
+// @description: adds a proxy for box, returns its id
+s32 aabb_tree_insert(AabbTree *tree, Rect box, u32 user) {
+  s32 proxy = aabb_tree_alloc_node(tree);
+  tree->nodes[proxy].box = aabb_tree_fatten(tree, box);
+  tree->nodes[proxy].user = user;
+  aabb_tree_insert_leaf(tree, proxy);
+  tree->proxy_count++;
+  return proxy;
+}
+
+void aabb_tree_remove(AabbTree *tree, s32 proxy) {
+  SDL_assert(proxy >= 0 && proxy < tree->node_capacity && aabb_tree_is_leaf(&tree->nodes[proxy]));
+  aabb_tree_remove_leaf(tree, proxy);
+  aabb_tree_free_node(tree, proxy);
+  tree->proxy_count--;
+}
+
+// @description: updates a proxy after its body moved by displacement to box.
+// Returns 1 if the box left the fat box and the proxy was reinserted.
+b8 aabb_tree_move(AabbTree *tree, s32 proxy, Rect box, Vec2 displacement) {
+  SDL_assert(proxy >= 0 && proxy < tree->node_capacity && aabb_tree_is_leaf(&tree->nodes[proxy]));
+  if (aabb_contains(tree->nodes[proxy].box, box)) {
+    return 0;
+  }
+  aabb_tree_remove_leaf(tree, proxy);
+
+  // @note: stretch the fat box in the direction of motion, a body moving at a
+  // steady speed then stays inside it for a few frames
+  Rect fat = aabb_tree_fatten(tree, box);
+  Vec2 d = displacement*AABB_TREE_DISPLACEMENT_MULTIPLIER;
+  if (d.x < 0.0f) {
+    fat.lb.x += d.x;
+  } else {
+    fat.rt.x += d.x;
+  }
+  if (d.y < 0.0f) {
+    fat.lb.y += d.y;
+  } else {
+    fat.rt.y += d.y;
+  }
+  tree->nodes[proxy].box = fat;
+  aabb_tree_insert_leaf(tree, proxy);
+  return 1;
+}
+
+Rect aabb_tree_fat_box(AabbTree *tree, s32 proxy) {
+  return tree->nodes[proxy].box;
+}
+
+// @description: user values of the proxies whose fat box overlaps box (edges included).
+// Returns the number of overlaps, only the first out_capacity are written.
+u32 aabb_tree_query(AabbTree *tree, Rect box, u32 *out, u32 out_capacity) {
+  if (tree->root == AABB_TREE_NULL) {
+    return 0;
+  }
+  s32 stack[AABB_TREE_STACK_SIZE];
+  u32 stack_size = 0;
+  stack[stack_size++] = tree->root;
+
+  u32 count = 0;
+  while (stack_size > 0) {
+    AabbTreeNode *node = &tree->nodes[stack[--stack_size]];
+    if (!aabb_collision_rect(node->box, box)) {
+      continue;
+    }
+    if (aabb_tree_is_leaf(node)) {
+      if (count < out_capacity) {
+	out[count] = node->user;
+      }
+      count++;
+    } else {
+      SDL_assert(stack_size + 2 <= AABB_TREE_STACK_SIZE);
+      stack[stack_size++] = node->left;
+      stack[stack_size++] = node->right;
+    }
+  }
+  return count;
+}
+
+// @description: every pair of proxies with overlapping fat boxes, reported once.
+// Returns the number of pairs, only the first out_capacity are written.
+u32 aabb_tree_pairs(AabbTree *tree, AabbTreePair *out, u32 out_capacity) {
+  u32 count = 0;
+  for (s32 leaf = 0; leaf < tree->node_capacity; leaf++) {
+    AabbTreeNode *a = &tree->nodes[leaf];
+    if (a->height != 0) {
+      continue;
+    }
+    s32 stack[AABB_TREE_STACK_SIZE];
+    u32 stack_size = 0;
+    stack[stack_size++] = tree->root;
+    while (stack_size > 0) {
+      s32 index = stack[--stack_size];
+      AabbTreeNode *node = &tree->nodes[index];
+      if (!aabb_collision_rect(node->box, a->box)) {
+	continue;
+      }
+      if (aabb_tree_is_leaf(node)) {
+	// the pair is found from both leaves, keep the one from the lower index
+	if (index > leaf) {
+	  if (count < out_capacity) {
+	    out[count] = AabbTreePair{a->user, node->user};
+	  }
+	  count++;
+	}
+      } else {
+	SDL_assert(stack_size + 2 <= AABB_TREE_STACK_SIZE);
+	stack[stack_size++] = node->left;
+	stack[stack_size++] = node->right;
+      }
+    }
+  }
+  return count;
+}
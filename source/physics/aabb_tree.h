@@ -0,0 +1,50 @@
+#pragma once
+
+#include "../core.h"
+#include "../math.h"
+#include "../memory/arena.h"
+
+#define AABB_TREE_NULL -1
+// moving proxies get their fat box stretched this many frames ahead along their displacement
+#define AABB_TREE_DISPLACEMENT_MULTIPLIER 2.0f
+
+// @note: incrementally updated bounding volume hierarchy for moving bodies.
+// Leaves hold a fat box (the body's box grown by margin), a body that stays
+// inside its fat box does not touch the tree when it moves. Inner nodes are
+// rebalanced with AVL rotations on the way up from every insert and remove, so
+// insert, remove and move are O(log n) in practice. It is not strictly AVL: a
+// leaf the surface area heuristic puts next to a tall subtree can leave a node
+// whose children differ in height by more than one.
+// Nodes live in a fixed pool allocated from an arena, freed nodes are chained
+// through `parent`.
+struct AabbTreeNode {
+    Rect box;
+    s32 parent;		// next free node while the node is on the free list
+    s32 left;		// AABB_TREE_NULL for leaves
+    s32 right;
+    s32 height;		// 0 for leaves, -1 for free nodes
+    u32 user;		// leaves only, e.g. an entity slot
+};
+
+struct AabbTree {
+    AabbTreeNode *nodes;
+    s32 node_capacity;
+    s32 root;
+    s32 free_list;
+    u32 proxy_count;
+    Vec2 margin;
+};
+
+struct AabbTreePair {
+    u32 user_a;
+    u32 user_b;
+};
+
+size_t aabb_tree_size(u32 proxy_capacity);
+void aabb_tree_init(AabbTree *tree, Arena *arena, u32 proxy_capacity, Vec2 margin);
+s32 aabb_tree_insert(AabbTree *tree, Rect box, u32 user);
+void aabb_tree_remove(AabbTree *tree, s32 proxy);
+b8 aabb_tree_move(AabbTree *tree, s32 proxy, Rect box, Vec2 displacement);
+Rect aabb_tree_fat_box(AabbTree *tree, s32 proxy);
+u32 aabb_tree_query(AabbTree *tree, Rect box, u32 *out, u32 out_capacity);
+u32 aabb_tree_pairs(AabbTree *tree, AabbTreePair *out, u32 out_capacity);
@@ -0,0 +1,263 @@
+#include "colliders.h"
+
+static const ENTITY_TYPE collider_types[] = {OBSTACLE, INVERT_GRAVITY};
+static const u32 collider_type_count = sizeof(collider_types)/sizeof(collider_types[0]);
+
+// @note: merge scratch, a rect and the chain of slots it was made from
+// (linked through next_source). Rects merged into another one are marked COLLIDER_DEAD.
+struct ColliderWork {
+  Rect box;
+  u32 type;
+  u32 head;
+  u32 tail;
+  u32 first_slot;
+};
+
+// @note: sort key of a work rect for a merge pass. The high half is a hash of
+// the run it can merge into (type and span on the other axis), the low half
+// orders the run along the merge axis. Runs that collide in the hash can
+// interleave and miss a merge, the result is still exact.
+struct ColliderSortKey {
+  u64 key;
+  u32 work;
+};
+
+static u32 collider_obstacle_count(EntityStore *store) {
+  u32 count = 0;
+  for (u32 t = 0; t < collider_type_count; t++) {
+    count += entity_query(store, collider_types[t]).count;
+  }
+  return count;
+}
+
+// @description: arena space collider_set_build takes for the obstacles of store
+size_t collider_set_size(EntityStore *store) {
+  size_t capacity = (size_t)collider_obstacle_count(store) + ENTITY_SPAWN_RESERVE;
+  return capacity*(sizeof(Rect) + sizeof(u8) + sizeof(r32) + 2*sizeof(u32)) + sizeof(u32) + 5*ALIGNMENT;
+}
+
+static inline u32 collider_r32_bits(r32 value) {
+  // + 0.0f turns -0 into 0, so both hash and sort the same
+  value += 0.0f;
+  u32 bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+// @description: r32 bits that sort in the same order as the values
+static inline u32 collider_r32_sortable(r32 value) {
+  u32 bits = collider_r32_bits(value);
+  return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+static inline u32 collider_run_hash(ColliderWork *w, u32 other) {
+  u32 h = w->type*0x9E3779B1u;
+  h = (h ^ collider_r32_bits(w->box.lb.data[other]))*0x85EBCA77u;
+  h = (h ^ collider_r32_bits(w->box.rt.data[other]))*0xC2B2AE3Du;
+  return h ^ (h >> 16);
+}
+
+// @description: LSD radix sort on the 64 bit keys, 8 bits per pass. Passes where
+// every key has the same digit are skipped.
+static void collider_radix_sort(ColliderSortKey *keys, ColliderSortKey *scratch, u32 count) {
+  ColliderSortKey *from = keys;
+  ColliderSortKey *to = scratch;
+  for (u32 shift = 0; shift < 64; shift += 8) {
+    u32 offsets[256];
+    memset(offsets, 0, sizeof(offsets));
+    for (u32 i = 0; i < count; i++) {
+      offsets[(from[i].key >> shift) & 0xFF]++;
+    }
+    if (count == 0 || offsets[(from[0].key >> shift) & 0xFF] == count) {
+      continue;
+    }
+    u32 sum = 0;
+    for (u32 d = 0; d < 256; d++) {
+      u32 size = offsets[d];
+      offsets[d] = sum;
+      sum += size;
+    }
+    for (u32 i = 0; i < count; i++) {
+      to[offsets[(from[i].key >> shift) & 0xFF]++] = from[i];
+    }
+    ColliderSortKey *swap = from;
+    from = to;
+    to = swap;
+  }
+  if (from != keys) {
+    memcpy(keys, from, count*sizeof(ColliderSortKey));
+  }
+}
+
+// @description: LSD radix sort of collider indices below index_limit, 8 bits per
+// pass like collider_radix_sort. Only the digits an index can have are sorted and
+// passes where every index has the same digit are skipped. Returns values or
+// scratch, whichever holds the sorted indices.
+u32 *collider_index_sort(u32 *values, u32 *scratch, u32 count, u32 index_limit) {
+  u32 *from = values;
+  u32 *to = scratch;
+  u32 max_index = index_limit > 0 ? index_limit - 1 : 0;
+  for (u32 shift = 0; shift < 32 && (max_index >> shift) > 0; shift += 8) {
+    u32 offsets[256];
+    memset(offsets, 0, sizeof(offsets));
+    for (u32 i = 0; i < count; i++) {
+      offsets[(from[i] >> shift) & 0xFF]++;
+    }
+    if (count == 0 || offsets[(from[0] >> shift) & 0xFF] == count) {
+      continue;
+    }
+    u32 sum = 0;
+    for (u32 d = 0; d < 256; d++) {
+      u32 size = offsets[d];
+      offsets[d] = sum;
+      sum += size;
+    }
+    for (u32 i = 0; i < count; i++) {
+      to[offsets[(from[i] >> shift) & 0xFF]++] = from[i];
+    }
+    u32 *swap = from;
+    from = to;
+    to = swap;
+  }
+  return from;
+}
+
+// @description: merges rects along axis (0: x, 1: y) that have the same type and the
+// same span on the other axis and touch or overlap. The union of such a run is
+// exactly a rect, so merging never adds area. Merged rects grow in place, the
+// rects merged into them are marked dead.
+static void collider_merge_pass(ColliderWork *work, u32 count, ColliderSortKey *keys, ColliderSortKey *scratch,
+				u32 *next_source, u32 axis) {
+  u32 other = 1 - axis;
+  u32 key_count = 0;
+  for (u32 i = 0; i < count; i++) {
+    if (work[i].type == COLLIDER_DEAD) {
+      continue;
+    }
+    u64 key = ((u64)collider_run_hash(&work[i], other) << 32) | collider_r32_sortable(work[i].box.lb.data[axis]);
+    keys[key_count++] = ColliderSortKey{key, i};
+  }
+  collider_radix_sort(keys, scratch, key_count);
+
+  ColliderWork *run = NULL;
+  for (u32 k = 0; k < key_count; k++) {
+    ColliderWork *w = &work[keys[k].work];
+    if (run != NULL && run->type == w->type &&
+	run->box.lb.data[other] == w->box.lb.data[other] &&
+	run->box.rt.data[other] == w->box.rt.data[other] &&
+	w->box.lb.data[axis] <= run->box.rt.data[axis]) {
+      run->box.rt.data[axis] = MAX(run->box.rt.data[axis], w->box.rt.data[axis]);
+      next_source[run->tail] = w->head;
+      run->tail = w->tail;
+      run->first_slot = MIN(run->first_slot, w->first_slot);
+      w->type = COLLIDER_DEAD;
+      continue;
+    }
+    run = w;
+  }
+}
+
+// @description: merges the obstacles of store into colliders, the arena needs
+// collider_set_size bytes of room. Rows of touching obstacles are merged first,
+// then runs of rows with the same x span, a greedy cover that is exact but not
+// always the fewest rects. Colliders are ordered by their lowest source slot,
+// so the collision pass visits them in about the order it visited the obstacles.
+void collider_set_build(ColliderSet *set, Arena *arena, EntityStore *store) {
+  u32 obstacle_count = collider_obstacle_count(store);
+  set->count = 0;
+  set->capacity = obstacle_count + ENTITY_SPAWN_RESERVE;
+  set->bounds = (Rect*)arena_alloc(arena, set->capacity*sizeof(Rect));
+  set->types = (u8*)arena_alloc(arena, set->capacity*sizeof(u8));
+  set->z = (r32*)arena_alloc(arena, set->capacity*sizeof(r32));
+  set->source_offsets = (u32*)arena_alloc(arena, (set->capacity + 1)*sizeof(u32));
+  set->source_slots = (u32*)arena_alloc(arena, set->capacity*sizeof(u32));
+  set->source_offsets[0] = 0;
+  if (obstacle_count == 0) {
+    return;
+  }
+
+  // @note: the merge scratch is only needed here, it does not stay in the arena
+  ColliderWork *work = (ColliderWork*)malloc(obstacle_count*sizeof(ColliderWork));
+  ColliderSortKey *keys = (ColliderSortKey*)malloc(2*(size_t)obstacle_count*sizeof(ColliderSortKey));
+  u32 *next_source = (u32*)malloc(store->capacity*sizeof(u32));
+  SDL_assert(work != NULL && keys != NULL && next_source != NULL);
+
+  u32 work_count = 0;
+  for (u32 t = 0; t < collider_type_count; t++) {
+    EntityQuery obstacles = entity_query(store, collider_types[t]);
+    for (u32 k = 0; k < obstacles.count; k++) {
+      u32 slot = obstacles.indices[k];
+      next_source[slot] = ENTITY_INVALID_INDEX;
+      work[work_count++] = ColliderWork{entity_bounds(store, slot), (u32)collider_types[t], slot, slot, slot};
+    }
+  }
+
+  // @step: rows, then columns of rows
+  collider_merge_pass(work, work_count, keys, keys + obstacle_count, next_source, 0);
+  collider_merge_pass(work, work_count, keys, keys + obstacle_count, next_source, 1);
+
+  // @step: order by lowest source slot, slots are unique so this is a scatter
+  // into a slot indexed table
+  free(keys);
+  u32 *by_slot = (u32*)malloc(store->capacity*sizeof(u32));
+  SDL_assert(by_slot != NULL);
+  for (u32 slot = 0; slot < store->capacity; slot++) {
+    by_slot[slot] = ENTITY_INVALID_INDEX;
+  }
+  for (u32 i = 0; i < work_count; i++) {
+    if (work[i].type != COLLIDER_DEAD) {
+      by_slot[work[i].first_slot] = i;
+    }
+  }
+
+  u32 source_count = 0;
+  for (u32 slot = 0; slot < store->capacity; slot++) {
+    if (by_slot[slot] == ENTITY_INVALID_INDEX) {
+      continue;
+    }
+    ColliderWork *w = &work[by_slot[slot]];
+    u32 c = set->count++;
+    set->bounds[c] = w->box;
+    set->types[c] = (u8)w->type;
+    set->z[c] = entity_position(store, w->first_slot).z;
+    for (u32 source = w->head; source != ENTITY_INVALID_INDEX; source = next_source[source]) {
+      set->source_slots[source_count++] = source;
+    }
+    set->source_offsets[c + 1] = source_count;
+  }
+
+  free(by_slot);
+  free(next_source);
+  free(work);
+}
+
+// @description: an obstacle spawned after the set was built, returns its collider
+u32 collider_set_add(ColliderSet *set, EntityStore *store, u32 slot) {
+  SDL_assert(set->count < set->capacity);
+  if (set->count >= set->capacity) {
+    return ENTITY_INVALID_INDEX;
+  }
+  u32 c = set->count++;
+  u32 source_begin = set->source_offsets[c];
+  set->bounds[c] = entity_bounds(store, slot);
+  set->types[c] = (u8)entity_type(store, slot);
+  set->z[c] = entity_position(store, slot).z;
+  set->source_slots[source_begin] = slot;
+  set->source_offsets[c + 1] = source_begin + 1;
+  return c;
+}
+
+// @description: the live collider made from slot, ENTITY_INVALID_INDEX if there is none. O(n)
+u32 collider_set_find(ColliderSet *set, u32 slot) {
+  for (u32 c = 0; c < set->count; c++) {
+    if (!collider_is_alive(set, c)) {
+      continue;
+    }
+    for (u32 s = set->source_offsets[c]; s < set->source_offsets[c + 1]; s++) {
+      if (set->source_slots[s] == slot) {
+	return c;
+      }
+    }
+  }
+  return ENTITY_INVALID_INDEX;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "../core.h"
+#include "../math.h"
+#include "../memory/arena.h"
+#include "../entity/entity_store.h"
+
+#define COLLIDER_DEAD 0xFF
+
+// @note: the level's obstacles (OBSTACLE and INVERT_GRAVITY) as the rects the
+// collision pass tests and the renderer draws. Touching obstacles of the same
+// type are merged when the level is bound: a floor authored as 40 unit blocks
+// is one collider and one quad. The entity store keeps the original entities
+// for editing and hot reload, each collider lists the slots it was made from:
+// source_slots[source_offsets[c], source_offsets[c + 1]).
+// Obstacles spawned at runtime are appended unmerged.
+struct ColliderSet {
+    u32 count;
+    u32 capacity;
+    Rect *bounds;
+    u8 *types;		// ENTITY_TYPE, COLLIDER_DEAD once despawned
+    r32 *z;		// render depth
+    u32 *source_offsets;
+    u32 *source_slots;
+};
+
+struct ColliderQuery {
+    const u32 *indices;
+    u32 count;
+};
+
+size_t collider_set_size(EntityStore *store);
+void collider_set_build(ColliderSet *set, Arena *arena, EntityStore *store);
+u32 collider_set_add(ColliderSet *set, EntityStore *store, u32 slot);
+u32 collider_set_find(ColliderSet *set, u32 slot);
+u32 *collider_index_sort(u32 *values, u32 *scratch, u32 count, u32 index_limit);
+
+inline u32 collider_source_count(ColliderSet *set, u32 collider) {
+    return set->source_offsets[collider + 1] - set->source_offsets[collider];
+}
+
+inline b8 collider_is_alive(ColliderSet *set, u32 collider) {
+    return set->types[collider] != COLLIDER_DEAD;
+}
@@ -0,0 +1,200 @@
+#include "collision_grid.h"
+
+static const ENTITY_TYPE collision_grid_types[] = {OBSTACLE, INVERT_GRAVITY};
+static const u32 collision_grid_type_count = sizeof(collision_grid_types)/sizeof(collision_grid_types[0]);
+
+struct CellRange {
+  s32 x0, y0;
+  s32 x1, y1;
+};
+
+// @note: inclusive on both ends, a rect touching a cell edge is in both cells.
+// The narrow phase treats touching rects as colliding so the broad phase has to as well.
+static CellRange collision_grid_cells(CollisionGrid *grid, Rect r) {
+  CellRange range;
+  range.x0 = (s32)floorf(r.lb.x/grid->cell_size.x);
+  range.y0 = (s32)floorf(r.lb.y/grid->cell_size.y);
+  range.x1 = (s32)floorf(r.rt.x/grid->cell_size.x);
+  range.y1 = (s32)floorf(r.rt.y/grid->cell_size.y);
+  return range;
+}
+
+static inline u32 collision_grid_bucket(CollisionGrid *grid, s32 x, s32 y) {
+  u32 h = (u32)x*73856093u ^ (u32)y*19349663u;
+  return (h ^ (h >> 15)) & grid->bucket_mask;
+}
+
+static inline u64 collision_grid_cell_count(CellRange range) {
+  return (u64)(range.x1 - range.x0 + 1)*(u64)(range.y1 - range.y0 + 1);
+}
+
+static u32 collision_grid_bucket_mask(u64 ref_count) {
+  SDL_assert(ref_count < 0xFFFFFFFFu);
+  u32 bucket_count = 64;
+  while (bucket_count < ref_count) {
+    bucket_count *= 2;
+  }
+  return bucket_count - 1;
+}
+
+// @description: arena space collision_grid_build takes for the colliders made from
+// the obstacles of store. A merged collider never covers more cells than the
+// obstacles it was made from, so this is sized from the obstacles themselves.
+size_t collision_grid_size(EntityStore *store, Vec2 cell_size) {
+  CollisionGrid grid;
+  memset(&grid, 0, sizeof(CollisionGrid));
+  grid.cell_size = cell_size;
+
+  u32 obstacle_count = 0;
+  u64 ref_count = 0;
+  for (u32 t = 0; t < collision_grid_type_count; t++) {
+    EntityQuery obstacles = entity_query(store, collision_grid_types[t]);
+    for (u32 k = 0; k < obstacles.count; k++) {
+      ref_count += collision_grid_cell_count(collision_grid_cells(&grid, entity_bounds(store, obstacles.indices[k])));
+    }
+    obstacle_count += obstacles.count;
+  }
+  u32 bucket_mask = collision_grid_bucket_mask(ref_count);
+  u32 collider_capacity = obstacle_count + ENTITY_SPAWN_RESERVE;
+  return ((size_t)bucket_mask + 2 + ref_count + 3*(size_t)collider_capacity +
+	  ENTITY_SPAWN_RESERVE)*sizeof(u32) + 6*ALIGNMENT;
+}
+
+// @description: hashes every live collider into the grid, the arena needs
+// collision_grid_size bytes of room
+void collision_grid_build(CollisionGrid *grid, Arena *arena, ColliderSet *colliders, Vec2 cell_size) {
+  memset(grid, 0, sizeof(CollisionGrid));
+  grid->cell_size = cell_size;
+
+  // @step: count cell references to size the buckets
+  u64 ref_count = 0;
+  for (u32 c = 0; c < colliders->count; c++) {
+    if (collider_is_alive(colliders, c)) {
+      ref_count += collision_grid_cell_count(collision_grid_cells(grid, colliders->bounds[c]));
+    }
+  }
+  grid->bucket_mask = collision_grid_bucket_mask(ref_count);
+  grid->result_capacity = colliders->capacity;
+  grid->spawned_capacity = ENTITY_SPAWN_RESERVE;
+  u32 bucket_count = grid->bucket_mask + 1;
+
+  grid->bucket_offsets = (u32*)arena_alloc(arena, (bucket_count + 1)*sizeof(u32));
+  grid->items = (u32*)arena_alloc(arena, ref_count*sizeof(u32));
+  grid->stamps = (u32*)arena_alloc(arena, colliders->capacity*sizeof(u32));
+  grid->results = (u32*)arena_alloc(arena, grid->result_capacity*sizeof(u32));
+  grid->sort_scratch = (u32*)arena_alloc(arena, grid->result_capacity*sizeof(u32));
+  grid->spawned = (u32*)arena_alloc(arena, grid->spawned_capacity*sizeof(u32));
+  memset(grid->bucket_offsets, 0, (bucket_count + 1)*sizeof(u32));
+  memset(grid->stamps, 0, colliders->capacity*sizeof(u32));
+
+  // @step: bucket sizes, then prefix sum into offsets
+  for (u32 c = 0; c < colliders->count; c++) {
+    if (!collider_is_alive(colliders, c)) {
+      continue;
+    }
+    CellRange range = collision_grid_cells(grid, colliders->bounds[c]);
+    for (s32 y = range.y0; y <= range.y1; y++) {
+      for (s32 x = range.x0; x <= range.x1; x++) {
+	grid->bucket_offsets[collision_grid_bucket(grid, x, y) + 1]++;
+      }
+    }
+  }
+  for (u32 b = 0; b < bucket_count; b++) {
+    grid->bucket_offsets[b + 1] += grid->bucket_offsets[b];
+  }
+
+  // @step: fill, bucket_offsets[b] is used as the write cursor and ends up at the
+  // start of bucket b + 1, shifting it back restores the offsets
+  for (u32 c = 0; c < colliders->count; c++) {
+    if (!collider_is_alive(colliders, c)) {
+      continue;
+    }
+    CellRange range = collision_grid_cells(grid, colliders->bounds[c]);
+    for (s32 y = range.y0; y <= range.y1; y++) {
+      for (s32 x = range.x0; x <= range.x1; x++) {
+	grid->items[grid->bucket_offsets[collision_grid_bucket(grid, x, y)]++] = c;
+      }
+    }
+  }
+  memmove(&grid->bucket_offsets[1], &grid->bucket_offsets[0], bucket_count*sizeof(u32));
+  grid->bucket_offsets[0] = 0;
+}
+
+// @description: collider added after the grid was built
+void collision_grid_add(CollisionGrid *grid, u32 collider) {
+  SDL_assert(grid->spawned_count < grid->spawned_capacity);
+  if (grid->spawned_count < grid->spawned_capacity) {
+    grid->spawned[grid->spawned_count++] = collider;
+  }
+}
+
+// @note: hashed colliders that died are filtered out by the query,
+// only the spawned list has to be kept up to date
+void collision_grid_remove(CollisionGrid *grid, u32 collider) {
+  for (u32 i = 0; i < grid->spawned_count; i++) {
+    if (grid->spawned[i] == collider) {
+      grid->spawned[i] = grid->spawned[--grid->spawned_count];
+      return;
+    }
+  }
+}
+
+static void collision_grid_push(CollisionGrid *grid, ColliderSet *colliders, u32 collider, u32 *count) {
+  if (grid->stamps[collider] == grid->stamp || !collider_is_alive(colliders, collider)) {
+    return;
+  }
+  grid->stamps[collider] = grid->stamp;
+  grid->results[(*count)++] = collider;
+}
+
+// @description: colliders in the cells overlapping area (plus hash collisions),
+// sorted by index so the narrow phase visits them in the same order as the
+// full collider list. The result is valid until the next query.
+ColliderQuery collision_grid_query(CollisionGrid *grid, ColliderSet *colliders, Rect area) {
+  grid->stamp++;
+  if (grid->stamp == 0) {
+    memset(grid->stamps, 0, colliders->capacity*sizeof(u32));
+    grid->stamp = 1;
+  }
+
+  u32 count = 0;
+  CellRange range = collision_grid_cells(grid, area);
+  if (collision_grid_cell_count(range) > (u64)grid->bucket_mask + 1) {
+    // @note: the area covers more cells than there are buckets, every bucket would be visited anyway
+    for (u32 i = 0; i < grid->bucket_offsets[grid->bucket_mask + 1]; i++) {
+      collision_grid_push(grid, colliders, grid->items[i], &count);
+    }
+  } else {
+    for (s32 y = range.y0; y <= range.y1; y++) {
+      for (s32 x = range.x0; x <= range.x1; x++) {
+	u32 b = collision_grid_bucket(grid, x, y);
+	for (u32 i = grid->bucket_offsets[b]; i < grid->bucket_offsets[b + 1]; i++) {
+	  collision_grid_push(grid, colliders, grid->items[i], &count);
+	}
+      }
+    }
+  }
+  for (u32 i = 0; i < grid->spawned_count; i++) {
+    collision_grid_push(grid, colliders, grid->spawned[i], &count);
+  }
+
+  // @step: sort by index. Around the player there are a handful of candidates, but
+  // an area wider than the buckets (or a level with many spawned colliders) can
+  // return every collider, those are radix sorted.
+  u32 *sorted = grid->results;
+  if (count > COLLISION_GRID_INSERTION_SORT) {
+    sorted = collider_index_sort(grid->results, grid->sort_scratch, count, colliders->count);
+  } else {
+    for (u32 i = 1; i < count; i++) {
+      u32 collider = sorted[i];
+      u32 j = i;
+      for (; j > 0 && sorted[j - 1] > collider; j--) {
+	sorted[j] = sorted[j - 1];
+      }
+      sorted[j] = collider;
+    }
+  }
+
+  ColliderQuery query = {sorted, count};
+  return query;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "../core.h"
+#include "../math.h"
+#include "../memory/arena.h"
+#include "../entity/entity_store.h"
+#include "colliders.h"
+
+// queries with more candidates than this are radix sorted, fewer are insertion sorted
+#define COLLISION_GRID_INSERTION_SORT 32
+
+// @note: broad phase for the player vs obstacle collision pass. Colliders
+// (merged OBSTACLE and INVERT_GRAVITY rects) are hashed into atom sized cells
+// when the level is bound. Cells are hashed instead of stored densely so huge
+// sparse levels do not pay for their empty space. Bucket contents are stored
+// back to back (CSR): the colliders in bucket b are
+// items[bucket_offsets[b], bucket_offsets[b + 1]).
+// Colliders added at runtime are not hashed, they are kept in `spawned`
+// and returned by every query.
+struct CollisionGrid {
+    Vec2 cell_size;
+    u32 bucket_mask;	// bucket count - 1, power of two
+    u32 *bucket_offsets;
+    u32 *items;
+    // query scratch
+    u32 *stamps;	// per collider, == stamp when the collider is already in the results
+    u32 stamp;
+    u32 *results;
+    u32 *sort_scratch;	// result_capacity, for sorting results
+    u32 result_capacity;
+    u32 *spawned;
+    u32 spawned_count;
+    u32 spawned_capacity;
+};
+
+size_t collision_grid_size(EntityStore *store, Vec2 cell_size);
+void collision_grid_build(CollisionGrid *grid, Arena *arena, ColliderSet *colliders, Vec2 cell_size);
+void collision_grid_add(CollisionGrid *grid, u32 collider);
+void collision_grid_remove(CollisionGrid *grid, u32 collider);
+ColliderQuery collision_grid_query(CollisionGrid *grid, ColliderSet *colliders, Rect area);
@@ -0,0 +1,158 @@
+#include "contact_batch.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define CONTACT_BATCH_SSE 1
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static_assert(sizeof(Rect) == 4*sizeof(r32), "contact_batch loads a Rect as one 4 wide register");
+
+// @description: index of the lowest set bit, mask must not be 0
+u32 contact_mask_first(u64 mask) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, mask);
+  return (u32)index;
+#else
+  return (u32)__builtin_ctzll(mask);
+#endif
+}
+
+static inline const Rect *contact_target(const Rect *bounds, const u32 *indices, u32 i) {
+  return indices ? &bounds[indices[i]] : &bounds[i];
+}
+
+// @note: the comparisons are written to give the same result as the scalar
+// tests below for every input, NaN included: !(a > b) is cmpngt, not cmple
+static void contact_classify_scalar(Rect prev, Rect next, const Rect *bounds, const u32 *indices,
+				    u32 begin, u32 end, ContactMasks *masks) {
+  for (u32 i = begin; i < end; i++) {
+    Rect t = *contact_target(bounds, indices, i);
+    b8 prev_collide_x = !(prev.lb.x > t.rt.x || prev.rt.x < t.lb.x);
+    b8 new_collide_target_top = (next.lb.y < t.rt.y && next.rt.y > t.rt.y);
+    b8 new_collide_target_bottom = (next.rt.y > t.lb.y && next.lb.y < t.lb.y);
+    b8 prev_collide_y = !(prev.rt.y < t.lb.y + 0.2f || prev.lb.y > t.rt.y);
+    b8 new_collide_x = !(next.rt.x < t.lb.x || next.lb.x > t.rt.x);
+    u64 bit = 1ull << i;
+    if (prev_collide_x && new_collide_target_top) {
+      masks->top |= bit;
+    }
+    if (prev_collide_x && new_collide_target_bottom) {
+      masks->bottom |= bit;
+    }
+    if (prev_collide_y && new_collide_x) {
+      masks->x |= bit;
+    }
+  }
+}
+
+#if defined(__AVX__)
+// @description: 8 targets, rects i..i+3 in the low lane and i+4..i+7 in the high lane
+static inline void contact_classify_avx(Rect prev, Rect next, const Rect *bounds, const u32 *indices,
+					u32 i, ContactMasks *masks) {
+  __m256 r[4];
+  for (u32 k = 0; k < 4; k++) {
+    __m128 lo = _mm_loadu_ps(&contact_target(bounds, indices, i + k)->lb.x);
+    __m128 hi = _mm_loadu_ps(&contact_target(bounds, indices, i + k + 4)->lb.x);
+    r[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+  }
+  // @step: transpose to left, bottom, right, top
+  __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+  __m256 t1 = _mm256_unpacklo_ps(r[2], r[3]);
+  __m256 t2 = _mm256_unpackhi_ps(r[0], r[1]);
+  __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+  __m256 t_left   = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 t_bottom = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+  __m256 t_right  = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+  __m256 t_top    = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+  __m256 prev_left   = _mm256_set1_ps(prev.lb.x);
+  __m256 prev_bottom = _mm256_set1_ps(prev.lb.y);
+  __m256 prev_right  = _mm256_set1_ps(prev.rt.x);
+  __m256 prev_top    = _mm256_set1_ps(prev.rt.y);
+  __m256 p_left   = _mm256_set1_ps(next.lb.x);
+  __m256 p_bottom = _mm256_set1_ps(next.lb.y);
+  __m256 p_right  = _mm256_set1_ps(next.rt.x);
+  __m256 p_top    = _mm256_set1_ps(next.rt.y);
+
+  __m256 prev_collide_x = _mm256_and_ps(_mm256_cmp_ps(prev_left, t_right, _CMP_NGT_UQ),
+					_mm256_cmp_ps(prev_right, t_left, _CMP_NLT_UQ));
+  __m256 top = _mm256_and_ps(_mm256_cmp_ps(p_bottom, t_top, _CMP_LT_OQ),
+			     _mm256_cmp_ps(p_top, t_top, _CMP_GT_OQ));
+  __m256 bottom = _mm256_and_ps(_mm256_cmp_ps(p_top, t_bottom, _CMP_GT_OQ),
+				_mm256_cmp_ps(p_bottom, t_bottom, _CMP_LT_OQ));
+  __m256 prev_collide_y = _mm256_and_ps(
+    _mm256_cmp_ps(prev_top, _mm256_add_ps(t_bottom, _mm256_set1_ps(0.2f)), _CMP_NLT_UQ),
+    _mm256_cmp_ps(prev_bottom, t_top, _CMP_NGT_UQ));
+  __m256 new_collide_x = _mm256_and_ps(_mm256_cmp_ps(p_right, t_left, _CMP_NLT_UQ),
+				       _mm256_cmp_ps(p_left, t_right, _CMP_NGT_UQ));
+
+  masks->top |= (u64)_mm256_movemask_ps(_mm256_and_ps(prev_collide_x, top)) << i;
+  masks->bottom |= (u64)_mm256_movemask_ps(_mm256_and_ps(prev_collide_x, bottom)) << i;
+  masks->x |= (u64)_mm256_movemask_ps(_mm256_and_ps(prev_collide_y, new_collide_x)) << i;
+}
+#endif
+
+#if CONTACT_BATCH_SSE
+// @description: 4 targets
+static inline void contact_classify_sse(Rect prev, Rect next, const Rect *bounds, const u32 *indices,
+					u32 i, ContactMasks *masks) {
+  __m128 r0 = _mm_loadu_ps(&contact_target(bounds, indices, i + 0)->lb.x);
+  __m128 r1 = _mm_loadu_ps(&contact_target(bounds, indices, i + 1)->lb.x);
+  __m128 r2 = _mm_loadu_ps(&contact_target(bounds, indices, i + 2)->lb.x);
+  __m128 r3 = _mm_loadu_ps(&contact_target(bounds, indices, i + 3)->lb.x);
+  // @step: transpose to left, bottom, right, top
+  __m128 t0 = _mm_unpacklo_ps(r0, r1);
+  __m128 t1 = _mm_unpacklo_ps(r2, r3);
+  __m128 t2 = _mm_unpackhi_ps(r0, r1);
+  __m128 t3 = _mm_unpackhi_ps(r2, r3);
+  __m128 t_left   = _mm_movelh_ps(t0, t1);
+  __m128 t_bottom = _mm_movehl_ps(t1, t0);
+  __m128 t_right  = _mm_movelh_ps(t2, t3);
+  __m128 t_top    = _mm_movehl_ps(t3, t2);
+
+  __m128 prev_left   = _mm_set1_ps(prev.lb.x);
+  __m128 prev_bottom = _mm_set1_ps(prev.lb.y);
+  __m128 prev_right  = _mm_set1_ps(prev.rt.x);
+  __m128 prev_top    = _mm_set1_ps(prev.rt.y);
+  __m128 p_left   = _mm_set1_ps(next.lb.x);
+  __m128 p_bottom = _mm_set1_ps(next.lb.y);
+  __m128 p_right  = _mm_set1_ps(next.rt.x);
+  __m128 p_top    = _mm_set1_ps(next.rt.y);
+
+  __m128 prev_collide_x = _mm_and_ps(_mm_cmpngt_ps(prev_left, t_right), _mm_cmpnlt_ps(prev_right, t_left));
+  __m128 top = _mm_and_ps(_mm_cmplt_ps(p_bottom, t_top), _mm_cmpgt_ps(p_top, t_top));
+  __m128 bottom = _mm_and_ps(_mm_cmpgt_ps(p_top, t_bottom), _mm_cmplt_ps(p_bottom, t_bottom));
+  __m128 prev_collide_y = _mm_and_ps(_mm_cmpnlt_ps(prev_top, _mm_add_ps(t_bottom, _mm_set1_ps(0.2f))),
+				     _mm_cmpngt_ps(prev_bottom, t_top));
+  __m128 new_collide_x = _mm_and_ps(_mm_cmpnlt_ps(p_right, t_left), _mm_cmpngt_ps(p_left, t_right));
+
+  masks->top |= (u64)_mm_movemask_ps(_mm_and_ps(prev_collide_x, top)) << i;
+  masks->bottom |= (u64)_mm_movemask_ps(_mm_and_ps(prev_collide_x, bottom)) << i;
+  masks->x |= (u64)_mm_movemask_ps(_mm_and_ps(prev_collide_y, new_collide_x)) << i;
+}
+#endif
+
+// @description: classifies up to CONTACT_BATCH_SIZE targets against the player
+// moving from prev to next. Targets are bounds[indices[i]], or bounds[i] when
+// indices is NULL.
+ContactMasks contact_batch_classify(Rect prev, Rect next, const Rect *bounds, const u32 *indices, u32 count) {
+  SDL_assert(count <= CONTACT_BATCH_SIZE);
+  ContactMasks masks = {0, 0, 0};
+  u32 i = 0;
+#if defined(__AVX__)
+  for (; i + 8 <= count; i += 8) {
+    contact_classify_avx(prev, next, bounds, indices, i, &masks);
+  }
+#endif
+#if CONTACT_BATCH_SSE
+  for (; i + 4 <= count; i += 4) {
+    contact_classify_sse(prev, next, bounds, indices, i, &masks);
+  }
+#endif
+  contact_classify_scalar(prev, next, bounds, indices, i, count, &masks);
+  return masks;
+}
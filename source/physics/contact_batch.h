@@ -0,0 +1,24 @@
+#pragma once
+
+#include "../core.h"
+#include "../math.h"
+
+// targets classified per call, one bit each in ContactMasks
+#define CONTACT_BATCH_SIZE 64
+
+// @note: batched form of the player vs target side tests of the collision pass.
+// Bit i is set when target i is hit:
+// x:      on a side, the player can not move horizontally
+// top:    the player lands on the target's top
+// bottom: the player bumps into the target's bottom
+// Top and bottom are raw, the collision pass only honours the first target
+// with either bit set (see contact_mask_first). Targets are 4 (SSE) or 8 (AVX,
+// simd_avx2 in build.sh) Rects at a time, a Rect is exactly one 4 wide register.
+struct ContactMasks {
+    u64 x;
+    u64 top;
+    u64 bottom;
+};
+
+ContactMasks contact_batch_classify(Rect prev, Rect next, const Rect *bounds, const u32 *indices, u32 count);
+u32 contact_mask_first(u64 mask);
@@ -0,0 +1,298 @@
+#include "level_query.h"
+
+// a median split tree over 2^32 colliders is 31 levels deep
+#define LEVEL_QUERY_STACK_SIZE 64
+
+static u32 level_query_obstacle_count(EntityStore *store) {
+  return entity_query(store, OBSTACLE).count + entity_query(store, INVERT_GRAVITY).count;
+}
+
+// @description: arena space level_query_build takes for the colliders made from
+// the obstacles of store
+size_t level_query_size(EntityStore *store) {
+  size_t collider_capacity = (size_t)level_query_obstacle_count(store) + ENTITY_SPAWN_RESERVE;
+  return (2*collider_capacity + 1)*sizeof(LevelQueryNode) + 2*collider_capacity*sizeof(u32) + 3*ALIGNMENT;
+}
+
+static inline r32 level_query_centroid(ColliderSet *colliders, u32 collider, u32 axis) {
+  Rect r = colliders->bounds[collider];
+  return r.lb.data[axis] + r.rt.data[axis];
+}
+
+// @description: reorders items[first, last] so items[nth] is the one that would be
+// there if they were sorted by centroid on axis, smaller ones before it
+static void level_query_select(ColliderSet *colliders, u32 *items, s32 first, s32 last, s32 nth, u32 axis) {
+  while (first < last) {
+    r32 pivot = level_query_centroid(colliders, items[first + (last - first)/2], axis);
+    s32 i = first;
+    s32 j = last;
+    while (i <= j) {
+      while (level_query_centroid(colliders, items[i], axis) < pivot) {
+	i++;
+      }
+      while (level_query_centroid(colliders, items[j], axis) > pivot) {
+	j--;
+      }
+      if (i <= j) {
+	u32 swap = items[i];
+	items[i] = items[j];
+	items[j] = swap;
+	i++;
+	j--;
+      }
+    }
+    if (nth <= j) {
+      last = j;
+    } else if (nth >= i) {
+      first = i;
+    } else {
+      return;
+    }
+  }
+}
+
+static void level_query_build_node(LevelQuery *query, ColliderSet *colliders, u32 node, u32 first, u32 count) {
+  Rect box = colliders->bounds[query->items[first]];
+  Rect centroids = {box.lb + box.rt, box.lb + box.rt};
+  for (u32 i = first + 1; i < first + count; i++) {
+    Rect r = colliders->bounds[query->items[i]];
+    box = rect_union(box, r);
+    Vec2 c = r.lb + r.rt;
+    centroids = rect_union(centroids, Rect{c, c});
+  }
+  if (count <= LEVEL_QUERY_LEAF_SIZE) {
+    query->nodes[node] = LevelQueryNode{box, first, count};
+    return;
+  }
+
+  u32 axis = (centroids.rt.x - centroids.lb.x) >= (centroids.rt.y - centroids.lb.y) ? 0 : 1;
+  u32 left_count = count/2;
+  level_query_select(colliders, query->items, (s32)first, (s32)(first + count - 1), (s32)(first + left_count), axis);
+
+  u32 children = query->node_count;
+  query->node_count += 2;
+  query->nodes[node] = LevelQueryNode{box, children, 0};
+  level_query_build_node(query, colliders, children, first, left_count);
+  level_query_build_node(query, colliders, children + 1, first + left_count, count - left_count);
+}
+
+// @description: builds the hierarchy over the live colliders, the arena needs
+// level_query_size bytes of room
+void level_query_build(LevelQuery *query, Arena *arena, ColliderSet *colliders) {
+  query->nodes = (LevelQueryNode*)arena_alloc(arena, (2*(size_t)colliders->capacity + 1)*sizeof(LevelQueryNode));
+  query->items = (u32*)arena_alloc(arena, colliders->capacity*sizeof(u32));
+  query->result_capacity = colliders->capacity;
+  query->results = (u32*)arena_alloc(arena, query->result_capacity*sizeof(u32));
+  query->built_count = colliders->count;
+  query->node_count = 0;
+
+  u32 item_count = 0;
+  for (u32 c = 0; c < colliders->count; c++) {
+    if (collider_is_alive(colliders, c)) {
+      query->items[item_count++] = c;
+    }
+  }
+  if (item_count == 0) {
+    return;
+  }
+  query->node_count = 1;
+  level_query_build_node(query, colliders, 0, 0, item_count);
+}
+
+static inline b8 level_query_accepts(ColliderSet *colliders, u32 collider, u32 type_mask) {
+  return collider_is_alive(colliders, collider) && ((1u << colliders->types[collider]) & type_mask);
+}
+
+// @description: slab test of the segment origin + motion*t, t in [0, t_max], against r
+// grown by half. Touching is not a hit. Returns the entry time and the axis it
+// enters on last (2 when the segment starts inside).
+static inline b8 level_query_slab(Vec2 origin, Vec2 motion, Vec2 inverse, Rect r, Vec2 half,
+				  r32 t_max, r32 *t_entry, u32 *entry_axis) {
+  r32 entry = -INFINITY;
+  r32 exit = t_max;
+  u32 axis = 2;
+  for (u32 a = 0; a < 2; a++) {
+    r32 lo = r.lb.data[a] - half.data[a];
+    r32 hi = r.rt.data[a] + half.data[a];
+    if (motion.data[a] == 0.0f) {
+      if (origin.data[a] <= lo || origin.data[a] >= hi) {
+	return 0;
+      }
+      continue;
+    }
+    r32 t0 = (lo - origin.data[a])*inverse.data[a];
+    r32 t1 = (hi - origin.data[a])*inverse.data[a];
+    if (t0 > t1) {
+      r32 swap = t0;
+      t0 = t1;
+      t1 = swap;
+    }
+    if (t0 > entry) {
+      entry = t0;
+      axis = a;
+    }
+    exit = MIN(exit, t1);
+  }
+  if (entry >= exit || exit <= 0.0f) {
+    return 0;
+  }
+  if (entry < 0.0f) {
+    // starts inside
+    entry = 0.0f;
+    axis = 2;
+  }
+  *t_entry = entry;
+  *entry_axis = axis;
+  return 1;
+}
+
+// @description: first collider hit by a box of half extents `half`, centered on origin,
+// moving by motion. Raycasts are casts of a box with no extents.
+static b8 level_query_cast(LevelQuery *query, ColliderSet *colliders, Vec2 origin, Vec2 motion,
+			   Vec2 half, u32 type_mask, QueryHit *hit) {
+  Vec2 inverse = Vec2{motion.x != 0.0f ? 1.0f/motion.x : 0.0f, motion.y != 0.0f ? 1.0f/motion.y : 0.0f};
+  r32 best = 1.0f;
+  u32 best_axis = 2;
+  u32 best_collider = ENTITY_INVALID_INDEX;
+
+  if (query->node_count > 0) {
+    u32 stack[LEVEL_QUERY_STACK_SIZE];
+    u32 stack_size = 0;
+    stack[stack_size++] = 0;
+    while (stack_size > 0) {
+      LevelQueryNode *node = &query->nodes[stack[--stack_size]];
+      r32 t;
+      u32 axis;
+      if (!level_query_slab(origin, motion, inverse, node->box, half, best, &t, &axis)) {
+	continue;
+      }
+      if (node->count > 0) {
+	for (u32 i = node->first; i < node->first + node->count; i++) {
+	  u32 c = query->items[i];
+	  if (level_query_accepts(colliders, c, type_mask) &&
+	      level_query_slab(origin, motion, inverse, colliders->bounds[c], half, best, &t, &axis) &&
+	      (t < best || best_collider == ENTITY_INVALID_INDEX)) {
+	    best = t;
+	    best_axis = axis;
+	    best_collider = c;
+	  }
+	}
+	continue;
+      }
+      // @step: visit the nearer child first, it shrinks `best` for the other one
+      r32 t_left, t_right;
+      u32 axis_left, axis_right;
+      b8 hit_left = level_query_slab(origin, motion, inverse, query->nodes[node->first].box, half, best,
+				     &t_left, &axis_left);
+      b8 hit_right = level_query_slab(origin, motion, inverse, query->nodes[node->first + 1].box, half, best,
+				      &t_right, &axis_right);
+      SDL_assert(stack_size + 2 <= LEVEL_QUERY_STACK_SIZE);
+      if (hit_left && hit_right) {
+	b8 left_first = t_left <= t_right;
+	stack[stack_size++] = node->first + (left_first ? 1 : 0);
+	stack[stack_size++] = node->first + (left_first ? 0 : 1);
+      } else if (hit_left) {
+	stack[stack_size++] = node->first;
+      } else if (hit_right) {
+	stack[stack_size++] = node->first + 1;
+      }
+    }
+  }
+
+  for (u32 c = query->built_count; c < colliders->count; c++) {
+    r32 t;
+    u32 axis;
+    if (level_query_accepts(colliders, c, type_mask) &&
+	level_query_slab(origin, motion, inverse, colliders->bounds[c], half, best, &t, &axis) &&
+	(t < best || best_collider == ENTITY_INVALID_INDEX)) {
+      best = t;
+      best_axis = axis;
+      best_collider = c;
+    }
+  }
+
+  if (best_collider == ENTITY_INVALID_INDEX) {
+    return 0;
+  }
+  hit->collider = best_collider;
+  hit->distance = best;
+  hit->point = origin + motion*best;
+  hit->normal = Vec2{0.0f, 0.0f};
+  if (best_axis < 2) {
+    hit->normal.data[best_axis] = motion.data[best_axis] > 0.0f ? -1.0f : 1.0f;
+  }
+  return 1;
+}
+
+// @description: first collider of a type in type_mask the ray hits within max_distance.
+// direction does not need to be normalized, hit->distance is in world units.
+b8 level_query_raycast(LevelQuery *query, ColliderSet *colliders, Vec2 origin, Vec2 direction,
+		       r32 max_distance, u32 type_mask, QueryHit *hit) {
+  r32 length = sqrtf(direction.x*direction.x + direction.y*direction.y);
+  if (length == 0.0f || max_distance <= 0.0f) {
+    return 0;
+  }
+  Vec2 motion = direction*(max_distance/length);
+  if (!level_query_cast(query, colliders, origin, motion, Vec2{0.0f, 0.0f}, type_mask, hit)) {
+    return 0;
+  }
+  hit->distance *= max_distance;
+  return 1;
+}
+
+// @description: first collider of a type in type_mask that box hits moving by motion.
+// hit->distance is the fraction of motion, hit->point the box's lb at the hit.
+b8 level_query_boxcast(LevelQuery *query, ColliderSet *colliders, Rect box, Vec2 motion,
+		       u32 type_mask, QueryHit *hit) {
+  Vec2 half = (box.rt - box.lb)*0.5f;
+  if (!level_query_cast(query, colliders, box.lb + half, motion, half, type_mask, hit)) {
+    return 0;
+  }
+  hit->point = hit->point - half;
+  return 1;
+}
+
+// @description: every collider of a type in type_mask that overlaps area (edges
+// included), ordered by index. The indices are allocated from arena. Not reentrant,
+// the colliders are gathered in query->results before the sort.
+ColliderQuery level_query_overlap(LevelQuery *query, ColliderSet *colliders, Rect area,
+				  u32 type_mask, Arena *arena) {
+  u32 count = 0;
+  if (query->node_count > 0) {
+    u32 stack[LEVEL_QUERY_STACK_SIZE];
+    u32 stack_size = 0;
+    stack[stack_size++] = 0;
+    while (stack_size > 0) {
+      LevelQueryNode *node = &query->nodes[stack[--stack_size]];
+      if (!aabb_collision_rect(node->box, area)) {
+	continue;
+      }
+      if (node->count > 0) {
+	for (u32 i = node->first; i < node->first + node->count; i++) {
+	  u32 c = query->items[i];
+	  if (level_query_accepts(colliders, c, type_mask) && aabb_collision_rect(colliders->bounds[c], area)) {
+	    query->results[count++] = c;
+	  }
+	}
+	continue;
+      }
+      SDL_assert(stack_size + 2 <= LEVEL_QUERY_STACK_SIZE);
+      stack[stack_size++] = node->first + 1;
+      stack[stack_size++] = node->first;
+    }
+  }
+  for (u32 c = query->built_count; c < colliders->count; c++) {
+    if (level_query_accepts(colliders, c, type_mask) && aabb_collision_rect(colliders->bounds[c], area)) {
+      query->results[count++] = c;
+    }
+  }
+
+  // @step: radix sort into the caller's array, query->results is the scratch
+  u32 *indices = (u32*)arena_alloc(arena, count*sizeof(u32));
+  u32 *sorted = collider_index_sort(query->results, indices, count, colliders->count);
+  if (sorted != indices) {
+    memcpy(indices, sorted, count*sizeof(u32));
+  }
+  ColliderQuery result = {indices, count};
+  return result;
+}
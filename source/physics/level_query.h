@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../core.h"
+#include "../math.h"
+#include "../memory/arena.h"
+#include "../entity/entity_store.h"
+#include "colliders.h"
+
+#define LEVEL_QUERY_LEAF_SIZE 4
+// type masks, bit n set to hit colliders of ENTITY_TYPE n
+#define LEVEL_QUERY_SOLIDS ((1u << OBSTACLE) | (1u << INVERT_GRAVITY))
+
+// @note: ray, box and area queries over the level geometry (the colliders),
+// for gameplay and tools that need "what is there" or "what is hit first".
+// Colliders are kept in a bounding volume hierarchy built when the level is
+// bound: each node splits its colliders at the median along its longest axis,
+// leaves hold up to LEVEL_QUERY_LEAF_SIZE. Children are stored in pairs,
+// the children of an inner node are nodes[first] and nodes[first + 1].
+// Colliders added after the build are tested one by one.
+// Casts only read the query, any number can run at once. Overlaps gather into
+// the query's shared results scratch, so only one overlap may run on a
+// LevelQuery at a time.
+struct LevelQueryNode {
+    Rect box;
+    u32 first;		// first item for leaves, first child for inner nodes
+    u32 count;		// items in a leaf, 0 for inner nodes
+};
+
+struct LevelQuery {
+    LevelQueryNode *nodes;
+    u32 node_count;
+    u32 *items;		// collider indices, leaves own ranges of it
+    u32 built_count;	// colliders [0, built_count) are in the hierarchy
+    u32 *results;	// overlap scratch, shared by every level_query_overlap call
+    u32 result_capacity;
+};
+
+struct QueryHit {
+    u32 collider;
+    r32 distance;	// along the ray for raycasts, fraction of the motion for boxcasts
+    Vec2 point;		// where the ray hits, where the box is at the hit for boxcasts
+    Vec2 normal;	// side that was hit, 0 when the query starts inside the collider
+};
+
+size_t level_query_size(EntityStore *store);
+void level_query_build(LevelQuery *query, Arena *arena, ColliderSet *colliders);
+b8 level_query_raycast(LevelQuery *query, ColliderSet *colliders, Vec2 origin, Vec2 direction,
+		       r32 max_distance, u32 type_mask, QueryHit *hit);
+b8 level_query_boxcast(LevelQuery *query, ColliderSet *colliders, Rect box, Vec2 motion,
+		       u32 type_mask, QueryHit *hit);
+ColliderQuery level_query_overlap(LevelQuery *query, ColliderSet *colliders, Rect area,
+				  u32 type_mask, Arena *arena);
@@ -0,0 +1,204 @@
+#include "occupancy.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static const ENTITY_TYPE occupancy_solid_types[] = {OBSTACLE, INVERT_GRAVITY};
+static const u32 occupancy_solid_type_count = sizeof(occupancy_solid_types)/sizeof(occupancy_solid_types[0]);
+
+static inline u32 occupancy_ctz(u64 word) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, word);
+  return (u32)index;
+#else
+  return (u32)__builtin_ctzll(word);
+#endif
+}
+
+// @description: bits [b0, b1] of word w of a row
+static inline u64 occupancy_word_mask(u32 w, u32 b0, u32 b1) {
+  u64 mask = ~0ull;
+  if (w == b0 >> 6) {
+    mask &= ~0ull << (b0 & 63);
+  }
+  if (w == b1 >> 6) {
+    mask &= ~0ull >> (63 - (b1 & 63));
+  }
+  return mask;
+}
+
+// @description: atoms an obstacle covers any part of
+static void occupancy_obstacle_atoms(Rect r, Vec2 atom_size, s32 *x0, s32 *y0, s32 *x1, s32 *y1) {
+  *x0 = (s32)floorf(r.lb.x/atom_size.x);
+  *y0 = (s32)floorf(r.lb.y/atom_size.y);
+  *x1 = MAX((s32)ceilf(r.rt.x/atom_size.x) - 1, *x0);
+  *y1 = MAX((s32)ceilf(r.rt.y/atom_size.y) - 1, *y0);
+}
+
+// @description: clips an atom range to the map, returns 0 when nothing is left
+static b8 occupancy_clip(OccupancyMap *map, s32 *x0, s32 *y0, s32 *x1, s32 *y1) {
+  *x0 = MAX(*x0, map->origin_x);
+  *y0 = MAX(*y0, map->origin_y);
+  *x1 = MIN(*x1, map->origin_x + (s32)map->width - 1);
+  *y1 = MIN(*y1, map->origin_y + (s32)map->height - 1);
+  return *x0 <= *x1 && *y0 <= *y1;
+}
+
+static inline u64 *occupancy_row(OccupancyMap *map, s32 y) {
+  return map->bits + (size_t)(y - map->origin_y)*map->row_words;
+}
+
+// @description: sets (or clears) the atoms [x0, x1] x [y0, y1], which must be in the map
+static void occupancy_fill(OccupancyMap *map, s32 x0, s32 y0, s32 x1, s32 y1, b8 solid) {
+  u32 b0 = (u32)(x0 - map->origin_x);
+  u32 b1 = (u32)(x1 - map->origin_x);
+  for (s32 y = y0; y <= y1; y++) {
+    u64 *row = occupancy_row(map, y);
+    for (u32 w = b0 >> 6; w <= b1 >> 6; w++) {
+      if (solid) {
+	row[w] |= occupancy_word_mask(w, b0, b1);
+      } else {
+	row[w] &= ~occupancy_word_mask(w, b0, b1);
+      }
+    }
+  }
+}
+
+static void occupancy_layout(OccupancyMap *map, EntityStore *store, Vec2 atom_size) {
+  memset(map, 0, sizeof(OccupancyMap));
+  map->atom_size = atom_size;
+
+  s32 min_x = 0x7FFFFFFF, min_y = 0x7FFFFFFF;
+  s32 max_x = -0x7FFFFFFF, max_y = -0x7FFFFFFF;
+  for (u32 t = 0; t < occupancy_solid_type_count; t++) {
+    EntityQuery solids = entity_query(store, occupancy_solid_types[t]);
+    for (u32 k = 0; k < solids.count; k++) {
+      s32 x0, y0, x1, y1;
+      occupancy_obstacle_atoms(entity_bounds(store, solids.indices[k]), atom_size, &x0, &y0, &x1, &y1);
+      min_x = MIN(min_x, x0);
+      min_y = MIN(min_y, y0);
+      max_x = MAX(max_x, x1);
+      max_y = MAX(max_y, y1);
+    }
+  }
+  if (min_x > max_x) {
+    // no solids
+    return;
+  }
+  map->origin_x = min_x;
+  map->origin_y = min_y;
+  map->width = (u32)(max_x - min_x + 1);
+  map->height = (u32)(max_y - min_y + 1);
+  map->row_words = (map->width + 63)/64;
+}
+
+// @description: arena space occupancy_build takes for the solids of store
+size_t occupancy_size(EntityStore *store, Vec2 atom_size) {
+  OccupancyMap map;
+  occupancy_layout(&map, store, atom_size);
+  return (size_t)map.row_words*map.height*sizeof(u64) + ALIGNMENT;
+}
+
+// @description: rasterizes the solids of store, the arena needs occupancy_size bytes of room
+void occupancy_build(OccupancyMap *map, Arena *arena, EntityStore *store, Vec2 atom_size) {
+  occupancy_layout(map, store, atom_size);
+  size_t word_count = (size_t)map->row_words*map->height;
+  map->bits = (u64*)arena_alloc(arena, word_count*sizeof(u64));
+  if (word_count == 0) {
+    return;
+  }
+  memset(map->bits, 0, word_count*sizeof(u64));
+
+  for (u32 t = 0; t < occupancy_solid_type_count; t++) {
+    EntityQuery solids = entity_query(store, occupancy_solid_types[t]);
+    for (u32 k = 0; k < solids.count; k++) {
+      s32 x0, y0, x1, y1;
+      occupancy_obstacle_atoms(entity_bounds(store, solids.indices[k]), atom_size, &x0, &y0, &x1, &y1);
+      occupancy_fill(map, x0, y0, x1, y1, 1);
+    }
+  }
+}
+
+// @description: clears the atoms r covers, r being the bounds of a solid that was just
+// despawned from store. The solids left in store that share those atoms are drawn
+// back in, the rest of the map is untouched.
+void occupancy_remove(OccupancyMap *map, EntityStore *store, Rect r) {
+  s32 x0, y0, x1, y1;
+  occupancy_obstacle_atoms(r, map->atom_size, &x0, &y0, &x1, &y1);
+  if (!occupancy_clip(map, &x0, &y0, &x1, &y1)) {
+    return;
+  }
+  occupancy_fill(map, x0, y0, x1, y1, 0);
+  for (u32 t = 0; t < occupancy_solid_type_count; t++) {
+    EntityQuery solids = entity_query(store, occupancy_solid_types[t]);
+    for (u32 k = 0; k < solids.count; k++) {
+      s32 sx0, sy0, sx1, sy1;
+      occupancy_obstacle_atoms(entity_bounds(store, solids.indices[k]), map->atom_size, &sx0, &sy0, &sx1, &sy1);
+      sx0 = MAX(sx0, x0);
+      sy0 = MAX(sy0, y0);
+      sx1 = MIN(sx1, x1);
+      sy1 = MIN(sy1, y1);
+      if (sx0 <= sx1 && sy0 <= sy1) {
+	occupancy_fill(map, sx0, sy0, sx1, sy1, 1);
+      }
+    }
+  }
+}
+
+b8 occupancy_test(OccupancyMap *map, s32 x, s32 y) {
+  if (x < map->origin_x || y < map->origin_y ||
+      x >= map->origin_x + (s32)map->width || y >= map->origin_y + (s32)map->height) {
+    return 0;
+  }
+  u32 bx = (u32)(x - map->origin_x);
+  return (occupancy_row(map, y)[bx >> 6] >> (bx & 63)) & 1;
+}
+
+// @description: 1 if any atom in [x0, x1] x [y0, y1] is solid
+b8 occupancy_any(OccupancyMap *map, s32 x0, s32 y0, s32 x1, s32 y1) {
+  if (!occupancy_clip(map, &x0, &y0, &x1, &y1)) {
+    return 0;
+  }
+  u32 b0 = (u32)(x0 - map->origin_x);
+  u32 b1 = (u32)(x1 - map->origin_x);
+  for (s32 y = y0; y <= y1; y++) {
+    u64 *row = occupancy_row(map, y);
+    for (u32 w = b0 >> 6; w <= b1 >> 6; w++) {
+      if (row[w] & occupancy_word_mask(w, b0, b1)) {
+	return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+// @description: 1 if a solid atom touches r, edges included. Used as an early out
+// before the collision pass, which also counts touching rects as colliding.
+b8 occupancy_touches(OccupancyMap *map, Rect r) {
+  s32 x0 = (s32)ceilf(r.lb.x/map->atom_size.x) - 1;
+  s32 y0 = (s32)ceilf(r.lb.y/map->atom_size.y) - 1;
+  s32 x1 = (s32)floorf(r.rt.x/map->atom_size.x);
+  s32 y1 = (s32)floorf(r.rt.y/map->atom_size.y);
+  return occupancy_any(map, x0, y0, x1, y1);
+}
+
+// @description: first solid atom at or right of x in row y, OCCUPANCY_NOT_FOUND if there is none
+s32 occupancy_find_right(OccupancyMap *map, s32 y, s32 x) {
+  if (map->width == 0 || y < map->origin_y || y >= map->origin_y + (s32)map->height ||
+      x >= map->origin_x + (s32)map->width) {
+    return OCCUPANCY_NOT_FOUND;
+  }
+  u32 bx = (u32)MAX(x - map->origin_x, 0);
+  u64 *row = occupancy_row(map, y);
+  u32 w = bx >> 6;
+  u64 word = row[w] & (~0ull << (bx & 63));
+  while (word == 0) {
+    if (++w >= map->row_words) {
+      return OCCUPANCY_NOT_FOUND;
+    }
+    word = row[w];
+  }
+  return map->origin_x + (s32)(w*64 + occupancy_ctz(word));
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../core.h"
+#include "../math.h"
+#include "../memory/arena.h"
+#include "../entity/entity_store.h"
+
+#define OCCUPANCY_NOT_FOUND 0x7FFFFFFF
+
+// @note: one bit per atom, set when a static solid (OBSTACLE or INVERT_GRAVITY)
+// covers any part of that atom. Level geometry sits on the atom grid, so for
+// shipped levels this is exact. Off-grid geometry marks every atom it touches.
+// Rows are packed in u64 words, bit x of a row is the atom at origin_x + x.
+// Coordinates in the API are world atoms, floor(position/atom_size).
+struct OccupancyMap {
+    Vec2 atom_size;
+    s32 origin_x;
+    s32 origin_y;
+    u32 width;
+    u32 height;
+    u32 row_words;
+    u64 *bits;
+};
+
+size_t occupancy_size(EntityStore *store, Vec2 atom_size);
+void occupancy_build(OccupancyMap *map, Arena *arena, EntityStore *store, Vec2 atom_size);
+void occupancy_remove(OccupancyMap *map, EntityStore *store, Rect r);
+b8 occupancy_test(OccupancyMap *map, s32 x, s32 y);
+b8 occupancy_any(OccupancyMap *map, s32 x0, s32 y0, s32 x1, s32 y1);
+b8 occupancy_touches(OccupancyMap *map, Rect r);
+s32 occupancy_find_right(OccupancyMap *map, s32 y, s32 x);
@@ -0,0 +1,307 @@
+#include "sweep_prune.h"
+
+// more endpoints than this added since the last sort and the arrays are sorted
+// from scratch, insertion sort only pays off when they are nearly sorted
+#define SWEEP_PRUNE_RESORT_MIN 64
+
+static inline b8 sweep_prune_endpoint_less(SweepPruneEndpoint a, SweepPruneEndpoint b) {
+  // min endpoints go first on ties, touching boxes overlap
+  return a.value < b.value || (a.value == b.value && (a.data & 1) < (b.data & 1));
+}
+
+static int sweep_prune_endpoint_compare(const void *a, const void *b) {
+  SweepPruneEndpoint ea = *(const SweepPruneEndpoint*)a;
+  SweepPruneEndpoint eb = *(const SweepPruneEndpoint*)b;
+  if (sweep_prune_endpoint_less(ea, eb)) {
+    return -1;
+  }
+  if (sweep_prune_endpoint_less(eb, ea)) {
+    return 1;
+  }
+  return 0;
+}
+
+static u32 sweep_prune_table_capacity(u32 pair_capacity) {
+  // at most half full
+  u32 capacity = 16;
+  while (capacity < 2*pair_capacity) {
+    capacity <<= 1;
+  }
+  return capacity;
+}
+
+size_t sweep_prune_size(u32 body_capacity, u32 pair_capacity) {
+  return (size_t)body_capacity*(sizeof(SweepPruneBody) + 3*sizeof(u32) + 4*sizeof(SweepPruneEndpoint)) +
+	 (size_t)pair_capacity*(sizeof(SweepPrunePair) + sizeof(u64)) +
+	 (size_t)sweep_prune_table_capacity(pair_capacity)*(sizeof(u64) + sizeof(u32)) + 10*ALIGNMENT;
+}
+
+void sweep_prune_init(SweepPrune *sap, Arena *arena, u32 body_capacity, u32 pair_capacity) {
+  memset(sap, 0, sizeof(SweepPrune));
+  sap->body_capacity = body_capacity;
+  sap->pair_capacity = pair_capacity;
+  sap->bodies = (SweepPruneBody*)arena_alloc(arena, body_capacity*sizeof(SweepPruneBody));
+  sap->free_bodies = (u32*)arena_alloc(arena, body_capacity*sizeof(u32));
+  sap->endpoints[0] = (SweepPruneEndpoint*)arena_alloc(arena, 2*body_capacity*sizeof(SweepPruneEndpoint));
+  sap->endpoints[1] = (SweepPruneEndpoint*)arena_alloc(arena, 2*body_capacity*sizeof(SweepPruneEndpoint));
+  sap->overlaps = (u64*)arena_alloc(arena, pair_capacity*sizeof(u64));
+  sap->overlap_table_capacity = sweep_prune_table_capacity(pair_capacity);
+  sap->overlap_keys = (u64*)arena_alloc(arena, sap->overlap_table_capacity*sizeof(u64));
+  sap->overlap_slots = (u32*)arena_alloc(arena, sap->overlap_table_capacity*sizeof(u32));
+  memset(sap->overlap_slots, 0xFF, sap->overlap_table_capacity*sizeof(u32));
+  sap->active_static = (u32*)arena_alloc(arena, body_capacity*sizeof(u32));
+  sap->active_dynamic = (u32*)arena_alloc(arena, body_capacity*sizeof(u32));
+  sap->pairs = (SweepPrunePair*)arena_alloc(arena, pair_capacity*sizeof(SweepPrunePair));
+}
+
+// ==================== OVERLAP SET ====================
+static inline u64 sweep_prune_pair_key(u32 a, u32 b) {
+  return a < b ? ((u64)a << 32) | b : ((u64)b << 32) | a;
+}
+
+static inline u32 sweep_prune_pair_hash(u64 key) {
+  return (u32)((key*0x9E3779B97F4A7C15ull) >> 32);
+}
+
+static u32 sweep_prune_overlap_bucket(SweepPrune *sap, u64 key) {
+  u32 mask = sap->overlap_table_capacity - 1;
+  u32 i = sweep_prune_pair_hash(key) & mask;
+  for (; sap->overlap_slots[i] != SWEEP_PRUNE_NULL; i = (i + 1) & mask) {
+    if (sap->overlap_keys[i] == key) {
+      break;
+    }
+  }
+  return i;
+}
+
+static void sweep_prune_overlap_clear(SweepPrune *sap) {
+  memset(sap->overlap_slots, 0xFF, sap->overlap_table_capacity*sizeof(u32));
+  sap->overlap_count = 0;
+  sap->overlap_total = 0;
+  sap->overlaps_full = 0;
+}
+
+static void sweep_prune_overlap_add(SweepPrune *sap, u64 key) {
+  u32 i = sweep_prune_overlap_bucket(sap, key);
+  if (sap->overlap_slots[i] != SWEEP_PRUNE_NULL) {
+    return;
+  }
+  if (sap->overlap_count == sap->pair_capacity) {
+    sap->overlaps_full = 1;
+    return;
+  }
+  sap->overlap_keys[i] = key;
+  sap->overlap_slots[i] = sap->overlap_count;
+  sap->overlaps[sap->overlap_count++] = key;
+}
+
+// @description: removes key if it is in the set, the last pair of the dense list
+// fills its place and entries after it in the probe sequence are shifted back
+// like in entity_id_map_remove
+static void sweep_prune_overlap_remove(SweepPrune *sap, u64 key) {
+  u32 i = sweep_prune_overlap_bucket(sap, key);
+  u32 slot = sap->overlap_slots[i];
+  if (slot == SWEEP_PRUNE_NULL) {
+    return;
+  }
+  u64 last = sap->overlaps[--sap->overlap_count];
+  if (slot != sap->overlap_count) {
+    sap->overlaps[slot] = last;
+    sap->overlap_slots[sweep_prune_overlap_bucket(sap, last)] = slot;
+  }
+
+  u32 mask = sap->overlap_table_capacity - 1;
+  u32 j = i;
+  while (1) {
+    j = (j + 1) & mask;
+    if (sap->overlap_slots[j] == SWEEP_PRUNE_NULL) {
+      break;
+    }
+    u32 home = sweep_prune_pair_hash(sap->overlap_keys[j]) & mask;
+    b8 stays = i <= j ? (home > i && home <= j) : (home > i || home <= j);
+    if (!stays) {
+      sap->overlap_keys[i] = sap->overlap_keys[j];
+      sap->overlap_slots[i] = sap->overlap_slots[j];
+      i = j;
+    }
+  }
+  sap->overlap_slots[i] = SWEEP_PRUNE_NULL;
+}
+
+static inline b8 sweep_prune_boxes_overlap(SweepPrune *sap, u32 a, u32 b) {
+  Rect ba = sap->bodies[a].box;
+  Rect bb = sap->bodies[b].box;
+  return ba.lb.x <= bb.rt.x && bb.lb.x <= ba.rt.x && ba.lb.y <= bb.rt.y && bb.lb.y <= ba.rt.y;
+}
+
+// @note: a and b started to overlap on one axis, they are a pair if the
+// boxes overlap on the other one too
+static inline void sweep_prune_overlap_begin(SweepPrune *sap, u32 a, u32 b) {
+  if (a == b || (sap->bodies[a].is_static && sap->bodies[b].is_static)) {
+    return;
+  }
+  if (sweep_prune_boxes_overlap(sap, a, b)) {
+    sweep_prune_overlap_add(sap, sweep_prune_pair_key(a, b));
+  }
+}
+
+// ==================== BODIES ====================
+// @description: adds a body, returns its id or SWEEP_PRUNE_NULL when full.
+// The body takes part in sweep_prune_pairs after the next sweep_prune_update.
+u32 sweep_prune_add(SweepPrune *sap, Rect box, u32 user, b8 is_static) {
+  u32 body;
+  if (sap->free_count > 0) {
+    body = sap->free_bodies[--sap->free_count];
+  } else if (sap->body_count < sap->body_capacity) {
+    body = sap->body_count++;
+  } else {
+    return SWEEP_PRUNE_NULL;
+  }
+  sap->bodies[body] = SweepPruneBody{box, user, is_static, 1, 0};
+  // @note: appended endpoints sort as if the body was past the end of both
+  // axes, overlapping nothing, so the swaps that move them into place add
+  // its pairs
+  for (u32 axis = 0; axis < 2; axis++) {
+    sap->endpoints[axis][sap->endpoint_count] = SweepPruneEndpoint{box.lb.data[axis], body << 1};
+    sap->endpoints[axis][sap->endpoint_count + 1] = SweepPruneEndpoint{box.rt.data[axis], (body << 1) | 1};
+  }
+  sap->endpoint_count += 2;
+  sap->unsorted_count += 2;
+  return body;
+}
+
+void sweep_prune_remove(SweepPrune *sap, u32 body) {
+  SDL_assert(body < sap->body_count && sap->bodies[body].is_used);
+  // @note: O(n), keeps the rest of the arrays in order
+  u32 kept = 0;
+  for (u32 axis = 0; axis < 2; axis++) {
+    SweepPruneEndpoint *endpoints = sap->endpoints[axis];
+    kept = 0;
+    for (u32 i = 0; i < sap->endpoint_count; i++) {
+      if ((endpoints[i].data >> 1) != body) {
+	endpoints[kept++] = endpoints[i];
+      }
+    }
+  }
+  sap->endpoint_count = kept;
+  // backwards, remove moves the last pair into the hole
+  for (u32 i = sap->overlap_count; i > 0; i--) {
+    u64 key = sap->overlaps[i - 1];
+    if ((u32)(key >> 32) == body || (u32)key == body) {
+      sweep_prune_overlap_remove(sap, key);
+    }
+  }
+  sap->bodies[body].is_used = 0;
+  sap->free_bodies[sap->free_count++] = body;
+}
+
+void sweep_prune_move(SweepPrune *sap, u32 body, Rect box) {
+  SDL_assert(body < sap->body_count && sap->bodies[body].is_used);
+  sap->bodies[body].box = box;
+}
+
+// ==================== UPDATE ====================
+static inline void sweep_prune_emit(SweepPrune *sap, u32 a, u32 b) {
+  if (sap->bodies[a].box.rt.y < sap->bodies[b].box.lb.y || sap->bodies[a].box.lb.y > sap->bodies[b].box.rt.y) {
+    return;
+  }
+  sweep_prune_overlap_add(sap, sweep_prune_pair_key(a, b));
+  sap->overlap_total++;
+}
+
+// @description: finds the overlap set from scratch, after a bulk add or when it
+// did not fit in pair_capacity
+static void sweep_prune_sweep(SweepPrune *sap) {
+  sweep_prune_overlap_clear(sap);
+  SweepPruneEndpoint *endpoints = sap->endpoints[0];
+  u32 static_count = 0;
+  u32 dynamic_count = 0;
+
+  // @step: sweep along x, bodies between their min and max endpoint overlap on x
+  // with every body that starts while they are active
+  for (u32 i = 0; i < sap->endpoint_count; i++) {
+    u32 body = endpoints[i].data >> 1;
+    SweepPruneBody *b = &sap->bodies[body];
+    if (endpoints[i].data & 1) {
+      u32 *active = b->is_static ? sap->active_static : sap->active_dynamic;
+      u32 *active_count = b->is_static ? &static_count : &dynamic_count;
+      u32 last = active[--(*active_count)];
+      active[b->active_slot] = last;
+      sap->bodies[last].active_slot = b->active_slot;
+      continue;
+    }
+
+    for (u32 k = 0; k < dynamic_count; k++) {
+      sweep_prune_emit(sap, sap->active_dynamic[k], body);
+    }
+    if (b->is_static) {
+      b->active_slot = static_count;
+      sap->active_static[static_count++] = body;
+    } else {
+      for (u32 k = 0; k < static_count; k++) {
+	sweep_prune_emit(sap, sap->active_static[k], body);
+      }
+      b->active_slot = dynamic_count;
+      sap->active_dynamic[dynamic_count++] = body;
+    }
+  }
+}
+
+// @description: refreshes the endpoints from the body boxes and sorts them,
+// keeping the overlap set up to date
+void sweep_prune_update(SweepPrune *sap) {
+  b8 resort = sap->unsorted_count > SWEEP_PRUNE_RESORT_MIN;
+  b8 track = !resort && !sap->overlaps_full;
+  u32 count = sap->endpoint_count;
+  for (u32 axis = 0; axis < 2; axis++) {
+    SweepPruneEndpoint *endpoints = sap->endpoints[axis];
+    for (u32 i = 0; i < count; i++) {
+      SweepPruneBody *body = &sap->bodies[endpoints[i].data >> 1];
+      endpoints[i].value = (endpoints[i].data & 1) ? body->box.rt.data[axis] : body->box.lb.data[axis];
+    }
+
+    if (resort) {
+      qsort(endpoints, count, sizeof(SweepPruneEndpoint), sweep_prune_endpoint_compare);
+      continue;
+    }
+    // @step: insertion sort, bodies only move a little between frames so
+    // every endpoint is a few places off at most. A min endpoint moving left
+    // past a max endpoint starts an overlap on this axis, a max endpoint
+    // moving left past a min endpoint ends one.
+    for (u32 i = 1; i < count; i++) {
+      SweepPruneEndpoint e = endpoints[i];
+      u32 j = i;
+      while (j > 0 && sweep_prune_endpoint_less(e, endpoints[j - 1])) {
+	SweepPruneEndpoint f = endpoints[j - 1];
+	if (track && (e.data & 1) != (f.data & 1)) {
+	  if (e.data & 1) {
+	    sweep_prune_overlap_remove(sap, sweep_prune_pair_key(e.data >> 1, f.data >> 1));
+	  } else {
+	    sweep_prune_overlap_begin(sap, e.data >> 1, f.data >> 1);
+	  }
+	}
+	endpoints[j] = f;
+	j--;
+      }
+      endpoints[j] = e;
+    }
+  }
+  sap->unsorted_count = 0;
+
+  if (!track || sap->overlaps_full) {
+    sweep_prune_sweep(sap);
+  }
+}
+
+// @description: every overlapping pair with at least one dynamic body, as of the
+// last sweep_prune_update. The pair list lives in the sweep and prune arena and is
+// overwritten by the next call.
+SweepPrunePairs sweep_prune_pairs(SweepPrune *sap) {
+  SDL_assert(sap->unsorted_count == 0);
+  SweepPrunePairs out = {sap->pairs, sap->overlap_count, sap->overlaps_full ? sap->overlap_total : sap->overlap_count};
+  for (u32 i = 0; i < sap->overlap_count; i++) {
+    u64 key = sap->overlaps[i];
+    out.pairs[i] = SweepPrunePair{sap->bodies[(u32)(key >> 32)].user, sap->bodies[(u32)key].user};
+  }
+  return out;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "../core.h"
+#include "../math.h"
+#include "../memory/arena.h"
+
+#define SWEEP_PRUNE_NULL 0xFFFFFFFF
+
+// @note: sweep and prune broad phase for scenes with many moving bodies.
+// Every body has a min and a max endpoint on x and on y, each axis kept sorted
+// in its own array. Bodies move a little per frame, so the arrays are nearly
+// sorted already and an insertion sort puts them back in order in close to
+// O(n). Every swap of a min and a max endpoint is a pair starting or stopping
+// to overlap on that axis, so the overlapping pairs are kept in a set that is
+// updated on the swaps instead of being found again every frame. Static
+// bodies (level geometry) take part in the sort, but static vs static pairs
+// are never reported. Overlap includes touching edges, like aabb_collision_rect.
+struct SweepPruneEndpoint {
+    r32 value;
+    u32 data;		// body << 1 | is_max
+};
+
+struct SweepPruneBody {
+    Rect box;
+    u32 user;
+    b8 is_static;
+    b8 is_used;
+    u32 active_slot;	// sweep scratch, position in active_static or active_dynamic
+};
+
+struct SweepPrunePair {
+    u32 user_a;
+    u32 user_b;
+};
+
+struct SweepPrunePairs {
+    SweepPrunePair *pairs;
+    u32 count;
+    u32 overlap_count;	// all overlapping pairs, > count when the pair list was full
+};
+
+struct SweepPrune {
+    SweepPruneBody *bodies;
+    u32 body_count;		// high water mark, freed bodies stay in place
+    u32 body_capacity;
+    u32 *free_bodies;
+    u32 free_count;
+    SweepPruneEndpoint *endpoints[2];	// x and y
+    u32 endpoint_count;
+    u32 unsorted_count;	// endpoints added since the last sort
+    // overlapping pairs as body_a << 32 | body_b with body_a < body_b, in a
+    // dense list and an open addressing table of indices into it
+    u64 *overlaps;
+    u32 overlap_count;
+    u32 overlap_total;	// > overlap_count when the list was full
+    u64 *overlap_keys;
+    u32 *overlap_slots;
+    u32 overlap_table_capacity;
+    b8 overlaps_full;	// the list ran out of room, re-swept every update until it fits
+    // sweep scratch and output
+    u32 *active_static;
+    u32 *active_dynamic;
+    SweepPrunePair *pairs;
+    u32 pair_capacity;
+};
+
+size_t sweep_prune_size(u32 body_capacity, u32 pair_capacity);
+void sweep_prune_init(SweepPrune *sap, Arena *arena, u32 body_capacity, u32 pair_capacity);
+u32 sweep_prune_add(SweepPrune *sap, Rect box, u32 user, b8 is_static);
+void sweep_prune_remove(SweepPrune *sap, u32 body);
+void sweep_prune_move(SweepPrune *sap, u32 body, Rect box);
+void sweep_prune_update(SweepPrune *sap);
+SweepPrunePairs sweep_prune_pairs(SweepPrune *sap);
@@ -0,0 +1,108 @@
+#include "swept.h"
+
+// rects that only touch do not overlap, like in swept_aabb
+static inline b8 swept_overlap(Rect a, Rect b) {
+  return a.lb.x < b.rt.x && b.lb.x < a.rt.x && a.lb.y < b.rt.y && b.lb.y < a.rt.y;
+}
+
+// @description: target without its outer `penetration`, at most a quarter of its size
+static inline Rect swept_core(Rect target, r32 penetration) {
+  Vec2 inset;
+  inset.x = MIN(penetration, (target.rt.x - target.lb.x)*0.25f);
+  inset.y = MIN(penetration, (target.rt.y - target.lb.y)*0.25f);
+  return Rect{target.lb + inset, target.rt - inset};
+}
+
+// @description: time in [0, 1) at which `moving`, moved by motion*t, starts
+// to overlap target, and the axis (0: x, 1: y) it overlaps on last, which is
+// the side that was hit. Rects that only touch do not overlap, rects that
+// already overlap at t = 0 are not a hit.
+b8 swept_aabb(Rect moving, Vec2 motion, Rect target, r32 *entry_time, u32 *entry_axis) {
+  r32 entry[2];
+  r32 exit[2];
+  for (u32 axis = 0; axis < 2; axis++) {
+    r32 d = motion.data[axis];
+    r32 a_min = moving.lb.data[axis];
+    r32 a_max = moving.rt.data[axis];
+    r32 b_min = target.lb.data[axis];
+    r32 b_max = target.rt.data[axis];
+    if (d > 0.0f) {
+      entry[axis] = (b_min - a_max)/d;
+      exit[axis] = (b_max - a_min)/d;
+    } else if (d < 0.0f) {
+      entry[axis] = (b_max - a_min)/d;
+      exit[axis] = (b_min - a_max)/d;
+    } else {
+      if (a_max <= b_min || a_min >= b_max) {
+	return 0;
+      }
+      entry[axis] = -INFINITY;
+      exit[axis] = INFINITY;
+    }
+  }
+  // ties go to y, landing on a corner is a landing
+  u32 axis = entry[0] > entry[1] ? 0 : 1;
+  r32 t_entry = entry[axis];
+  r32 t_exit = MIN(exit[0], exit[1]);
+  if (t_entry >= t_exit || t_entry < 0.0f || t_entry >= 1.0f) {
+    return 0;
+  }
+  *entry_time = t_entry;
+  *entry_axis = axis;
+  return 1;
+}
+
+// @description: motion, cut short so that `from` stops `penetration` inside the first
+// target it hits along each axis. Targets are bounds[indices[i]], or bounds[i] when
+// indices is NULL. Hits are resolved in the order they happen: after the first
+// axis is cut the rest of the motion is swept again, a target the player would
+// now miss no longer stops it. Last the motion is cut short where it would pass
+// through a target without ending inside it.
+Vec2 swept_clamp_motion(Rect from, Vec2 motion, const Rect *bounds, const u32 *indices, u32 count,
+			r32 penetration) {
+  b8 clamped[2] = {0, 0};
+  for (u32 pass = 0; pass < 2; pass++) {
+    r32 first_time = 1.0f;
+    u32 first_axis = 0;
+    const Rect *first = NULL;
+    for (u32 i = 0; i < count; i++) {
+      const Rect *target = indices ? &bounds[indices[i]] : &bounds[i];
+      r32 time;
+      u32 axis;
+      if (swept_aabb(from, motion, *target, &time, &axis) && !clamped[axis] && time < first_time) {
+	first_time = time;
+	first_axis = axis;
+	first = target;
+      }
+    }
+    if (first == NULL) {
+      break;
+    }
+
+    // @step: move up to the impact, then into the target, never past the target
+    // or past where the motion was going anyway
+    r32 d = motion.data[first_axis];
+    r32 thickness = first->rt.data[first_axis] - first->lb.data[first_axis];
+    r32 distance = fabsf(d)*first_time + MIN(penetration, thickness*0.5f);
+    distance = MIN(distance, fabsf(d));
+    motion.data[first_axis] = d > 0.0f ? distance : -distance;
+    clamped[first_axis] = 1;
+  }
+
+  // @step: an axis cut short can leave the motion clipping the corner of a target
+  // on its way to the end. The motion is cut where it enters the first target it
+  // passes through and does not end in, ignoring grazes of its outer
+  // `penetration`. A shorter motion along the same line enters nothing new.
+  Rect to = Rect{from.lb + motion, from.rt + motion};
+  r32 first_time = 1.0f;
+  for (u32 i = 0; i < count; i++) {
+    const Rect *target = indices ? &bounds[indices[i]] : &bounds[i];
+    r32 time;
+    u32 axis;
+    if (!swept_overlap(to, *target) && swept_aabb(from, motion, swept_core(*target, penetration), &time, &axis) &&
+	time < first_time) {
+      first_time = time;
+    }
+  }
+  return motion*first_time;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "../core.h"
+#include "../math.h"
+
+// how far a clamped motion reaches into the target it hit, the contact rules
+// of the collision pass only see a contact once the rects overlap
+#define SWEPT_PENETRATION 0.1f
+
+// @note: continuous collision for the player. The collision pass only looks at
+// where the player starts and ends a frame, so a fast player (or a long frame)
+// can step over a target thinner than its displacement. Sweeping the player's
+// rect along the displacement finds the time of impact with every target, and
+// the displacement is cut short at the first one on each axis.
+b8 swept_aabb(Rect moving, Vec2 motion, Rect target, r32 *entry_time, u32 *entry_axis);
+Vec2 swept_clamp_motion(Rect from, Vec2 motion, const Rect *bounds, const u32 *indices, u32 count,
+			r32 penetration);
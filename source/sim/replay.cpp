@@ -0,0 +1,122 @@
+#include "replay.h"
+
+static u32 replay_buttons(Controller *controller) {
+  u32 buttons = 0;
+  buttons |= controller->move_up ? REPLAY_MOVE_UP : 0;
+  buttons |= controller->move_down ? REPLAY_MOVE_DOWN : 0;
+  buttons |= controller->move_left ? REPLAY_MOVE_LEFT : 0;
+  buttons |= controller->move_right ? REPLAY_MOVE_RIGHT : 0;
+  buttons |= controller->jump ? REPLAY_JUMP : 0;
+  buttons |= controller->toggle_gravity ? REPLAY_TOGGLE_GRAVITY : 0;
+  buttons |= controller->flip_gravity ? REPLAY_FLIP_GRAVITY : 0;
+  return buttons;
+}
+
+// @description: starts recording a run from the start of level_name, with the player in start
+void replay_record_begin(ReplayRecorder *recorder, const char *level_name, SimState *start) {
+  memset(&recorder->header, 0, sizeof(ReplayHeader));
+  recorder->header.magic = REPLAY_MAGIC;
+  recorder->header.version = REPLAY_VERSION;
+  recorder->header.sim_state_size = sizeof(SimState);
+  recorder->header.tick_rate = SIM_TICK_RATE;
+  strncpy(recorder->header.level_name, level_name, sizeof(recorder->header.level_name) - 1);
+  recorder->header.start = *start;
+  recorder->event_capacity = 256;
+  recorder->events = (ReplayEvent*)malloc(recorder->event_capacity*sizeof(ReplayEvent));
+  SDL_assert(recorder->events != NULL);
+}
+
+// @description: samples the input the next tick runs with, call it right before the tick
+void replay_record_tick(ReplayRecorder *recorder, Controller *controller, const r32 *key_down_time) {
+  ReplayHeader *header = &recorder->header;
+  ReplayEvent event = {(u32)header->tick_count, replay_buttons(controller),
+		       key_down_time[PK_A], key_down_time[PK_D]};
+  header->tick_count++;
+  if (header->event_count > 0) {
+    ReplayEvent *last = &recorder->events[header->event_count - 1];
+    if (last->buttons == event.buttons && last->key_down_a == event.key_down_a &&
+	last->key_down_d == event.key_down_d) {
+      return;
+    }
+  }
+  if (header->event_count == recorder->event_capacity) {
+    recorder->event_capacity *= 2;
+    recorder->events = (ReplayEvent*)realloc(recorder->events, recorder->event_capacity*sizeof(ReplayEvent));
+    SDL_assert(recorder->events != NULL);
+  }
+  recorder->events[header->event_count++] = event;
+}
+
+// @description: writes the run to path and frees the recorder
+b8 replay_record_end(ReplayRecorder *recorder, const char *path, Vec3 end_position) {
+  recorder->header.end_position = end_position;
+  FILE *file = fopen(path, "wb");
+  b8 res = file != NULL;
+  if (res) {
+    res = (
+      fwrite(&recorder->header, sizeof(ReplayHeader), 1, file) == 1 &&
+      fwrite(recorder->events, sizeof(ReplayEvent), recorder->header.event_count, file) == recorder->header.event_count
+    );
+    res = (fclose(file) == 0) && res;
+  }
+  free(recorder->events);
+  recorder->events = NULL;
+  return res;
+}
+
+// @description: loads a replay, returns 0 if it is missing or was recorded by a
+// build with a different SimState
+b8 replay_open(ReplayPlayer *player, const char *path) {
+  memset(player, 0, sizeof(ReplayPlayer));
+  size_t fsize = 0;
+  void *data = SDL_LoadFile(path, &fsize);
+  if (data == NULL) {
+    return 0;
+  }
+  ReplayHeader *header = (ReplayHeader*)data;
+  b8 valid = (
+    fsize >= sizeof(ReplayHeader) &&
+    header->magic == REPLAY_MAGIC &&
+    header->version == REPLAY_VERSION &&
+    header->sim_state_size == sizeof(SimState) &&
+    header->tick_rate > 0 &&
+    sizeof(ReplayHeader) + (u64)header->event_count*sizeof(ReplayEvent) <= fsize &&
+    header->level_name[sizeof(header->level_name) - 1] == 0
+  );
+  if (!valid) {
+    SDL_free(data);
+    return 0;
+  }
+  player->data = data;
+  player->header = header;
+  player->events = (ReplayEvent*)((unsigned char*)data + sizeof(ReplayHeader));
+  return 1;
+}
+
+// @description: sets the input of the next tick, returns 0 once the run is over
+b8 replay_play_tick(ReplayPlayer *player, Controller *controller, r32 *key_down_time) {
+  if (player->tick >= player->header->tick_count) {
+    return 0;
+  }
+  while (player->next_event < player->header->event_count &&
+	 player->events[player->next_event].tick <= player->tick) {
+    player->input = player->events[player->next_event++];
+  }
+  u32 buttons = player->input.buttons;
+  controller->move_up = (buttons & REPLAY_MOVE_UP) != 0;
+  controller->move_down = (buttons & REPLAY_MOVE_DOWN) != 0;
+  controller->move_left = (buttons & REPLAY_MOVE_LEFT) != 0;
+  controller->move_right = (buttons & REPLAY_MOVE_RIGHT) != 0;
+  controller->jump = (buttons & REPLAY_JUMP) != 0;
+  controller->toggle_gravity = (buttons & REPLAY_TOGGLE_GRAVITY) != 0;
+  controller->flip_gravity = (buttons & REPLAY_FLIP_GRAVITY) != 0;
+  key_down_time[PK_A] = player->input.key_down_a;
+  key_down_time[PK_D] = player->input.key_down_d;
+  player->tick++;
+  return 1;
+}
+
+void replay_close(ReplayPlayer *player) {
+  SDL_free(player->data);
+  memset(player, 0, sizeof(ReplayPlayer));
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "../core.h"
+#include "../math.h"
+#include "sim.h"
+
+// ==================== REPLAYS ====================
+// @note: a replay is the input of a run, [ReplayHeader][ReplayEvent * event_count].
+// Input is sampled before every tick and an event is only written when it changes,
+// it holds until the next one. The run starts at the start of header.level_name
+// with the player in header.start, so feeding the events back through sim_step at
+// header.tick_rate plays the run again, down to the last bit of the player position.
+#define REPLAY_MAGIC 0x50525053 // "SPRP"
+#define REPLAY_VERSION 0x1
+
+#define REPLAY_MOVE_UP		(1 << 0)
+#define REPLAY_MOVE_DOWN	(1 << 1)
+#define REPLAY_MOVE_LEFT	(1 << 2)
+#define REPLAY_MOVE_RIGHT	(1 << 3)
+#define REPLAY_JUMP		(1 << 4)
+#define REPLAY_TOGGLE_GRAVITY	(1 << 5)
+#define REPLAY_FLIP_GRAVITY	(1 << 6)
+
+struct ReplayHeader {
+    u32 magic;
+    u32 version;
+    u32 sim_state_size;	// sizeof(SimState) the run was recorded with
+    u32 tick_rate;	// every tick of the run is 1/tick_rate seconds
+    u64 tick_count;
+    u32 event_count;
+    u32 reserved;
+    char level_name[48];
+    SimState start;
+    Vec3 end_position;	// player position after the last tick
+};
+
+struct ReplayEvent {
+    u32 tick;		// first tick the input applies to
+    u32 buttons;	// REPLAY_* bits
+    // key_down_time[PK_A] and [PK_D], the only ones sim_step reads
+    r32 key_down_a;
+    r32 key_down_d;
+};
+
+struct ReplayRecorder {
+    ReplayHeader header;
+    ReplayEvent *events;
+    u32 event_capacity;
+};
+
+struct ReplayPlayer {
+    void *data;
+    ReplayHeader *header;
+    ReplayEvent *events;
+    u32 next_event;
+    u64 tick;
+    ReplayEvent input;
+};
+
+void replay_record_begin(ReplayRecorder *recorder, const char *level_name, SimState *start);
+void replay_record_tick(ReplayRecorder *recorder, Controller *controller, const r32 *key_down_time);
+b8 replay_record_end(ReplayRecorder *recorder, const char *path, Vec3 end_position);
+b8 replay_open(ReplayPlayer *player, const char *path);
+b8 replay_play_tick(ReplayPlayer *player, Controller *controller, r32 *key_down_time);
+void replay_close(ReplayPlayer *player);
+
+inline r32 replay_tick_seconds(ReplayPlayer *player) {
+    return (r32)(1.0/(r64)player->header->tick_rate);
+}
@@ -0,0 +1,462 @@
+#include "sim.h"
+
+SimTuning sim_tuning(Vec2 render_scale) {
+  r32 motion_scale = 2.0f*render_scale.x;
+  SimTuning tuning = {};
+  tuning.fall_accelx = 3.0f*motion_scale;
+  tuning.move_accelx = 4.0f*motion_scale;
+  tuning.max_speedx = 5.0f*motion_scale;
+  tuning.freefall_accel = -11.8f*motion_scale;
+  tuning.jump_force = 6.5f*motion_scale;
+  tuning.noclip_speed = 8.0f*render_scale.x;
+  tuning.teleport_snap = 5.0f*render_scale.x;
+  return tuning;
+}
+
+void sim_init(SimState *sim) {
+  *sim = {};
+  sim->jump_count = 1;
+  sim->gravity_diry = 1.0f;
+}
+
+// @description: what a level (re)start resets, the rest of the player carries over
+void sim_level_reset(SimState *sim) {
+  sim->level_state = 0;
+  sim->effective_force = 0.0f;
+  sim->player_velocity = Vec2{0.0f, 0.0f};
+  sim->gravity_diry = 1.0f;
+}
+
+Vec2 get_move_dir(Controller c) {
+  Vec2 dir = {};
+  if (c.move_up) {
+    dir.y = 1.0f;
+  }
+  if (c.move_down) {
+    dir.y = -1.0f;
+  }
+  if (c.move_left) {
+    dir.x = -1.0f;
+  }
+  if (c.move_right) {
+    dir.x = 1.0f;
+  }
+
+  return dir;
+}
+
+// @description: the obstacle the player stands on, ENTITY_INVALID_INDEX if there is none.
+// Ground is below for gravity_diry > 0, above otherwise, within SIM_GROUND_PROBE.
+static u32 sim_find_ground(SimLevel *level, Rect bounds, r32 gravity_diry) {
+  Rect probe = bounds;
+  if (gravity_diry > 0.0f) {
+    probe.lb.y -= SIM_GROUND_PROBE;
+  } else {
+    probe.rt.y += SIM_GROUND_PROBE;
+  }
+  if (level->collision_grid->spawned_count == 0 && !occupancy_touches(level->occupancy, probe)) {
+    return ENTITY_INVALID_INDEX;
+  }
+  ColliderQuery candidates = collision_grid_query(level->collision_grid, level->colliders, probe);
+  for (u32 k = 0; k < candidates.count; k++) {
+    Rect target = level->colliders->bounds[candidates.indices[k]];
+    b8 overlap_x = bounds.lb.x < target.rt.x && bounds.rt.x > target.lb.x;
+    b8 in_gap = gravity_diry > 0.0f ?
+      (target.rt.y <= bounds.lb.y && target.rt.y >= probe.lb.y) :
+      (target.lb.y >= bounds.rt.y && target.lb.y <= probe.rt.y);
+    if (overlap_x && in_gap) {
+      return candidates.indices[k];
+    }
+  }
+  return ENTITY_INVALID_INDEX;
+}
+
+// @description: advances the player by dt seconds: input, movement, collision,
+// goals and teleporters. key_down_time orders A and D by when they were pressed,
+// the later one wins.
+void sim_step(SimState *sim, SimLevel *level, SimTuning *tuning, Controller *controller,
+	      const r32 *key_down_time, r32 dt) {
+  // velocities are per SIM_TUNING_RATE frame
+  r32 frames = dt*SIM_TUNING_RATE;
+  r64 dt_ms = (r64)dt*1000.0;
+  b8 jump = controller->jump;
+  b8 toggle_gravity = controller->toggle_gravity;
+  if (controller->flip_gravity) {
+    sim->flip_gravity = 1;
+  }
+  controller->jump = 0;
+  controller->toggle_gravity = 0;
+  controller->flip_gravity = 0;
+  sim->teleported = 0;
+
+  // @section: input processing
+  if (toggle_gravity) {
+    sim->is_gravity = !sim->is_gravity;
+    sim->player_velocity = Vec2{0.0f, 0.0f};
+    sim->move_dir.x = 0.0f;
+    sim->effective_force = 0.0f;
+    sim->motion_dir = {0};
+  }
+  if (controller->move_up) {
+    sim->move_dir.y = 1.0f;
+  }
+  if (controller->move_down) {
+    sim->move_dir.y = -1.0f;
+  }
+
+  PlatformKey horizontal_move = PK_NIL;
+  b8 is_key_down_x = false;
+  if (key_down_time[PK_A] != 0.0f || key_down_time[PK_D] != 0.0f) {
+    horizontal_move = key_down_time[PK_A] > key_down_time[PK_D] ? PK_A : PK_D;
+  }
+  if (horizontal_move == PK_A && controller->move_left) {
+    sim->move_dir.x = -1.0f;
+    is_key_down_x = true;
+  }
+  if (horizontal_move == PK_D && controller->move_right) {
+    sim->move_dir.x = 1.0f;
+    is_key_down_x = true;
+  }
+
+  if (jump && sim->jump_count > 0 && sim->jump_timer > 100.0f) {
+    sim->jump_count--;
+    sim->jump_timer = 0.0f;
+  } else {
+    jump = 0;
+  }
+
+  // jump increment
+  sim->jump_timer += dt_ms;
+  if (sim->is_collide_bottom == 1 && sim->gravity_diry > 0.0f) {
+    sim->jump_count = 1;
+  }
+  if (sim->is_collide_top == 1 && sim->gravity_diry < 0.0f) {
+    sim->jump_count = 1;
+  }
+
+  // @section: gravity
+  if (sim->flip_gravity) {
+    sim->gravity_diry = sim->gravity_diry > 0.0f ? -0.8f : 1.0f;
+    sim->flip_gravity = 0;
+  }
+  Vec2 velocity = Vec2{0.0f, 0.0f};
+  sim->motion_dir = {0};
+  if (sim->collidey) {
+    sim->player_velocity.y = 0.0f;
+  }
+  if (sim->collidex) {
+    sim->player_velocity.x = 0.0f;
+  }
+  if (sim->is_gravity) {
+    // @section: game_movement
+    // calculate force acting on player
+    if (sim->collidey) {
+      if (sim->collidex) {
+	sim->effective_force = 0.0f;
+      } else if (is_key_down_x) {
+	r32 updated_force = sim->effective_force + sim->move_dir.x*tuning->move_accelx*dt;
+	sim->effective_force = clampf(updated_force, -tuning->max_speedx, tuning->max_speedx);
+      } else {
+	r32 friction = 0.0f;
+	if (sim->effective_force > 0.0f) {
+	  friction = -tuning->move_accelx*dt;
+	} else if (sim->effective_force < 0.0f) {
+	  friction = tuning->move_accelx*dt;
+	}
+	r32 updated_force = sim->effective_force + friction;
+	sim->effective_force = ABS(updated_force) < 0.5f ? 0.0f : updated_force;
+      }
+    } else {
+      r32 net_force = 0.0f;
+      r32 active_force = 0.0f;
+      if (!sim->collidex) {
+	net_force = sim->effective_force;
+	if (jump) {
+	  // @step: if in the air and jumping in a different direction
+	  // allow more immediate feeling force, instead of the jump adding into net_force
+	  // which gives off, more of a floaty feeling.
+	  r32 threshed_force = roundf(net_force);
+	  b8 move_dir_different = (threshed_force >= 0 && sim->move_dir.x < 0) || (threshed_force <= 0 && sim->move_dir.x > 0);
+	  if (move_dir_different) {
+	    active_force = sim->move_dir.x*tuning->fall_accelx/2.0f;
+	    net_force = active_force;
+	  }
+	} else {
+	  if (is_key_down_x) {
+	    // player is slowing down, in that case, we allow this movement.
+	    b8 move_dir_opposite = (net_force > 0 && sim->move_dir.x < 0) || (net_force < 0 && sim->move_dir.x > 0);
+	    if (move_dir_opposite || ABS(net_force) < tuning->fall_accelx*0.15f) {
+	      active_force = sim->move_dir.x*tuning->fall_accelx*dt;
+	      net_force = clampf(net_force + active_force, -tuning->fall_accelx, tuning->fall_accelx);
+	    }
+	  }
+	  if (ABS(net_force) >= tuning->fall_accelx) {
+	    // @note: air resistance, smooths the speed down when the player
+	    // moves from a platform to free fall, where the max speed is lower
+	    r32 friction = 0.0f;
+	    if (sim->effective_force > 0.0f) {
+	      friction = -tuning->fall_accelx*dt;
+	    } else if (sim->effective_force < 0.0f) {
+	      friction = tuning->fall_accelx*dt;
+	    }
+	    net_force += friction;
+	  }
+	}
+      }
+      sim->effective_force = net_force;
+    }
+
+    {
+      // horizontal motion setting
+      r32 dx1 = sim->effective_force;
+      if (dx1 == 0.0f) {
+	sim->move_dir.x = 0.0f;
+      }
+      if (dx1 < 0.0f) {
+	sim->motion_dir.x = -1.0f;
+      } else if (dx1 > 0.0f) {
+	sim->motion_dir.x = 1.0f;
+      }
+      sim->player_velocity.x = dx1;
+      velocity.x = dx1;
+    }
+
+    {
+      // vertical motion when falling
+      r32 dy1 = sim->player_velocity.y;
+      dy1 = dy1 + sim->gravity_diry*tuning->freefall_accel*dt;
+      if (jump) {
+	dy1 = sim->gravity_diry*tuning->jump_force;
+	if (!sim->collidey) {
+	  // if we are in the air, the jump force is 75% of normal
+	  dy1 = sim->gravity_diry*tuning->jump_force*0.75f;
+	}
+      }
+      if (dy1 < sim->gravity_diry*-0.01f) {
+	sim->motion_dir.y = -sim->gravity_diry;
+      } else if (dy1 > sim->gravity_diry*0.01f) {
+	sim->motion_dir.y = sim->gravity_diry;
+      }
+      sim->player_velocity.y = dy1;
+      velocity.y = dy1;
+    }
+  } else {
+    // @no_clip_movement
+    velocity = get_move_dir(*controller)*tuning->noclip_speed;
+    if (velocity.x < 0.0f) {
+      sim->motion_dir.x = -1.0f;
+    } else if (velocity.x > 0.0f) {
+      sim->motion_dir.x = 1.0f;
+    }
+    if (velocity.y < 0.0f) {
+      sim->motion_dir.y = -1.0f;
+    } else if (velocity.y > 0.0f) {
+      sim->motion_dir.y = 1.0f;
+    }
+  }
+  Vec2 pd_1 = velocity*frames;
+  sim->motion = pd_1;
+
+  // @section: collision
+  EntityStore *store = level->store;
+  Entity player = entity_store_get(store, level->player);
+  Vec3 next_player_position;
+  next_player_position.x = player.position.x + pd_1.x;
+  next_player_position.y = player.position.y + pd_1.y;
+  Rect player_next = rect(next_player_position.v2(), player.size);
+
+  b8 is_collide_x = 0;
+  b8 is_collide_y = 0;
+  sim->is_collide_bottom = 0;
+  sim->is_collide_top = 0;
+
+  // @step: broad phase, only obstacles around the swept player rect can collide.
+  // Nothing solid around it (the common case mid air) skips the pass altogether,
+  // obstacles spawned at runtime are not in the occupancy map.
+  Rect player_swept = rect_union(player.bounds, player_next);
+  ColliderSet *colliders = level->colliders;
+  ColliderQuery candidates = {NULL, 0};
+  if (level->collision_grid->spawned_count > 0 || occupancy_touches(level->occupancy, player_swept)) {
+    candidates = collision_grid_query(level->collision_grid, colliders, player_swept);
+
+    // @step: continuous collision, stop at the first obstacle along the motion.
+    // Without it a fast player steps over thin obstacles.
+    Vec2 player_motion = swept_clamp_motion(player.bounds, pd_1, colliders->bounds,
+					    candidates.indices, candidates.count, SWEPT_PENETRATION);
+    next_player_position.x = player.position.x + player_motion.x;
+    next_player_position.y = player.position.y + player_motion.y;
+    player_next = rect(next_player_position.v2(), player.size);
+  }
+  // @step: check_obstacle_collisions, CONTACT_BATCH_SIZE candidates at a time
+  for (u32 batch = 0; batch < candidates.count; batch += CONTACT_BATCH_SIZE) {
+    const u32 *batch_indices = candidates.indices + batch;
+    u32 batch_count = MIN(candidates.count - batch, (u32)CONTACT_BATCH_SIZE);
+    ContactMasks contacts = contact_batch_classify(player.bounds, player_next, colliders->bounds,
+						   batch_indices, batch_count);
+
+    // @note: a target's top/bottom sides are only tested while no earlier target
+    // collided on y, so only the first target with a top or bottom hit counts
+    u64 hit_y = is_collide_y ? 0 : (contacts.top | contacts.bottom);
+    if (hit_y) {
+      u32 first = contact_mask_first(hit_y);
+      Rect target = colliders->bounds[batch_indices[first]];
+      u64 bit = 1ull << first;
+      contacts.top &= bit;
+      contacts.bottom &= bit;
+
+      // @func: update_player_positions_if_sides_colliding
+      if (contacts.top) {
+	player.position.y -= (player.bounds.lb.y - target.rt.y - 0.1f);
+      } else {
+	player.position.y += (target.lb.y - player.bounds.rt.y - 0.1f);
+      }
+    } else {
+      contacts.top = 0;
+      contacts.bottom = 0;
+    }
+
+    u64 hit = contacts.x | contacts.top | contacts.bottom;
+    while (hit) {
+      u32 i = contact_mask_first(hit);
+      hit &= hit - 1;
+      if (colliders->types[batch_indices[i]] == INVERT_GRAVITY) {
+	// @note: gravity inverter mechanic
+	// 1. touch block, gravity flips
+	// 2. for a while after gravity is flipped, gravity will not be flipped
+	// (this collapses the cases where the player is trying to reflip gravity,
+	// but immediate contact after flipping makes this awkward and infeasible)
+	if (sim->gravity_flip_timer <= 0) {
+	  sim->gravity_flip_timer = 500.0f;
+	  sim->flip_gravity = 1;
+	}
+      }
+    }
+
+    is_collide_x = is_collide_x || contacts.x != 0;
+    is_collide_y = is_collide_y || contacts.top != 0 || contacts.bottom != 0;
+    sim->is_collide_bottom = sim->is_collide_bottom || contacts.top != 0;
+    sim->is_collide_top = sim->is_collide_top || contacts.bottom != 0;
+  }
+
+  if (!is_collide_x) {
+    player.position.x = next_player_position.x;
+  }
+  if (!is_collide_y) {
+    player.position.y = next_player_position.y;
+  }
+  // @step: the contact rules keep the start x on a side hit and snap y to the
+  // target hit on y, which is not the motion that was swept. Sweep the motion
+  // they resolved to again, so it cannot step over an obstacle either.
+  if (is_collide_x || is_collide_y) {
+    Vec2 resolved = player.position.v2() - player.bounds.lb;
+    resolved = swept_clamp_motion(player.bounds, resolved, colliders->bounds,
+				  candidates.indices, candidates.count, SWEPT_PENETRATION);
+    player.position.x = player.bounds.lb.x + resolved.x;
+    player.position.y = player.bounds.lb.y + resolved.y;
+  }
+
+  // @step: resting contact. At high tick rates a tick of gravity does not cross the
+  // gap landing leaves, the player would stand and fall on alternate ticks.
+  if (sim->is_gravity && !is_collide_y && sim->player_velocity.y*sim->gravity_diry <= 0.0f) {
+    u32 ground = sim_find_ground(level, rect(player.position.v2(), player.size), sim->gravity_diry);
+    if (ground != ENTITY_INVALID_INDEX) {
+      is_collide_y = 1;
+      if (sim->gravity_diry > 0.0f) {
+	sim->is_collide_bottom = 1;
+      } else {
+	sim->is_collide_top = 1;
+      }
+      if (colliders->types[ground] == INVERT_GRAVITY && sim->gravity_flip_timer <= 0) {
+	sim->gravity_flip_timer = 500.0f;
+	sim->flip_gravity = 1;
+      }
+    }
+  }
+
+  // check collision with goals, touching any of them completes the level
+  {
+    EntityQuery goals = entity_query(store, GOAL);
+    sim->level_state = 0;
+    for (u32 k = 0; k < goals.count; k++) {
+      Rect target = entity_bounds(store, goals.indices[k]);
+      sim->level_state |= aabb_collision_rect(player_next, target);
+    }
+  }
+
+  // @section: teleport
+  b8 inside_teleporter_now = 0;
+  b8 teleporting_now = sim->teleporting;
+  b8 teleported_now = 0;
+  Vec2 teleported_position = Vec2{player.position.x, player.position.y};
+  EntityQuery teleporters = entity_query(store, TELEPORT);
+  for (u32 k = 0; k < teleporters.count; k++) {
+    /*
+     * @note;
+     * TELEPORT START ...
+     * 1. go inside a teleport block, player marked as in block
+     * 2. hit teleport block center, player marked as teleporting
+     * 3. player teleported to new block
+     * 4. once player exits the new block, player marked as in block false
+     * 5. then player marked as teleporting false
+     * ... TELEPORT COMPLETE
+     */
+    u32 i = teleporters.indices[k];
+    Rect target = entity_bounds(store, i);
+
+    if (teleporting_now) {
+      // check if player is outside of this teleport block or not
+      b8 t_collide = aabb_collision_rect(player.bounds, target);
+      inside_teleporter_now |= t_collide;
+      continue;
+    }
+    // check if player is completely inside teleport block
+    b8 t_collide = aabb_collision_rect(player.bounds, target);
+    if (!t_collide) {
+      continue;
+    }
+
+    inside_teleporter_now |= t_collide;
+
+    // check if player x-axis is within teleport x-axis
+    Vec2 player_center = player.position.v2() + player.size/2.0f;
+    Vec2 entity_center = entity_position(store, i).v2() + entity_size(store, i)/2.0f;
+    Vec2 displacement = player_center - entity_center;
+
+    if (ABS(displacement.x) <= tuning->teleport_snap || ABS(displacement.y) <= tuning->teleport_snap) {
+      teleporting_now = 1;
+      {
+	// @step: teleport_player
+	u32 teleport_to = entity_link(store, i);
+	// We should always have the entity we are trying to look for
+	SDL_assert(teleport_to != ENTITY_INVALID_INDEX);
+	if (teleport_to != ENTITY_INVALID_INDEX) {
+	  Vec2 teleport_to_center = entity_position(store, teleport_to).v2() + entity_size(store, teleport_to)/2.0f;
+	  // set next position
+	  Vec2 teleported_position_center = teleport_to_center + displacement;
+	  teleported_position = teleported_position_center - player.size/2.0f;
+	  teleported_now = 1;
+	}
+      }
+    }
+  }
+  {
+    // update teleport variable
+    sim->inside_teleporter = inside_teleporter_now;
+    sim->teleporting = teleporting_now && sim->inside_teleporter;
+    if (sim->teleporting) {
+      player.position.x = teleported_position.x;
+      player.position.y = teleported_position.y;
+      sim->teleported = teleported_now;
+    }
+  }
+  sim->gravity_flip_timer = MAX(sim->gravity_flip_timer - dt_ms, 0.0f);
+
+  {
+    // @step: update player variables
+    player.bounds = rect(player.position.v2(), player.size);
+    sim->collidex = is_collide_x;
+    sim->collidey = is_collide_y;
+
+    entity_store_set_position(store, level->player, player.position);
+  }
+}
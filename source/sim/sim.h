@@ -0,0 +1,94 @@
+#pragma once
+
+#include "../core.h"
+#include "../math.h"
+#include "../entity/entity_store.h"
+#include "../physics/colliders.h"
+#include "../physics/collision_grid.h"
+#include "../physics/occupancy.h"
+#include "../physics/contact_batch.h"
+#include "../physics/swept.h"
+
+// @note: gameplay runs in fixed ticks of SIM_TICK_SECONDS, whatever the display
+// rate is. The movement constants were tuned as displacements per 60Hz frame,
+// velocities keep those units and are scaled to the tick when they are applied.
+#define SIM_TICK_RATE 120
+#define SIM_TICK_SECONDS (1.0/SIM_TICK_RATE)
+#define SIM_TUNING_RATE 60.0f
+// longer frames (breakpoints, level loads, a dragged window) are simulated as
+// this long, so the game does not try to catch up on seconds of ticks
+#define SIM_MAX_FRAME_SECONDS 0.25
+// landing leaves the player 0.1 off the ground, obstacles this close count as ground
+#define SIM_GROUND_PROBE 0.2f
+
+enum PlatformKey {
+  PK_NIL = 0,
+  PK_W = 1,
+  PK_A = 2,
+  PK_S = 3,
+  PK_D = 4,
+};
+
+struct Controller {
+  b8 move_up;
+  b8 move_down;
+  b8 move_left;
+  b8 move_right;
+  // one shot, cleared by the tick that uses them
+  b8 jump;
+  b8 toggle_gravity;
+  b8 flip_gravity;
+};
+
+// @note: movement constants, in pixels scaled by render_scale
+struct SimTuning {
+    r32 fall_accelx;
+    r32 move_accelx;
+    r32 max_speedx;
+    r32 freefall_accel;
+    r32 jump_force;
+    r32 noclip_speed;
+    // how close to a teleporter's center the player has to get to be sent through
+    r32 teleport_snap;
+};
+
+// @note: the level a tick runs against, owned by the caller
+struct SimLevel {
+    EntityStore *store;
+    ColliderSet *colliders;
+    CollisionGrid *collision_grid;
+    OccupancyMap *occupancy;
+    u32 player;		// entity slot
+};
+
+// @note: everything about the player a tick reads and writes, other than its
+// entity. Plain data, copying it snapshots the player.
+struct SimState {
+    // 0: in progress, 1: complete
+    b8 level_state;
+    b8 is_gravity;	// 0: no clip movement
+    b8 flip_gravity;
+    b8 inside_teleporter;
+    b8 teleporting;
+    b8 teleported;	// the last tick moved the player through a teleporter
+    b8 collidex;
+    b8 collidey;
+    b8 is_collide_bottom;
+    b8 is_collide_top;
+    u32 jump_count;
+    r32 gravity_diry;
+    r32 effective_force;
+    Vec2 player_velocity;
+    Vec2 move_dir;	// direction the input asks for
+    Vec2 motion_dir;	// direction the player is effectively travelling
+    Vec2 motion;	// displacement the last tick asked for, before collision
+    r64 jump_timer;	// ms
+    r64 gravity_flip_timer;	// ms
+};
+
+SimTuning sim_tuning(Vec2 render_scale);
+void sim_init(SimState *sim);
+void sim_level_reset(SimState *sim);
+Vec2 get_move_dir(Controller c);
+void sim_step(SimState *sim, SimLevel *level, SimTuning *tuning, Controller *controller,
+	      const r32 *key_down_time, r32 dt);
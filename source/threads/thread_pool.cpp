@@ -0,0 +1,99 @@
+#include <string.h>
+#include "thread_pool.h"
+
+// @description: takes jobs from the current batch until it runs out.
+// Expects pool->lock to be held, returns with it held.
+static void thread_pool_drain(ThreadPool *pool) {
+  while (pool->job_fn != NULL && pool->next_job < pool->job_count) {
+    u32 job_index = pool->next_job++;
+    ThreadPoolJob job_fn = pool->job_fn;
+    void *job_data = pool->job_data;
+    SDL_UnlockMutex(pool->lock);
+    job_fn(job_data, job_index);
+    SDL_LockMutex(pool->lock);
+    pool->done_count++;
+    if (pool->done_count == pool->job_count) {
+      SDL_CondBroadcast(pool->work_done);
+    }
+  }
+}
+
+static int thread_pool_worker(void *data) {
+  ThreadPool *pool = (ThreadPool*)data;
+  SDL_LockMutex(pool->lock);
+  while (!pool->quit) {
+    thread_pool_drain(pool);
+    if (!pool->quit) {
+      SDL_CondWait(pool->work_ready, pool->lock);
+    }
+  }
+  SDL_UnlockMutex(pool->lock);
+  return 0;
+}
+
+void thread_pool_init(ThreadPool *pool, s32 worker_count) {
+  memset(pool, 0, sizeof(ThreadPool));
+  if (worker_count < 0) {
+    worker_count = SDL_GetCPUCount() - 1;
+  }
+  if (worker_count < 0) {
+    worker_count = 0;
+  }
+  if (worker_count > THREAD_POOL_MAX_WORKERS) {
+    worker_count = THREAD_POOL_MAX_WORKERS;
+  }
+
+  pool->lock = SDL_CreateMutex();
+  pool->run_lock = SDL_CreateMutex();
+  pool->work_ready = SDL_CreateCond();
+  pool->work_done = SDL_CreateCond();
+  for (s32 i = 0; i < worker_count; i++) {
+    SDL_Thread *worker = SDL_CreateThread(thread_pool_worker, "thread_pool_worker", pool);
+    if (worker == NULL) {
+      break;
+    }
+    pool->workers[pool->worker_count++] = worker;
+  }
+}
+
+// @description: runs job_fn for every job index and blocks until all of them finished
+void thread_pool_run(ThreadPool *pool, ThreadPoolJob job_fn, void *data, u32 job_count) {
+  if (job_count == 0) {
+    return;
+  }
+  SDL_LockMutex(pool->run_lock);
+  SDL_LockMutex(pool->lock);
+  pool->job_fn = job_fn;
+  pool->job_data = data;
+  pool->job_count = job_count;
+  pool->next_job = 0;
+  pool->done_count = 0;
+  SDL_CondBroadcast(pool->work_ready);
+
+  thread_pool_drain(pool);
+  while (pool->done_count < pool->job_count) {
+    SDL_CondWait(pool->work_done, pool->lock);
+  }
+  pool->job_fn = NULL;
+  pool->job_data = NULL;
+  SDL_UnlockMutex(pool->lock);
+  SDL_UnlockMutex(pool->run_lock);
+}
+
+void thread_pool_shutdown(ThreadPool *pool) {
+  if (pool->lock == NULL) {
+    return;
+  }
+  SDL_LockMutex(pool->lock);
+  pool->quit = 1;
+  SDL_CondBroadcast(pool->work_ready);
+  SDL_UnlockMutex(pool->lock);
+  for (u32 i = 0; i < pool->worker_count; i++) {
+    SDL_WaitThread(pool->workers[i], NULL);
+  }
+  SDL_DestroyCond(pool->work_done);
+  SDL_DestroyCond(pool->work_ready);
+  SDL_DestroyMutex(pool->run_lock);
+  SDL_DestroyMutex(pool->lock);
+  memset(pool, 0, sizeof(ThreadPool));
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include "../core.h"
+
+// @note: fixed set of worker threads that run a batch of jobs (job_fn(data, job_index)
+// for every job_index in [0, job_count)) and then go back to sleep. The calling
+// thread works on the batch as well, so a pool with 0 workers runs everything inline.
+typedef void (*ThreadPoolJob)(void *data, u32 job_index);
+
+#define THREAD_POOL_MAX_WORKERS 32
+
+struct ThreadPool {
+    SDL_Thread *workers[THREAD_POOL_MAX_WORKERS];
+    u32 worker_count;
+    SDL_mutex *lock;
+    SDL_mutex *run_lock;	// one batch at a time, thread_pool_run can be called from any thread
+    SDL_cond *work_ready;
+    SDL_cond *work_done;
+    ThreadPoolJob job_fn;
+    void *job_data;
+    u32 job_count;
+    u32 next_job;
+    u32 done_count;
+    b8 quit;
+};
+
+// worker_count < 0 uses one worker per remaining core
+void thread_pool_init(ThreadPool *pool, s32 worker_count);
+void thread_pool_run(ThreadPool *pool, ThreadPoolJob job_fn, void *data, u32 job_count);
+void thread_pool_shutdown(ThreadPool *pool);
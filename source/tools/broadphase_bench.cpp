@@ -0,0 +1,401 @@
+// @description: broad phase benchmark, many moving bodies in a level. Compares
+// the game's per body loop over every obstacle (plus every other body) with
+// sweep and prune, and checks both find the same overlapping pairs. The bodies
+// are also kept in a dynamic AABB tree, whose pair and box queries are checked
+// against a loop over every fat box, along with its links, heights and boxes.
+// Every frame a few bodies are removed from both and added again elsewhere. The
+// loops are O(n*m), they only run (and are only timed) on the first frame and
+// every -check frames after it.
+// usage: broadphase_bench [-bodies <n>] [-frames <n>] [-check <n>] [-seed <n>] <level.txt>
+// e.g. broadphase_bench -bodies 5000 levels/stress_100k.txt
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "../core.h"
+#include "../memory/arena.h"
+#include "../math.h"
+#include "../threads/thread_pool.cpp"
+#include "../level/level.cpp"
+#include "../physics/sweep_prune.cpp"
+#include "../physics/aabb_tree.cpp"
+#include "tool_common.h"
+
+struct BenchBody {
+  Vec2 position;
+  Vec2 size;
+  Vec2 velocity;
+};
+
+static int bench_pair_compare(const void *a, const void *b) {
+  const AabbTreePair *pa = (const AabbTreePair*)a;
+  const AabbTreePair *pb = (const AabbTreePair*)b;
+  if (pa->user_a != pb->user_a) {
+    return pa->user_a < pb->user_a ? -1 : 1;
+  }
+  return pa->user_b < pb->user_b ? -1 : pa->user_b > pb->user_b;
+}
+
+static int bench_u32_compare(const void *a, const void *b) {
+  u32 ua = *(const u32*)a;
+  u32 ub = *(const u32*)b;
+  return ua < ub ? -1 : ua > ub;
+}
+
+// @description: sorts pairs with the lower user first in every pair, so two lists
+// of the same pairs compare equal
+static void bench_sort_pairs(AabbTreePair *pairs, u32 count) {
+  for (u32 i = 0; i < count; i++) {
+    if (pairs[i].user_a > pairs[i].user_b) {
+      pairs[i] = AabbTreePair{pairs[i].user_b, pairs[i].user_a};
+    }
+  }
+  qsort(pairs, count, sizeof(AabbTreePair), bench_pair_compare);
+}
+
+// @description: walks the tree from the root. 1 if every inner node is one above its
+// taller child, its box is the union of its children's and they point back at it,
+// and the tree has proxy_count leaves. stack holds node_capacity nodes.
+static b8 bench_check_tree(AabbTree *tree, s32 *stack) {
+  if (tree->root == AABB_TREE_NULL) {
+    return tree->proxy_count == 0;
+  }
+  if (tree->nodes[tree->root].parent != AABB_TREE_NULL) {
+    return 0;
+  }
+  u32 leaf_count = 0;
+  s32 stack_size = 0;
+  stack[stack_size++] = tree->root;
+  while (stack_size > 0) {
+    s32 index = stack[--stack_size];
+    AabbTreeNode *node = &tree->nodes[index];
+    if (node->left == AABB_TREE_NULL) {
+      leaf_count++;
+      if (node->height != 0) {
+	return 0;
+      }
+      continue;
+    }
+    AabbTreeNode *left = &tree->nodes[node->left];
+    AabbTreeNode *right = &tree->nodes[node->right];
+    Rect box = rect_union(left->box, right->box);
+    if (left->parent != index || right->parent != index ||
+	node->height != 1 + MAX(left->height, right->height) ||
+	memcmp(&box, &node->box, sizeof(Rect)) != 0 || stack_size + 2 > tree->node_capacity) {
+      return 0;
+    }
+    stack[stack_size++] = node->left;
+    stack[stack_size++] = node->right;
+  }
+  return leaf_count == tree->proxy_count;
+}
+
+static r64 bench_ms(u64 ticks) {
+  return (r64)ticks*1000.0/(r64)SDL_GetPerformanceFrequency();
+}
+
+int main(int argc, char* argv[]) {
+  u32 body_count = 2000;
+  u32 frame_count = 200;
+  u32 check_interval = 25;
+  u64 seed = 1;
+  const char *input = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-bodies") == 0 && i + 1 < argc) {
+      body_count = (u32)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc) {
+      frame_count = (u32)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-check") == 0 && i + 1 < argc) {
+      check_interval = (u32)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+      seed = strtoull(argv[++i], NULL, 10);
+    } else {
+      input = argv[i];
+    }
+  }
+  if (input == NULL || body_count == 0 || frame_count == 0 || check_interval == 0) {
+    printf("usage: %s [-bodies <n>] [-frames <n>] [-check <n>] [-seed <n>] <level.txt>\n", argv[0]);
+    return -1;
+  }
+
+  Vec2 render_scale = Vec2{1.0f, 1.0f};
+  Vec2 atom_size = Vec2{base_atom_size, base_atom_size};
+  r32 entity_z[ENTITY_TYPE_COUNT];
+  level_default_entity_z(entity_z);
+
+  ThreadPool pool;
+  thread_pool_init(&pool, -1);
+  size_t arena_size = MB(1);
+  Arena level_arena;
+  arena_init(&level_arena, (unsigned char*)malloc(arena_size), arena_size);
+  Level level = {};
+  if (!level_load_text(&level, &level_arena, input, entity_z, render_scale, atom_size, &pool)) {
+    printf("ERROR :: failed to parse %s\n", input);
+    return -1;
+  }
+
+  // @step: the level's obstacles, what state.obstacles holds in game
+  u32 obstacle_count = 0;
+  Rect *obstacles = (Rect*)malloc(level.entity_count*sizeof(Rect));
+  Rect world = {};
+  for (u32 i = 0; i < level.entity_count; i++) {
+    Entity e = level.entities[i];
+    if (e.type != OBSTACLE && e.type != INVERT_GRAVITY) {
+      continue;
+    }
+    world = obstacle_count == 0 ? e.bounds : rect_union(world, e.bounds);
+    obstacles[obstacle_count++] = e.bounds;
+  }
+  if (obstacle_count == 0) {
+    printf("ERROR :: %s has no obstacles\n", input);
+    return -1;
+  }
+
+  // @step: bodies between half an atom and an atom big, moving up to an eighth of an atom per frame
+  ToolRandom random = tool_random(seed);
+  BenchBody *bodies = (BenchBody*)malloc(body_count*sizeof(BenchBody));
+  for (u32 i = 0; i < body_count; i++) {
+    BenchBody *b = &bodies[i];
+    b->size = Vec2{tool_range(&random, 0.5f, 1.0f)*atom_size.x, tool_range(&random, 0.5f, 1.0f)*atom_size.y};
+    b->position = Vec2{tool_range(&random, world.lb.x, world.rt.x - b->size.x),
+		       tool_range(&random, world.lb.y, world.rt.y - b->size.y)};
+    b->velocity = Vec2{tool_range(&random, -1.0f, 1.0f), tool_range(&random, -1.0f, 1.0f)}*(atom_size.x/8.0f);
+  }
+
+  u32 sap_capacity = obstacle_count + body_count;
+  u32 pair_capacity = MAX(body_count*16, 1024);
+  size_t sap_size = sweep_prune_size(sap_capacity, pair_capacity);
+  Arena sap_arena;
+  arena_init(&sap_arena, (unsigned char*)malloc(sap_size), sap_size);
+  SweepPrune sap;
+  sweep_prune_init(&sap, &sap_arena, sap_capacity, pair_capacity);
+  for (u32 i = 0; i < obstacle_count; i++) {
+    sweep_prune_add(&sap, obstacles[i], i, 1);
+  }
+  u32 *body_ids = (u32*)malloc(body_count*sizeof(u32));
+  for (u32 i = 0; i < body_count; i++) {
+    body_ids[i] = sweep_prune_add(&sap, rect(bodies[i].position, bodies[i].size), obstacle_count + i, 0);
+  }
+  // the initial sort is not part of the frame timings
+  sweep_prune_update(&sap);
+
+  // @step: the bodies in a dynamic tree, with the game's margin of a quarter atom
+  size_t tree_size = aabb_tree_size(body_count);
+  Arena tree_arena;
+  arena_init(&tree_arena, (unsigned char*)malloc(tree_size), tree_size);
+  AabbTree tree;
+  aabb_tree_init(&tree, &tree_arena, body_count, atom_size*0.25f);
+  s32 *proxies = (s32*)malloc(body_count*sizeof(s32));
+  for (u32 i = 0; i < body_count; i++) {
+    proxies[i] = aabb_tree_insert(&tree, rect(bodies[i].position, bodies[i].size), i);
+  }
+  u32 tree_pair_capacity = pair_capacity;
+  AabbTreePair *tree_pairs = (AabbTreePair*)malloc(tree_pair_capacity*sizeof(AabbTreePair));
+  AabbTreePair *loop_pairs = (AabbTreePair*)malloc(tree_pair_capacity*sizeof(AabbTreePair));
+  // sweep and prune's pairs and the loop's, as (user, user) pairs like the tree's
+  AabbTreePair *sap_pairs = (AabbTreePair*)malloc(pair_capacity*sizeof(AabbTreePair));
+  AabbTreePair *loop_sap_pairs = (AabbTreePair*)malloc(pair_capacity*sizeof(AabbTreePair));
+  u32 *tree_hits = (u32*)malloc(body_count*sizeof(u32));
+  u32 *loop_hits = (u32*)malloc(body_count*sizeof(u32));
+  s32 *tree_stack = (s32*)malloc(tree.node_capacity*sizeof(s32));
+
+  printf("%s: %u obstacles, %u bodies, %u frames, checked every %u\n",
+	 input, obstacle_count, body_count, frame_count, check_interval);
+
+  // bodies removed and added again per frame, few enough that sweep and prune keeps
+  // its overlap set instead of sweeping again
+  u32 churn_count = MIN(body_count/64 + 1, 16);
+  u64 loop_ticks = 0;
+  u64 sap_ticks = 0;
+  u64 tree_ticks = 0;
+  u64 total_overlaps = 0;
+  u64 total_tree_pairs = 0;
+  u32 checked_frames = 0;
+  u32 mismatches = 0;
+  u32 tree_mismatches = 0;
+  for (u32 frame = 0; frame < frame_count; frame++) {
+    // @step: move, bounce off the level bounds
+    for (u32 i = 0; i < body_count; i++) {
+      BenchBody *b = &bodies[i];
+      b->position = b->position + b->velocity;
+      if (b->position.x < world.lb.x || b->position.x + b->size.x > world.rt.x) {
+	b->velocity.x = -b->velocity.x;
+      }
+      if (b->position.y < world.lb.y || b->position.y + b->size.y > world.rt.y) {
+	b->velocity.y = -b->velocity.y;
+      }
+    }
+
+    // @step: churn, a few bodies leave and come back somewhere else (not timed)
+    for (u32 n = 0; n < churn_count; n++) {
+      u32 i = (u32)(tool_next(&random) % body_count);
+      BenchBody *b = &bodies[i];
+      b->position = Vec2{tool_range(&random, world.lb.x, world.rt.x - b->size.x),
+			 tool_range(&random, world.lb.y, world.rt.y - b->size.y)};
+      sweep_prune_remove(&sap, body_ids[i]);
+      body_ids[i] = sweep_prune_add(&sap, rect(b->position, b->size), obstacle_count + i, 0);
+      aabb_tree_remove(&tree, proxies[i]);
+      proxies[i] = aabb_tree_insert(&tree, rect(b->position, b->size), i);
+    }
+
+    // @step: every body against every obstacle, like the game's collision loop.
+    // O(bodies*obstacles), so only on the frames that are checked
+    b8 is_checked = frame % check_interval == 0;
+    u64 start = SDL_GetPerformanceCounter();
+    u32 loop_overlaps = 0;
+    for (u32 i = 0; i < body_count && is_checked; i++) {
+      Rect a = rect(bodies[i].position, bodies[i].size);
+      for (u32 k = 0; k < obstacle_count; k++) {
+	loop_overlaps += aabb_collision_rect(a, obstacles[k]);
+      }
+      for (u32 j = i + 1; j < body_count; j++) {
+	loop_overlaps += aabb_collision_rect(a, rect(bodies[j].position, bodies[j].size));
+      }
+    }
+    u64 loop_end = SDL_GetPerformanceCounter();
+
+    for (u32 i = 0; i < body_count; i++) {
+      sweep_prune_move(&sap, body_ids[i], rect(bodies[i].position, bodies[i].size));
+    }
+    sweep_prune_update(&sap);
+    SweepPrunePairs pairs = sweep_prune_pairs(&sap);
+    u64 sap_end = SDL_GetPerformanceCounter();
+
+    for (u32 i = 0; i < body_count; i++) {
+      aabb_tree_move(&tree, proxies[i], rect(bodies[i].position, bodies[i].size), bodies[i].velocity);
+    }
+    u32 tree_pair_count = aabb_tree_pairs(&tree, tree_pairs, tree_pair_capacity);
+    u64 tree_end = SDL_GetPerformanceCounter();
+    if (tree_pair_count > tree_pair_capacity) {
+      // more pairs than fit, grow the lists (outside of the timings) and ask again
+      tree_pair_capacity = tree_pair_count*2;
+      tree_pairs = (AabbTreePair*)realloc(tree_pairs, tree_pair_capacity*sizeof(AabbTreePair));
+      loop_pairs = (AabbTreePair*)realloc(loop_pairs, tree_pair_capacity*sizeof(AabbTreePair));
+      tree_pair_count = aabb_tree_pairs(&tree, tree_pairs, tree_pair_capacity);
+    }
+
+    sap_ticks += sap_end - loop_end;
+    tree_ticks += tree_end - sap_end;
+    total_overlaps += pairs.overlap_count;
+    total_tree_pairs += tree_pair_count;
+    if (!is_checked) {
+      continue;
+    }
+    loop_ticks += loop_end - start;
+    checked_frames++;
+    if (pairs.overlap_count != loop_overlaps) {
+      if (mismatches == 0) {
+	printf("ERROR :: frame %u: loop found %u overlaps, sweep and prune %u\n",
+	       frame, loop_overlaps, pairs.overlap_count);
+      }
+      mismatches++;
+    } else if (pairs.count != loop_overlaps) {
+      if (mismatches == 0) {
+	printf("ERROR :: frame %u: sweep and prune listed %u of its %u pairs\n",
+	       frame, pairs.count, pairs.overlap_count);
+      }
+      mismatches++;
+    } else {
+      // @step: sweep and prune's pairs against the loop's (body, body) and (body, obstacle) pairs
+      u32 loop_pair_count = 0;
+      for (u32 i = 0; i < body_count; i++) {
+	Rect a = rect(bodies[i].position, bodies[i].size);
+	for (u32 k = 0; k < obstacle_count; k++) {
+	  if (aabb_collision_rect(a, obstacles[k])) {
+	    loop_sap_pairs[loop_pair_count++] = AabbTreePair{k, obstacle_count + i};
+	  }
+	}
+	for (u32 j = i + 1; j < body_count; j++) {
+	  if (aabb_collision_rect(a, rect(bodies[j].position, bodies[j].size))) {
+	    loop_sap_pairs[loop_pair_count++] = AabbTreePair{obstacle_count + i, obstacle_count + j};
+	  }
+	}
+      }
+      for (u32 i = 0; i < pairs.count; i++) {
+	sap_pairs[i] = AabbTreePair{pairs.pairs[i].user_a, pairs.pairs[i].user_b};
+      }
+      bench_sort_pairs(sap_pairs, pairs.count);
+      bench_sort_pairs(loop_sap_pairs, loop_pair_count);
+      if (memcmp(sap_pairs, loop_sap_pairs, pairs.count*sizeof(AabbTreePair)) != 0) {
+	if (mismatches == 0) {
+	  printf("ERROR :: frame %u: sweep and prune's pairs differ from the loop's\n", frame);
+	}
+	mismatches++;
+      }
+    }
+
+    // @step: the tree's pairs against every pair of overlapping fat boxes
+    u32 loop_pair_count = 0;
+    for (u32 i = 0; i < body_count; i++) {
+      Rect a = aabb_tree_fat_box(&tree, proxies[i]);
+      for (u32 j = i + 1; j < body_count; j++) {
+	if (aabb_collision_rect(a, aabb_tree_fat_box(&tree, proxies[j]))) {
+	  if (loop_pair_count < tree_pair_capacity) {
+	    loop_pairs[loop_pair_count] = AabbTreePair{i, j};
+	  }
+	  loop_pair_count++;
+	}
+      }
+    }
+    // after the churn's removes and inserts the tree must still be linked and refit
+    b8 tree_match = bench_check_tree(&tree, tree_stack) && tree_pair_count == loop_pair_count;
+    if (tree_match) {
+      bench_sort_pairs(tree_pairs, tree_pair_count);
+      bench_sort_pairs(loop_pairs, loop_pair_count);
+      tree_match = memcmp(tree_pairs, loop_pairs, tree_pair_count*sizeof(AabbTreePair)) == 0;
+    }
+    // @step: box queries, a body's box grown by an atom against every fat box
+    for (u32 q = 0; q < 16 && tree_match; q++) {
+      BenchBody *b = &bodies[tool_next(&random) % body_count];
+      Rect box = rect(b->position - atom_size, b->size + atom_size*2.0f);
+      u32 tree_hit_count = aabb_tree_query(&tree, box, tree_hits, body_count);
+      u32 loop_hit_count = 0;
+      for (u32 i = 0; i < body_count; i++) {
+	if (aabb_collision_rect(box, aabb_tree_fat_box(&tree, proxies[i]))) {
+	  loop_hits[loop_hit_count++] = i;
+	}
+      }
+      tree_match = tree_hit_count == loop_hit_count;
+      if (tree_match) {
+	qsort(tree_hits, tree_hit_count, sizeof(u32), bench_u32_compare);
+	tree_match = memcmp(tree_hits, loop_hits, tree_hit_count*sizeof(u32)) == 0;
+      }
+    }
+    if (!tree_match) {
+      if (tree_mismatches == 0) {
+	printf("ERROR :: frame %u: the tree is broken, or its pairs or queries differ from the fat box loop\n",
+	       frame);
+      }
+      tree_mismatches++;
+    }
+  }
+
+  r64 loop_ms = checked_frames > 0 ? bench_ms(loop_ticks)/checked_frames : 0.0;
+  r64 sap_ms = bench_ms(sap_ticks)/frame_count;
+  printf("overlaps/frame: %.1f\n", (r64)total_overlaps/frame_count);
+  printf("obstacle loop:   %10.4f ms/frame, %u frames\n", loop_ms, checked_frames);
+  printf("sweep and prune: %10.4f ms/frame (%.1fx), %u bodies churned/frame\n",
+	 sap_ms, sap_ms > 0.0 ? loop_ms/sap_ms : 0.0, churn_count);
+  printf("aabb tree:       %10.4f ms/frame, body pairs only, %.1f fat box pairs/frame, height %d\n",
+	 bench_ms(tree_ticks)/frame_count, (r64)total_tree_pairs/frame_count,
+	 tree.root != AABB_TREE_NULL ? tree.nodes[tree.root].height : 0);
+
+  thread_pool_shutdown(&pool);
+  free(tree_stack);
+  free(loop_hits);
+  free(loop_sap_pairs);
+  free(sap_pairs);
+  free(tree_hits);
+  free(loop_pairs);
+  free(tree_pairs);
+  free(proxies);
+  free(tree_arena.buffer);
+  free(body_ids);
+  free(bodies);
+  free(obstacles);
+  free(sap_arena.buffer);
+  free(level_arena.buffer);
+  return mismatches || tree_mismatches ? -1 : 0;
+}
@@ -0,0 +1,214 @@
+// @description: compiles 0x1 text levels into mmap-able 0x2 binary levels,
+// either one file per level or a single level pack
+// usage: level_compiler [-scale <x> <y>] <output_dir> <level.txt>...
+//        level_compiler [-scale <x> <y>] -pack <levels.pack> <level.txt>...
+//        level_compiler [-scale <x> <y>] -embed <embedded_levels.h> <level.txt>...
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "../core.h"
+#include "../memory/arena.h"
+#include "../math.h"
+#include "../threads/thread_pool.cpp"
+#include "../level/level.cpp"
+#include "tool_common.h"
+
+#define ARR_SIZE(arr) (sizeof(arr)/sizeof((arr)[0]))
+
+// @description: "./levels/level0.txt" -> "level0"
+static void level_base_name(const char *path, char *out, size_t out_size) {
+  const char *name = strrchr(path, '/');
+  name = name ? name + 1 : path;
+  size_t len = strlen(name);
+  const char *ext = strrchr(name, '.');
+  if (ext) {
+    len = ext - name;
+  }
+  len = MIN(len, out_size - 1);
+  memcpy(out, name, len);
+  out[len] = 0;
+}
+
+// @description: writes r32 as a C++ float literal that round trips
+static void embed_r32(FILE *file, r32 value) {
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.9g", value);
+  b8 is_integral = strpbrk(buffer, ".eEn") == NULL;
+  fprintf(file, "%s%sf", buffer, is_integral ? ".0" : "");
+}
+
+static void embed_vec2(FILE *file, Vec2 v) {
+  fprintf(file, "{{");
+  embed_r32(file, v.x);
+  fprintf(file, ", ");
+  embed_r32(file, v.y);
+  fprintf(file, "}}");
+}
+
+static void embed_vec3(FILE *file, Vec3 v) {
+  fprintf(file, "{{");
+  embed_r32(file, v.x);
+  fprintf(file, ", ");
+  embed_r32(file, v.y);
+  fprintf(file, ", ");
+  embed_r32(file, v.z);
+  fprintf(file, "}}");
+}
+
+static const char *entity_type_names[] = {
+  "PLAYER", "OBSTACLE", "GOAL", "INVERT_GRAVITY", "TELEPORT", "DEBUG_LINE", "TEXT",
+};
+
+// @description: writes one level as a constexpr Entity table
+static void embed_level(FILE *file, u32 index, const char *name, Level *level) {
+  fprintf(file, "// %s\n", name);
+  fprintf(file, "static constexpr Entity embedded_level_%u_entities[] = {\n", index);
+  for (u32 i = 0; i < level->entity_count; i++) {
+    Entity e = level->entities[i];
+    fprintf(file, "  {%d, ", e.id);
+    if ((u32)e.type < ARR_SIZE(entity_type_names)) {
+      fprintf(file, "%s, ", entity_type_names[e.type]);
+    } else {
+      fprintf(file, "(ENTITY_TYPE)%d, ", e.type);
+    }
+    embed_vec3(file, e.raw_position);
+    fprintf(file, ", ");
+    embed_vec2(file, e.raw_size);
+    fprintf(file, ", ");
+    embed_vec3(file, e.position);
+    fprintf(file, ", ");
+    embed_vec2(file, e.size);
+    fprintf(file, ", {");
+    embed_vec2(file, e.bounds.lb);
+    fprintf(file, ", ");
+    embed_vec2(file, e.bounds.rt);
+    fprintf(file, "}, %uu},\n", e.link_id);
+  }
+  fprintf(file, "};\n\n");
+}
+
+int main(int argc, char* argv[]) {
+  Vec2 render_scale = Vec2{1.0f, 1.0f};
+  int arg = 1;
+  if (argc > arg + 2 && strcmp(argv[arg], "-scale") == 0) {
+    render_scale.x = strtof(argv[arg + 1], NULL);
+    render_scale.y = strtof(argv[arg + 2], NULL);
+    arg += 3;
+  }
+  b8 is_pack = argc > arg && strcmp(argv[arg], "-pack") == 0;
+  arg += is_pack;
+  b8 is_embed = argc > arg && strcmp(argv[arg], "-embed") == 0;
+  arg += is_embed;
+  if (argc - arg < 2) {
+    printf("usage: %s [-scale <x> <y>] <output_dir> <level.txt>...\n", argv[0]);
+    printf("       %s [-scale <x> <y>] -pack <levels.pack> <level.txt>...\n", argv[0]);
+    printf("       %s [-scale <x> <y>] -embed <embedded_levels.h> <level.txt>...\n", argv[0]);
+    return -1;
+  }
+  const char *output = argv[arg++];
+  Vec2 atom_size = Vec2{base_atom_size, base_atom_size}*render_scale;
+
+  r32 entity_z[ENTITY_TYPE_COUNT];
+  level_default_entity_z(entity_z);
+
+  // big (generated) levels are parsed on all cores
+  ThreadPool pool;
+  thread_pool_init(&pool, -1);
+
+  // @note: grown by level_load_text to fit each level
+  size_t arena_size = MB(1);
+  void *level_mem = malloc(arena_size);
+  Arena level_arena;
+  arena_init(&level_arena, (unsigned char*)level_mem, arena_size);
+
+  LevelPackWriter pack_writer;
+  if (is_pack && !level_pack_writer_begin(&pack_writer, output, argc - arg)) {
+    printf("ERROR :: failed to create %s\n", output);
+    return -1;
+  }
+
+  FILE *embed_file = NULL;
+  u32 embed_count = 0;
+  char embed_names[1024][48];
+  u32 embed_entity_counts[1024];
+  if (is_embed) {
+    embed_file = fopen(output, "wb");
+    if (embed_file == NULL || argc - arg > (int)ARR_SIZE(embed_names)) {
+      printf("ERROR :: failed to create %s\n", output);
+      return -1;
+    }
+    fprintf(embed_file, "// generated by level_compiler -embed, do not edit\n");
+    fprintf(embed_file, "#pragma once\n\n");
+  }
+
+  int failed = 0;
+  for (; arg < argc; arg++) {
+    const char *input = argv[arg];
+    char name[256];
+    char level_output[512];
+    level_base_name(input, name, sizeof(name));
+    snprintf(level_output, sizeof(level_output), "%s/%s.lvl", output, name);
+
+    arena_clear(&level_arena);
+    Level level = {};
+    if (!level_load_text(&level, &level_arena, input, entity_z, render_scale, atom_size, &pool)) {
+      printf("ERROR :: failed to parse %s\n", input);
+      failed++;
+      continue;
+    }
+    if (is_embed) {
+      if (level.entity_count == 0 || strlen(name) >= sizeof(embed_names[0])) {
+	printf("ERROR :: failed to embed %s\n", input);
+	failed++;
+	continue;
+      }
+      embed_level(embed_file, embed_count, name, &level);
+      strcpy(embed_names[embed_count], name);
+      embed_entity_counts[embed_count] = level.entity_count;
+      embed_count++;
+      printf("%s -> %s (%u entities)\n", input, output, level.entity_count);
+      continue;
+    }
+    if (is_pack) {
+      if (strlen(name) >= sizeof(pack_writer.entries[0].name) ||
+	  !level_pack_writer_add(&pack_writer, name, &level, render_scale, atom_size)) {
+	printf("ERROR :: failed to pack %s\n", input);
+	failed++;
+	continue;
+      }
+      printf("%s -> %s[%u] (%u entities)\n", input, output, pack_writer.entry_count - 1, level.entity_count);
+      continue;
+    }
+    if (!level_write_binary(&level, level_output, render_scale, atom_size)) {
+      printf("ERROR :: failed to write %s\n", level_output);
+      failed++;
+      continue;
+    }
+    printf("%s -> %s (%u entities)\n", input, level_output, level.entity_count);
+  }
+
+  if (is_embed) {
+    fprintf(embed_file, "static constexpr Vec2 embedded_levels_render_scale = ");
+    embed_vec2(embed_file, render_scale);
+    fprintf(embed_file, ";\nstatic constexpr Vec2 embedded_levels_atom_size = ");
+    embed_vec2(embed_file, atom_size);
+    fprintf(embed_file, ";\n\nstatic const EmbeddedLevel embedded_levels[] = {\n");
+    for (u32 i = 0; i < embed_count; i++) {
+      fprintf(embed_file, "  {\"%s\", embedded_level_%u_entities, %u},\n",
+	      embed_names[i], i, embed_entity_counts[i]);
+    }
+    fprintf(embed_file, "};\n");
+    fclose(embed_file);
+  }
+  if (is_pack && !level_pack_writer_end(&pack_writer)) {
+    printf("ERROR :: failed to write %s\n", output);
+    failed++;
+  }
+
+  thread_pool_shutdown(&pool);
+  free(level_arena.buffer);
+  return failed ? -1 : 0;
+}
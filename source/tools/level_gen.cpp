@@ -0,0 +1,203 @@
+// @description: procedural stress level generator, writes levels in the 0x1 text format
+// usage: level_gen [-count <n>] [-seed <n>] [-mix <obstacle>,<invert>,<teleport>,<goal>]
+//                  [-max_strip <atoms>] <output.txt>
+// e.g. level_gen -count 1000000 -mix 90,4,4,2 levels/stress_1m.txt
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "../core.h"
+#include "../level/level.h"
+#include "tool_common.h"
+
+// level geometry is placed on the atom grid
+static const s32 atom = (s32)base_atom_size;
+
+static u32 gen_range(ToolRandom *r, u32 n) {
+  return (u32)(tool_next(r) % n);
+}
+
+// @note: occupancy of the atom grid, so generated entities never overlap
+struct GenGrid {
+  u32 width;
+  u32 height;
+  u64 *bits;
+};
+
+static b8 grid_test(GenGrid *g, u32 x, u32 y) {
+  u64 i = (u64)y*g->width + x;
+  return (g->bits[i >> 6] >> (i & 63)) & 1;
+}
+
+static void grid_set(GenGrid *g, u32 x, u32 y) {
+  u64 i = (u64)y*g->width + x;
+  g->bits[i >> 6] |= 1ull << (i & 63);
+}
+
+// @description: finds a free horizontal or vertical run of up to `length` cells,
+// marks it and returns its position and size in atoms (0 if nothing was found)
+static b8 grid_place(GenGrid *g, ToolRandom *r, u32 length, b8 vertical,
+		     u32 *out_x, u32 *out_y, u32 *out_sx, u32 *out_sy) {
+  for (u32 attempt = 0; attempt < 64; attempt++) {
+    // keep a 1 atom border free for the level bounds
+    u32 x = 1 + gen_range(r, g->width - 2);
+    u32 y = 2 + gen_range(r, g->height - 3);
+    if (grid_test(g, x, y)) {
+      continue;
+    }
+    u32 run = 1;
+    while (run < length) {
+      u32 nx = vertical ? x : x + run;
+      u32 ny = vertical ? y + run : y;
+      if (nx >= g->width - 1 || ny >= g->height - 1 || grid_test(g, nx, ny)) {
+	break;
+      }
+      run++;
+    }
+    for (u32 i = 0; i < run; i++) {
+      grid_set(g, vertical ? x : x + i, vertical ? y + i : y);
+    }
+    *out_x = x;
+    *out_y = y;
+    *out_sx = vertical ? 1 : run;
+    *out_sy = vertical ? run : 1;
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  u64 count = 1000;
+  u64 seed = 1;
+  u32 mix[4] = {90, 4, 4, 2};	// obstacle, invert gravity, teleport, goal
+  u32 max_strip = 8;
+  const char *output = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-count") == 0 && i + 1 < argc) {
+      count = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+      seed = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-mix") == 0 && i + 1 < argc) {
+      sscanf(argv[++i], "%u,%u,%u,%u", &mix[0], &mix[1], &mix[2], &mix[3]);
+    } else if (strcmp(argv[i], "-max_strip") == 0 && i + 1 < argc) {
+      max_strip = (u32)strtoul(argv[++i], NULL, 10);
+    } else {
+      output = argv[i];
+    }
+  }
+  u32 mix_total = mix[0] + mix[1] + mix[2] + mix[3];
+  if (output == NULL || count < 8 || mix_total == 0 || max_strip == 0) {
+    printf("usage: %s [-count <n>] [-seed <n>] [-mix <obstacle>,<invert>,<teleport>,<goal>] "
+	   "[-max_strip <atoms>] <output.txt>\n", argv[0]);
+    return -1;
+  }
+
+  // @note: teleporters come in pairs, a teleporter only mix needs an even number
+  // of them after the fixed entities: bounds, player and the goal that is added
+  // when the mix has none
+  u64 fixed_count = 5 + (mix[3] == 0 ? 1 : 0);
+  if (mix[0] + mix[1] + mix[3] == 0 && (count - fixed_count) % 2 != 0) {
+    count++;
+    printf("level_gen: teleporters come in pairs, generating %llu entities\n", (unsigned long long)count);
+  }
+
+  // @step: size the world so the generated entities cover about a quarter of it
+  GenGrid grid;
+  u64 cells = count*(max_strip + 1)*2;
+  grid.width = (u32)ceil(sqrt((r64)cells*16.0/9.0));
+  grid.height = (u32)(cells/grid.width) + 4;
+  grid.bits = (u64*)calloc(((u64)grid.width*grid.height + 63)/64, sizeof(u64));
+
+  FILE *file = fopen(output, "wb");
+  if (file == NULL || grid.bits == NULL) {
+    printf("ERROR :: failed to create %s\n", output);
+    return -1;
+  }
+
+  ToolRandom random = tool_random(seed);
+  fprintf(file, "# generated by level_gen -count %llu -seed %llu -mix %u,%u,%u,%u -max_strip %u\n",
+	  (unsigned long long)count, (unsigned long long)seed, mix[0], mix[1], mix[2], mix[3], max_strip);
+  fprintf(file, "0x1\n");
+  fprintf(file, "# type posx posy sizex sizey [id link_id]\n");
+
+  // @step: level bounds, floor, ceiling and walls
+  u64 written = 0;
+  fprintf(file, "%d %d %d %u %u\n", OBSTACLE, 0, 0, grid.width, 1);
+  fprintf(file, "%d %d %d %u %u\n", OBSTACLE, 0, (grid.height - 1)*atom, grid.width, 1);
+  fprintf(file, "%d %d %d %u %u\n", OBSTACLE, 0, atom, 1, grid.height - 2);
+  fprintf(file, "%d %d %d %u %u\n", OBSTACLE, (grid.width - 1)*atom, atom, 1, grid.height - 2);
+  for (u32 x = 0; x < grid.width; x++) {
+    grid_set(&grid, x, 0);
+    grid_set(&grid, x, grid.height - 1);
+  }
+  for (u32 y = 0; y < grid.height; y++) {
+    grid_set(&grid, 0, y);
+    grid_set(&grid, grid.width - 1, y);
+  }
+  written += 4;
+
+  // @step: player starts on the floor, bottom left
+  fprintf(file, "%d %d %d %u %u\n", PLAYER, atom, atom, 1, 1);
+  grid_set(&grid, 1, 1);
+  written++;
+
+  // @note: explicit teleporter ids start past every auto-generated id (the line index)
+  u64 teleport_id = count + 16;
+  b8 has_goal = 0;
+  // @note: until a goal is placed the last slot is kept for the one added after the loop
+  while (written + (has_goal ? 0 : 1) < count) {
+    // @step: with a single slot left a teleporter pair does not fit, roll over the
+    // other weights (their total is not 0, see the teleporter only note)
+    b8 pair_fits = count - written - (has_goal ? 0 : 1) >= 2;
+    u32 roll = gen_range(&random, pair_fits ? mix_total : mix_total - mix[2]);
+    if (!pair_fits && roll >= mix[0] + mix[1]) {
+      roll += mix[2];
+    }
+    u32 x, y, sx, sy;
+    if (roll < mix[0] + mix[1]) {
+      ENTITY_TYPE type = roll < mix[0] ? OBSTACLE : INVERT_GRAVITY;
+      u32 length = 1 + gen_range(&random, max_strip);
+      if (!grid_place(&grid, &random, length, gen_range(&random, 2), &x, &y, &sx, &sy)) {
+	break;
+      }
+      fprintf(file, "%d %u %u %u %u\n", type, x*atom, y*atom, sx, sy);
+      written++;
+    } else if (roll < mix[0] + mix[1] + mix[2]) {
+      // teleporters always come in linked pairs
+      u32 ax, ay, bx, by;
+      if (!grid_place(&grid, &random, 1, 0, &ax, &ay, &sx, &sy) ||
+	  !grid_place(&grid, &random, 1, 0, &bx, &by, &sx, &sy)) {
+	break;
+      }
+      u64 a_id = teleport_id++;
+      u64 b_id = teleport_id++;
+      fprintf(file, "%d %u %u 1 1 %llu %llu\n", TELEPORT, ax*atom, ay*atom,
+	      (unsigned long long)a_id, (unsigned long long)b_id);
+      fprintf(file, "%d %u %u 1 1 %llu %llu\n", TELEPORT, bx*atom, by*atom,
+	      (unsigned long long)b_id, (unsigned long long)a_id);
+      written += 2;
+    } else {
+      if (!grid_place(&grid, &random, 1, 0, &x, &y, &sx, &sy)) {
+	break;
+      }
+      fprintf(file, "%d %u %u 1 1\n", GOAL, x*atom, y*atom);
+      has_goal = 1;
+      written++;
+    }
+  }
+  if (!has_goal) {
+    // every level needs a goal
+    u32 x, y, sx, sy;
+    if (grid_place(&grid, &random, 1, 0, &x, &y, &sx, &sy)) {
+      fprintf(file, "%d %u %u 1 1\n", GOAL, x*atom, y*atom);
+      written++;
+    }
+  }
+
+  fclose(file);
+  free(grid.bits);
+  printf("%s: %llu entities, %ux%u atoms\n", output, (unsigned long long)written, grid.width, grid.height);
+  return written < count ? -1 : 0;
+}
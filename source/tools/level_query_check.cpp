@@ -0,0 +1,322 @@
+// @description: checks the level query against loops over every collider. Random
+// raycasts, boxcasts and overlaps over a level, with some colliders despawned and
+// some spawned after the hierarchy was built, must give the same first hit and the
+// same overlap list, in index order. Grazing casts (touching is not a hit) and
+// areas that only share an edge with a collider (edges are included) are checked
+// on their own. Obstacles despawned on their own must leave no solid atoms behind in
+// the occupancy map that a rebuild would not have. Prints the queries per second of
+// the hierarchy and of the loops.
+// usage: level_query_check [-queries <n>] [-seed <n>] <level.txt>...
+// e.g. level_query_check levels/*.txt levels/stress_100k.txt
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "../core.h"
+#include "../memory/arena.h"
+#include "../math.h"
+#include "../threads/thread_pool.cpp"
+#include "../level/level.cpp"
+#include "../entity/entity_store.cpp"
+#include "../physics/colliders.cpp"
+#include "../physics/level_query.cpp"
+#include "../physics/occupancy.cpp"
+#include "tool_common.h"
+
+// @description: first hit of the cast by testing every collider, the same slab
+// test and tie rule (lowest index wins) the hierarchy uses
+static b8 check_cast_loop(ColliderSet *colliders, Vec2 origin, Vec2 motion, Vec2 half,
+			  u32 type_mask, r32 *distance, u32 *collider) {
+  Vec2 inverse = Vec2{motion.x != 0.0f ? 1.0f/motion.x : 0.0f, motion.y != 0.0f ? 1.0f/motion.y : 0.0f};
+  r32 best = 1.0f;
+  u32 best_collider = ENTITY_INVALID_INDEX;
+  for (u32 c = 0; c < colliders->count; c++) {
+    r32 t;
+    u32 axis;
+    if (level_query_accepts(colliders, c, type_mask) &&
+	level_query_slab(origin, motion, inverse, colliders->bounds[c], half, best, &t, &axis) &&
+	(t < best || best_collider == ENTITY_INVALID_INDEX)) {
+      best = t;
+      best_collider = c;
+    }
+  }
+  *distance = best;
+  *collider = best_collider;
+  return best_collider != ENTITY_INVALID_INDEX;
+}
+
+// edges included, written out rather than calling aabb_collision_rect
+static b8 check_overlaps(Rect a, Rect b) {
+  return a.lb.x <= b.rt.x && b.lb.x <= a.rt.x && a.lb.y <= b.rt.y && b.lb.y <= a.rt.y;
+}
+
+// @description: a random live collider, ENTITY_INVALID_INDEX when there is none
+static u32 check_random_collider(ToolRandom *r, ColliderSet *colliders) {
+  for (u32 attempt = 0; attempt < 64; attempt++) {
+    u32 c = (u32)(tool_next(r) % colliders->count);
+    if (collider_is_alive(colliders, c)) {
+      return c;
+    }
+  }
+  return ENTITY_INVALID_INDEX;
+}
+
+// @description: checks one level, returns the number of mismatches
+static u32 check_level(const char *input, u32 query_count, u64 seed, ThreadPool *pool) {
+  Vec2 render_scale = Vec2{1.0f, 1.0f};
+  Vec2 atom_size = Vec2{base_atom_size, base_atom_size};
+  r32 entity_z[ENTITY_TYPE_COUNT];
+  level_default_entity_z(entity_z);
+
+  size_t arena_size = MB(1);
+  Arena level_arena;
+  arena_init(&level_arena, (unsigned char*)malloc(arena_size), arena_size);
+  Level level = {};
+  if (!level_load_text(&level, &level_arena, input, entity_z, render_scale, atom_size, pool)) {
+    printf("ERROR :: failed to parse %s\n", input);
+    free(level_arena.buffer);
+    return 1;
+  }
+
+  u32 store_capacity = level.entity_count + ENTITY_SPAWN_RESERVE;
+  Arena store_arena;
+  arena_init(&store_arena, (unsigned char*)malloc(arena_size), arena_size);
+  arena_reserve(&store_arena, entity_store_size(store_capacity));
+  EntityStore store;
+  entity_store_init(&store, &store_arena, store_capacity);
+  entity_store_load(&store, level.entities, level.entity_count);
+
+  Arena collision_arena;
+  arena_init(&collision_arena, (unsigned char*)malloc(arena_size), arena_size);
+  arena_reserve(&collision_arena, collider_set_size(&store) + level_query_size(&store) +
+				 2*occupancy_size(&store, atom_size));
+  ColliderSet colliders;
+  collider_set_build(&colliders, &collision_arena, &store);
+  LevelQuery query;
+  level_query_build(&query, &collision_arena, &colliders);
+  OccupancyMap occupancy;
+  occupancy_build(&occupancy, &collision_arena, &store, atom_size);
+  if (colliders.count == 0) {
+    printf("%s: no colliders, skipped\n", input);
+    free(collision_arena.buffer);
+    free(store_arena.buffer);
+    free(level_arena.buffer);
+    return 0;
+  }
+
+  Rect world = colliders.bounds[0];
+  for (u32 c = 1; c < colliders.count; c++) {
+    world = rect_union(world, colliders.bounds[c]);
+  }
+
+  // @step: despawn about one collider in 16 like despawn_level_entity does, and spawn
+  // a few obstacles the hierarchy has not seen, they are tested one by one
+  ToolRandom random = tool_random(seed);
+  u32 built_count = colliders.count;
+  u32 mismatches = 0;
+  Rect *freed = (Rect*)malloc(built_count*sizeof(Rect));
+  u32 freed_count = 0;
+  for (u32 c = 0; c < built_count; c++) {
+    if (tool_next(&random) % 16 == 0) {
+      colliders.types[c] = COLLIDER_DEAD;
+      if (collider_source_count(&colliders, c) == 1) {
+	// a lone obstacle leaves the store and the occupancy map, merged ones are rebuilt
+	u32 slot = colliders.source_slots[colliders.source_offsets[c]];
+	freed[freed_count++] = entity_bounds(&store, slot);
+	entity_despawn(&store, entity_handle(&store, slot));
+	occupancy_remove(&occupancy, &store, freed[freed_count - 1]);
+      }
+    }
+  }
+
+  // @step: the freed atoms against a map rebuilt from what is left in the store
+  OccupancyMap rebuilt;
+  occupancy_build(&rebuilt, &collision_arena, &store, atom_size);
+  for (u32 i = 0; i < freed_count && mismatches == 0; i++) {
+    s32 x0, y0, x1, y1;
+    occupancy_obstacle_atoms(freed[i], atom_size, &x0, &y0, &x1, &y1);
+    for (s32 y = y0; y <= y1; y++) {
+      for (s32 x = x0; x <= x1; x++) {
+	if (occupancy_test(&occupancy, x, y) != occupancy_test(&rebuilt, x, y)) {
+	  if (mismatches == 0) {
+	    printf("ERROR :: %s: atom %d, %d is %s after a despawn, %s after a rebuild\n", input, x, y,
+		   occupancy_test(&occupancy, x, y) ? "solid" : "free",
+		   occupancy_test(&rebuilt, x, y) ? "solid" : "free");
+	  }
+	  mismatches++;
+	}
+      }
+    }
+  }
+  free(freed);
+  for (u32 i = 0; i < 16; i++) {
+    Entity e = {};
+    e.id = -1 - (s32)i;
+    e.type = OBSTACLE;
+    e.size = atom_size;
+    e.position = Vec3{tool_range(&random, world.lb.x, world.rt.x), tool_range(&random, world.lb.y, world.rt.y), 0.0f};
+    e.bounds = rect(e.position.v2(), e.size);
+    EntityHandle handle = entity_spawn(&store, e);
+    if (handle.index == ENTITY_INVALID_INDEX) {
+      break;
+    }
+    collider_set_add(&colliders, &store, handle.index);
+  }
+
+  size_t overlap_size = colliders.count*sizeof(u32) + ALIGNMENT;
+  Arena overlap_arena;
+  arena_init(&overlap_arena, (unsigned char*)malloc(overlap_size), overlap_size);
+
+  Vec2 margin = atom_size*4.0f;
+  r32 reach = MAX(world.rt.x - world.lb.x, world.rt.y - world.lb.y)*0.25f + atom_size.x*8.0f;
+  u32 cast_hits = 0;
+  u32 overlap_total = 0;
+  u32 *loop_overlaps = (u32*)malloc(colliders.count*sizeof(u32));
+  u64 query_ticks = 0;
+  u64 loop_ticks = 0;
+  for (u32 q = 0; q < query_count; q++) {
+    u32 type_mask = q % 3 == 0 ? (1u << OBSTACLE) : LEVEL_QUERY_SOLIDS;
+
+    // @step: a box (or a ray on odd queries) moving anywhere, some along an axis only
+    Vec2 origin = Vec2{tool_range(&random, world.lb.x - margin.x, world.rt.x + margin.x),
+		       tool_range(&random, world.lb.y - margin.y, world.rt.y + margin.y)};
+    Vec2 motion = Vec2{tool_range(&random, -reach, reach), tool_range(&random, -reach, reach)};
+    if (q % 5 == 0) {
+      motion.x = 0.0f;
+    } else if (q % 7 == 0) {
+      motion.y = 0.0f;
+    }
+    Vec2 half = q % 2 ? Vec2{0.0f, 0.0f} : Vec2{tool_range(&random, 0.1f, 1.0f)*atom_size.x,
+						  tool_range(&random, 0.1f, 1.0f)*atom_size.y};
+    Rect box = Rect{origin - half, origin + half};
+    r32 length = sqrtf(motion.x*motion.x + motion.y*motion.y);
+    // the center and extents the casts work with
+    Vec2 cast_half = (box.rt - box.lb)*0.5f;
+    Vec2 cast_origin = half.x == 0.0f ? origin : box.lb + cast_half;
+    r32 loop_distance;
+    u32 loop_collider;
+    u64 cast_start = SDL_GetPerformanceCounter();
+    b8 loop_hit = check_cast_loop(&colliders, cast_origin, motion, cast_half, type_mask,
+				  &loop_distance, &loop_collider);
+    u64 cast_loop_end = SDL_GetPerformanceCounter();
+    QueryHit hit;
+    b8 query_hit = half.x == 0.0f
+      ? level_query_raycast(&query, &colliders, origin, motion, length, type_mask, &hit)
+      : level_query_boxcast(&query, &colliders, box, motion, type_mask, &hit);
+    u64 cast_query_end = SDL_GetPerformanceCounter();
+    if (half.x == 0.0f) {
+      // raycasts report world units along the ray, the loop a fraction of motion
+      loop_distance *= length;
+    }
+    b8 match = loop_hit == query_hit;
+    if (match && loop_hit) {
+      // equal entry times can come from different colliders, the time is what has to agree
+      match = hit.distance == loop_distance && level_query_accepts(&colliders, hit.collider, type_mask);
+    }
+    cast_hits += loop_hit;
+
+    // @step: a cast that slides along a collider's edge touches it the whole way,
+    // touching is not a hit so that collider is never the one reported
+    u32 grazed = check_random_collider(&random, &colliders);
+    if (match && grazed != ENTITY_INVALID_INDEX) {
+      Rect r = colliders.bounds[grazed];
+      Vec2 graze_half = q % 2 ? Vec2{0.0f, 0.0f} : atom_size*0.25f;
+      Vec2 graze_origin = Vec2{r.lb.x - graze_half.x - atom_size.x, r.rt.y + graze_half.y};
+      Vec2 graze_motion = Vec2{r.rt.x - r.lb.x + 2.0f*(graze_half.x + atom_size.x), 0.0f};
+      QueryHit graze_hit;
+      b8 graze = level_query_boxcast(&query, &colliders, Rect{graze_origin - graze_half, graze_origin + graze_half},
+				     graze_motion, 1u << colliders.types[grazed], &graze_hit);
+      match = !graze || graze_hit.collider != grazed;
+    }
+
+    // @step: an area, half the time one that only shares an edge with a live collider
+    Rect area;
+    u32 touched = q % 2 ? check_random_collider(&random, &colliders) : ENTITY_INVALID_INDEX;
+    if (touched != ENTITY_INVALID_INDEX) {
+      Rect r = colliders.bounds[touched];
+      Vec2 size = atom_size*tool_range(&random, 0.5f, 2.0f);
+      area = rect(Vec2{r.rt.x, r.lb.y - size.y*0.5f}, size);
+    } else {
+      area = rect(origin, Vec2{tool_range(&random, 0.0f, reach), tool_range(&random, 0.0f, reach)});
+    }
+    arena_clear(&overlap_arena);
+    u64 overlap_start = SDL_GetPerformanceCounter();
+    ColliderQuery overlap = level_query_overlap(&query, &colliders, area, type_mask, &overlap_arena);
+    u64 overlap_query_end = SDL_GetPerformanceCounter();
+    u32 loop_count = 0;
+    for (u32 c = 0; c < colliders.count; c++) {
+      if (level_query_accepts(&colliders, c, type_mask) && check_overlaps(colliders.bounds[c], area)) {
+	loop_overlaps[loop_count++] = c;
+      }
+    }
+    u64 overlap_loop_end = SDL_GetPerformanceCounter();
+    query_ticks += (cast_query_end - cast_loop_end) + (overlap_query_end - overlap_start);
+    loop_ticks += (cast_loop_end - cast_start) + (overlap_loop_end - overlap_query_end);
+    match = match && loop_count == overlap.count &&
+	    memcmp(loop_overlaps, overlap.indices, loop_count*sizeof(u32)) == 0;
+    if (touched != ENTITY_INVALID_INDEX && ((1u << colliders.types[touched]) & type_mask)) {
+      b8 found = 0;
+      for (u32 i = 0; i < overlap.count; i++) {
+	found |= overlap.indices[i] == touched;
+      }
+      match = match && found;
+    }
+    overlap_total += overlap.count;
+
+    if (!match) {
+      if (mismatches == 0) {
+	printf("ERROR :: %s: query %u differs from the loop over every collider\n", input, q);
+      }
+      mismatches++;
+    }
+  }
+
+  printf("%s: %u colliders (%u after the build), %u nodes, %u despawned alone, %u queries, %u cast hits, "
+	 "%.1f overlaps/query, %u mismatches\n",
+	 input, colliders.count, colliders.count - built_count, query.node_count, freed_count, query_count,
+	 cast_hits, (r64)overlap_total/query_count, mismatches);
+  // a query is one cast and one overlap, the graze casts are not timed
+  r64 frequency = (r64)SDL_GetPerformanceFrequency();
+  r64 query_rate = query_ticks > 0 ? query_count*frequency/query_ticks : 0.0;
+  r64 loop_rate = loop_ticks > 0 ? query_count*frequency/loop_ticks : 0.0;
+  printf("  %.0f queries/s through the hierarchy, %.0f looping over every collider (%.1fx)\n",
+	 query_rate, loop_rate, loop_rate > 0.0 ? query_rate/loop_rate : 0.0);
+
+  free(loop_overlaps);
+  free(overlap_arena.buffer);
+  free(collision_arena.buffer);
+  free(store_arena.buffer);
+  free(level_arena.buffer);
+  return mismatches;
+}
+
+int main(int argc, char* argv[]) {
+  u32 query_count = 20000;
+  u64 seed = 1;
+  const char *inputs[256];
+  u32 input_count = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-queries") == 0 && i + 1 < argc) {
+      query_count = (u32)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+      seed = strtoull(argv[++i], NULL, 10);
+    } else if (input_count < sizeof(inputs)/sizeof(inputs[0])) {
+      inputs[input_count++] = argv[i];
+    }
+  }
+  if (input_count == 0 || query_count == 0) {
+    printf("usage: %s [-queries <n>] [-seed <n>] <level.txt>...\n", argv[0]);
+    return -1;
+  }
+
+  ThreadPool pool;
+  thread_pool_init(&pool, -1);
+  u32 mismatches = 0;
+  for (u32 i = 0; i < input_count; i++) {
+    mismatches += check_level(inputs[i], query_count, seed + i, &pool);
+  }
+  thread_pool_shutdown(&pool);
+  return mismatches ? -1 : 0;
+}
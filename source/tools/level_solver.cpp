@@ -0,0 +1,558 @@
+// @description: level solvability checker. Searches the states the player can reach
+// in a level with the game's own movement (sim_step: jumps, air control,
+// INVERT_GRAVITY, teleporters), breadth first over inputs held for
+// SOLVER_ACTION_TICKS ticks, and reports whether a GOAL is reachable along with the
+// shortest input sequence that reaches it. States are merged when they round to the
+// same position, velocity, contact flags and timer bucket, the first one found is the
+// one kept. Merging makes the search inexact: a level it exhausts without reaching
+// a GOAL is reported as not found at this quantum, not as unsolvable.
+// Each layer of the search is simulated in parallel, every thread on its own copy
+// of the level; the result does not depend on the thread count.
+// usage: level_solver [-threads <n>] [-quantum <px>] [-max_states <n>] [-max_steps <n>]
+//                     [-replays <dir>] <level.txt>...
+// e.g. level_solver -replays build/solutions levels/*.txt
+// -quantum is the position rounding, an eighth of an atom by default. Coarser
+// searches faster but merges states that are not alike and can miss solutions.
+// With -replays the solution of every solvable level is written as a replay,
+// <dir>/<level>.rep (dir has to exist), which main -headless -replay <file> plays back.
+// Replays of levels outside the level directory (generated levels) are played with
+// -level pointing at the level file.
+// Exits with 1 when no solution was found (or the search gave up), for CI.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "../core.h"
+#include "../memory/arena.h"
+#include "../math.h"
+#include "../threads/thread_pool.cpp"
+#include "../level/level.cpp"
+#include "../entity/entity_store.cpp"
+#include "../physics/colliders.cpp"
+#include "../physics/collision_grid.cpp"
+#include "../physics/occupancy.cpp"
+#include "../physics/contact_batch.cpp"
+#include "../physics/swept.cpp"
+#include "../sim/sim.cpp"
+#include "../sim/replay.cpp"
+#include "tool_common.h"
+
+// an input is held this long, 50ms at 120Hz
+#define SOLVER_ACTION_TICKS 6
+// the sim's jump_timer and gravity_flip_timer are rounded to buckets this long (ms)
+#define SOLVER_TIMER_BUCKET_MS (SOLVER_ACTION_TICKS*SIM_TICK_SECONDS*1000.0)
+// states further than this many atoms out of the level's bounds fell out of it
+#define SOLVER_BOUNDS_MARGIN 4.0f
+
+// @note: the inputs tried from every state, REPLAY_* buttons. A jump is pressed on
+// the first tick of the input only, like a key press.
+static const u32 solver_actions[] = {
+  0,
+  REPLAY_MOVE_LEFT,
+  REPLAY_MOVE_RIGHT,
+  REPLAY_JUMP,
+  REPLAY_MOVE_LEFT | REPLAY_JUMP,
+  REPLAY_MOVE_RIGHT | REPLAY_JUMP,
+};
+#define SOLVER_ACTION_COUNT ((u32)(sizeof(solver_actions)/sizeof(solver_actions[0])))
+
+static const char *solver_action_names[] = {
+  "none", "left", "right", "jump", "left+jump", "right+jump",
+};
+
+struct SolverNode {
+  SimState sim;
+  Vec3 position;	// player
+  u32 parent;		// node index, SOLVER_NO_PARENT for the start
+  u8 action;		// index into solver_actions that led here from parent
+  u8 ticks;		// ticks the action ran, fewer than SOLVER_ACTION_TICKS when it reached the goal
+  b8 goal;
+};
+#define SOLVER_NO_PARENT 0xFFFFFFFF
+
+// @note: a copy of the level for one thread. sim_step writes the player's entity,
+// and collision queries use scratch memory in the grid, so nothing is shared.
+struct SolverWorld {
+  Arena store_arena;
+  Arena collision_arena;
+  EntityStore store;
+  ColliderSet colliders;
+  CollisionGrid collision_grid;
+  OccupancyMap occupancy;
+  SimLevel level;
+};
+
+// @note: the children a thread simulated for its slice of the frontier
+struct SolverChunk {
+  u32 first;
+  u32 count;
+  SolverNode *children;
+  u32 child_capacity;
+};
+
+struct Solver {
+  ThreadPool pool;
+  u32 world_count;
+  SolverWorld *worlds;
+  SolverChunk *chunks;
+  SimTuning tuning;
+  Rect bounds;		// states outside of this are dropped
+  r32 quantum;
+  // search
+  SolverNode *nodes;
+  u32 node_count;
+  u32 node_capacity;
+  u32 *frontier;
+  u32 frontier_count;
+  u32 *next_frontier;
+  u32 next_count;
+  u64 *visited;		// open addressing set of state keys, 0 is empty
+  u32 visited_mask;
+};
+
+static void solver_world_build(SolverWorld *world, Level *level, Vec2 atom_size) {
+  arena_clear(&world->store_arena);
+  arena_clear(&world->collision_arena);
+  arena_reserve(&world->store_arena, entity_store_size(level->entity_count + ENTITY_SPAWN_RESERVE));
+  entity_store_init(&world->store, &world->store_arena, level->entity_count + ENTITY_SPAWN_RESERVE);
+  entity_store_load(&world->store, level->entities, level->entity_count);
+
+  EntityStore *store = &world->store;
+  arena_reserve(&world->collision_arena, collider_set_size(store) +
+					 collision_grid_size(store, atom_size) +
+					 occupancy_size(store, atom_size));
+  collider_set_build(&world->colliders, &world->collision_arena, store);
+  collision_grid_build(&world->collision_grid, &world->collision_arena, &world->colliders, atom_size);
+  occupancy_build(&world->occupancy, &world->collision_arena, store, atom_size);
+
+  SimLevel *sim_level = &world->level;
+  sim_level->store = store;
+  sim_level->colliders = &world->colliders;
+  sim_level->collision_grid = &world->collision_grid;
+  sim_level->occupancy = &world->occupancy;
+  sim_level->player = entity_query(store, PLAYER).indices[0];
+}
+
+// @description: puts the player of world where node has it
+static void solver_world_restore(SolverWorld *world, SolverNode *node) {
+  SimLevel *level = &world->level;
+  entity_store_set_position(level->store, level->player, node->position);
+}
+
+static void solver_set_input(u32 buttons, b8 first_tick, Controller *controller, r32 *key_down_time) {
+  controller->move_left = (buttons & REPLAY_MOVE_LEFT) != 0;
+  controller->move_right = (buttons & REPLAY_MOVE_RIGHT) != 0;
+  controller->jump = first_tick && (buttons & REPLAY_JUMP) != 0;
+  key_down_time[PK_A] = controller->move_left ? 1.0f : 0.0f;
+  key_down_time[PK_D] = controller->move_right ? 1.0f : 0.0f;
+}
+
+static inline u64 solver_mix(u64 h, s64 value) {
+  h ^= (u64)value + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+  h = (h ^ (h >> 30))*0xBF58476D1CE4E5B9ull;
+  return h ^ (h >> 27);
+}
+
+static inline s64 solver_round(r32 value, r32 step) {
+  return (s64)floorf(value/step + 0.5f);
+}
+
+// @description: key of the cell of state space the node falls in. Everything sim_step
+// reads from SimState is in it, continuous values rounded.
+// @note: a jump only checks jump_timer > 100, every longer wait shares one bucket;
+// gravity flips again once gravity_flip_timer is down to 0, which gets its own.
+static u64 solver_state_key(SolverNode *node, r32 quantum) {
+  SimState *sim = &node->sim;
+  u64 flags = 0;
+  flags |= (u64)(sim->gravity_diry > 0.0f) << 0;
+  flags |= (u64)sim->collidex << 1;
+  flags |= (u64)sim->collidey << 2;
+  flags |= (u64)sim->is_collide_bottom << 3;
+  flags |= (u64)sim->is_collide_top << 4;
+  flags |= (u64)sim->inside_teleporter << 5;
+  flags |= (u64)sim->teleporting << 6;
+  flags |= (u64)sim->flip_gravity << 7;
+  flags |= (u64)MIN(sim->jump_count, 3u) << 10;
+  flags |= (u64)(sim->move_dir.x > 0.0f) << 12;
+  flags |= (u64)(sim->move_dir.x < 0.0f) << 13;
+
+  u64 h = solver_mix(0, (s64)flags);
+  h = solver_mix(h, solver_round(node->position.x, quantum));
+  h = solver_mix(h, solver_round(node->position.y, quantum));
+  h = solver_mix(h, solver_round(sim->effective_force, quantum/8.0f));
+  h = solver_mix(h, solver_round(sim->player_velocity.y, quantum/4.0f));
+  s64 jump_bucket = sim->jump_timer > 100.0 ? (s64)(100.0/SOLVER_TIMER_BUCKET_MS) + 1
+                                            : (s64)(sim->jump_timer/SOLVER_TIMER_BUCKET_MS);
+  h = solver_mix(h, jump_bucket);
+  h = solver_mix(h, (s64)ceil(sim->gravity_flip_timer/SOLVER_TIMER_BUCKET_MS));
+  return h != 0 ? h : 1;
+}
+
+static void solver_visited_grow(Solver *solver) {
+  u32 old_capacity = solver->visited_mask + 1;
+  u64 *old = solver->visited;
+  u32 capacity = old_capacity*2;
+  solver->visited = (u64*)calloc(capacity, sizeof(u64));
+  SDL_assert(solver->visited != NULL);
+  solver->visited_mask = capacity - 1;
+  for (u32 i = 0; i < old_capacity; i++) {
+    if (old[i] == 0) {
+      continue;
+    }
+    u32 slot = (u32)old[i] & solver->visited_mask;
+    while (solver->visited[slot] != 0) {
+      slot = (slot + 1) & solver->visited_mask;
+    }
+    solver->visited[slot] = old[i];
+  }
+  free(old);
+}
+
+// @description: adds key to the visited set, returns 0 if it was already there
+static b8 solver_visit(Solver *solver, u64 key) {
+  if ((u64)solver->node_count*2 >= (u64)solver->visited_mask + 1) {
+    solver_visited_grow(solver);
+  }
+  u32 slot = (u32)key & solver->visited_mask;
+  while (solver->visited[slot] != 0) {
+    if (solver->visited[slot] == key) {
+      return 0;
+    }
+    slot = (slot + 1) & solver->visited_mask;
+  }
+  solver->visited[slot] = key;
+  return 1;
+}
+
+static u32 solver_push_node(Solver *solver, SolverNode *node) {
+  if (solver->node_count == solver->node_capacity) {
+    solver->node_capacity *= 2;
+    solver->nodes = (SolverNode*)realloc(solver->nodes, solver->node_capacity*sizeof(SolverNode));
+    solver->frontier = (u32*)realloc(solver->frontier, solver->node_capacity*sizeof(u32));
+    solver->next_frontier = (u32*)realloc(solver->next_frontier, solver->node_capacity*sizeof(u32));
+    SDL_assert(solver->nodes != NULL && solver->frontier != NULL && solver->next_frontier != NULL);
+  }
+  solver->nodes[solver->node_count] = *node;
+  return solver->node_count++;
+}
+
+// @description: runs every action from the job's slice of the frontier, on the job's world
+static void solver_expand_job(void *data, u32 job_index) {
+  Solver *solver = (Solver*)data;
+  SolverWorld *world = &solver->worlds[job_index];
+  SolverChunk *chunk = &solver->chunks[job_index];
+  u32 needed = chunk->count*SOLVER_ACTION_COUNT;
+  if (needed > chunk->child_capacity) {
+    chunk->child_capacity = needed;
+    chunk->children = (SolverNode*)realloc(chunk->children, needed*sizeof(SolverNode));
+    SDL_assert(chunk->children != NULL);
+  }
+
+  r32 tick_seconds = (r32)SIM_TICK_SECONDS;
+  for (u32 f = 0; f < chunk->count; f++) {
+    u32 parent = solver->frontier[chunk->first + f];
+    SolverNode *from = &solver->nodes[parent];
+    for (u32 a = 0; a < SOLVER_ACTION_COUNT; a++) {
+      SolverNode *child = &chunk->children[f*SOLVER_ACTION_COUNT + a];
+      solver_world_restore(world, from);
+      child->sim = from->sim;
+      child->parent = parent;
+      child->action = (u8)a;
+      child->goal = 0;
+
+      Controller controller = {};
+      r32 key_down_time[5] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+      u32 t = 0;
+      while (t < SOLVER_ACTION_TICKS) {
+	solver_set_input(solver_actions[a], t == 0, &controller, key_down_time);
+	sim_step(&child->sim, &world->level, &solver->tuning, &controller, key_down_time, tick_seconds);
+	t++;
+	if (child->sim.level_state == 1) {
+	  child->goal = 1;
+	  break;
+	}
+      }
+      child->ticks = (u8)t;
+      child->position = entity_position(world->level.store, world->level.player);
+    }
+  }
+}
+
+struct SolverResult {
+  b8 solved;
+  b8 exhausted;		// every reachable state was searched, no limit was hit
+  u32 goal;		// node index
+  u32 steps;		// actions to the goal
+  u32 ticks;
+  u32 states;
+  r64 ms;
+};
+
+// @description: breadth first search from the level's start, the first layer that
+// reaches a goal holds the shortest solutions, the one with the fewest ticks wins
+static SolverResult solver_search(Solver *solver, Level *level, Vec2 atom_size,
+				  u32 max_states, u32 max_steps) {
+  u64 start_ticks = SDL_GetPerformanceCounter();
+  SolverResult result = {};
+
+  for (u32 w = 0; w < solver->world_count; w++) {
+    solver_world_build(&solver->worlds[w], level, atom_size);
+  }
+  SimLevel *start_level = &solver->worlds[0].level;
+  solver->bounds = entity_bounds(start_level->store, 0);
+  for (u32 i = 1; i < start_level->store->count; i++) {
+    solver->bounds = rect_union(solver->bounds, entity_bounds(start_level->store, i));
+  }
+  solver->bounds.lb = solver->bounds.lb - atom_size*SOLVER_BOUNDS_MARGIN;
+  solver->bounds.rt = solver->bounds.rt + atom_size*SOLVER_BOUNDS_MARGIN;
+
+  solver->node_count = 0;
+  memset(solver->visited, 0, (solver->visited_mask + 1)*sizeof(u64));
+  SolverNode start = {};
+  sim_init(&start.sim);
+  sim_level_reset(&start.sim);
+  // @note: the game starts out in no clip movement, the check is for gravity
+  start.sim.is_gravity = 1;
+  start.position = entity_position(start_level->store, start_level->player);
+  start.parent = SOLVER_NO_PARENT;
+  solver_visit(solver, solver_state_key(&start, solver->quantum));
+  u32 start_node = solver_push_node(solver, &start);
+  solver->frontier[0] = start_node;
+  solver->frontier_count = 1;
+
+  b8 limited = 0;
+  u32 goal = SOLVER_NO_PARENT;
+  u32 depth = 0;
+  while (solver->frontier_count > 0 && goal == SOLVER_NO_PARENT) {
+    if (depth == max_steps) {
+      limited = 1;
+      break;
+    }
+    depth++;
+
+    // @step: simulate, the frontier is split into one contiguous slice per world
+    u32 per_chunk = (solver->frontier_count + solver->world_count - 1)/solver->world_count;
+    u32 job_count = 0;
+    for (u32 first = 0; first < solver->frontier_count; first += per_chunk) {
+      SolverChunk *chunk = &solver->chunks[job_count++];
+      chunk->first = first;
+      chunk->count = MIN(per_chunk, solver->frontier_count - first);
+    }
+    thread_pool_run(&solver->pool, solver_expand_job, solver, job_count);
+
+    // @step: merge in frontier order, so the search does not depend on the threads
+    solver->next_count = 0;
+    for (u32 j = 0; j < job_count && !limited; j++) {
+      SolverChunk *chunk = &solver->chunks[j];
+      for (u32 c = 0; c < chunk->count*SOLVER_ACTION_COUNT; c++) {
+	SolverNode *child = &chunk->children[c];
+	if (child->goal) {
+	  if (goal == SOLVER_NO_PARENT || child->ticks < solver->nodes[goal].ticks) {
+	    goal = solver_push_node(solver, child);
+	  }
+	  continue;
+	}
+	Rect player = rect(child->position.v2(), entity_size(start_level->store, start_level->player));
+	if (!aabb_collision_rect(player, solver->bounds)) {
+	  continue;
+	}
+	if (solver->node_count >= max_states) {
+	  limited = 1;
+	  break;
+	}
+	if (solver_visit(solver, solver_state_key(child, solver->quantum))) {
+	  // @note: pushing can move the frontier arrays
+	  u32 node = solver_push_node(solver, child);
+	  solver->next_frontier[solver->next_count++] = node;
+	}
+      }
+    }
+    if (limited && goal == SOLVER_NO_PARENT) {
+      break;
+    }
+    u32 *swap = solver->frontier;
+    solver->frontier = solver->next_frontier;
+    solver->next_frontier = swap;
+    solver->frontier_count = solver->next_count;
+  }
+
+  result.states = solver->node_count;
+  result.exhausted = !limited;
+  if (goal != SOLVER_NO_PARENT) {
+    result.solved = 1;
+    result.goal = goal;
+    result.steps = depth;
+    result.ticks = (depth - 1)*SOLVER_ACTION_TICKS + solver->nodes[goal].ticks;
+  }
+  result.ms = (r64)(SDL_GetPerformanceCounter() - start_ticks)*1000.0/(r64)SDL_GetPerformanceFrequency();
+  return result;
+}
+
+// @description: the actions from the start to node, in order. Returns the count.
+static u32 solver_path(Solver *solver, u32 node, u32 *path, u32 capacity) {
+  u32 count = 0;
+  for (u32 n = node; solver->nodes[n].parent != SOLVER_NO_PARENT; n = solver->nodes[n].parent) {
+    count++;
+  }
+  SDL_assert(count <= capacity);
+  u32 i = count;
+  for (u32 n = node; solver->nodes[n].parent != SOLVER_NO_PARENT; n = solver->nodes[n].parent) {
+    path[--i] = n;
+  }
+  return count;
+}
+
+static void solver_print_path(Solver *solver, u32 *path, u32 count) {
+  printf("  input (%u ticks per step):", SOLVER_ACTION_TICKS);
+  for (u32 i = 0; i < count;) {
+    u32 action = solver->nodes[path[i]].action;
+    u32 run = 1;
+    while (i + run < count && solver->nodes[path[i + run]].action == action) {
+      run++;
+    }
+    printf(run > 1 ? " %s x%u" : " %s", solver_action_names[action], run);
+    printf(i + run < count ? "," : "\n");
+    i += run;
+  }
+}
+
+static b8 solver_write_replay(Solver *solver, u32 *path, u32 count, const char *level_name,
+			      const char *replay_path) {
+  ReplayRecorder recorder;
+  replay_record_begin(&recorder, level_name, &solver->nodes[0].sim);
+  Controller controller = {};
+  r32 key_down_time[5] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+  for (u32 i = 0; i < count; i++) {
+    SolverNode *node = &solver->nodes[path[i]];
+    for (u32 t = 0; t < node->ticks; t++) {
+      solver_set_input(solver_actions[node->action], t == 0, &controller, key_down_time);
+      replay_record_tick(&recorder, &controller, key_down_time);
+    }
+  }
+  return replay_record_end(&recorder, replay_path, solver->nodes[path[count - 1]].position);
+}
+
+// @description: file name of path without its directory and extension
+static void solver_level_name(const char *path, char *name, u32 capacity) {
+  const char *base = strrchr(path, '/');
+  base = base ? base + 1 : path;
+  u32 length = 0;
+  while (base[length] != 0 && base[length] != '.' && length + 1 < capacity) {
+    name[length] = base[length];
+    length++;
+  }
+  name[length] = 0;
+}
+
+int main(int argc, char* argv[]) {
+  s32 worker_count = -1;
+  r32 quantum = base_atom_size/8.0f;
+  u32 max_states = 8000000;
+  u32 max_steps = 4000;
+  const char *replay_dir = NULL;
+  const char *inputs[256];
+  u32 input_count = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc) {
+      worker_count = atoi(argv[++i]) - 1;
+    } else if (strcmp(argv[i], "-quantum") == 0 && i + 1 < argc) {
+      quantum = (r32)atof(argv[++i]);
+    } else if (strcmp(argv[i], "-max_states") == 0 && i + 1 < argc) {
+      max_states = (u32)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-max_steps") == 0 && i + 1 < argc) {
+      max_steps = (u32)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-replays") == 0 && i + 1 < argc) {
+      replay_dir = argv[++i];
+    } else if (input_count < sizeof(inputs)/sizeof(inputs[0])) {
+      inputs[input_count++] = argv[i];
+    }
+  }
+  if (input_count == 0 || quantum <= 0.0f || max_states == 0) {
+    printf("usage: %s [-threads <n>] [-quantum <px>] [-max_states <n>] [-max_steps <n>]"
+	   " [-replays <dir>] <level.txt>...\n", argv[0]);
+    return -1;
+  }
+
+  // replays are played back at this scale by main -headless
+  Vec2 render_scale = Vec2{1.0f, 1.0f};
+  Vec2 atom_size = Vec2{base_atom_size, base_atom_size};
+  r32 entity_z[ENTITY_TYPE_COUNT];
+  level_default_entity_z(entity_z);
+
+  Solver solver = {};
+  thread_pool_init(&solver.pool, worker_count);
+  solver.world_count = solver.pool.worker_count + 1;
+  solver.worlds = (SolverWorld*)calloc(solver.world_count, sizeof(SolverWorld));
+  solver.chunks = (SolverChunk*)calloc(solver.world_count, sizeof(SolverChunk));
+  size_t arena_size = KB(64);
+  for (u32 w = 0; w < solver.world_count; w++) {
+    arena_init(&solver.worlds[w].store_arena, (unsigned char*)malloc(arena_size), arena_size);
+    arena_init(&solver.worlds[w].collision_arena, (unsigned char*)malloc(arena_size), arena_size);
+  }
+  solver.tuning = sim_tuning(render_scale);
+  solver.quantum = quantum;
+  solver.node_capacity = 1024;
+  solver.nodes = (SolverNode*)malloc(solver.node_capacity*sizeof(SolverNode));
+  solver.frontier = (u32*)malloc(solver.node_capacity*sizeof(u32));
+  solver.next_frontier = (u32*)malloc(solver.node_capacity*sizeof(u32));
+  solver.visited_mask = 4096 - 1;
+  solver.visited = (u64*)calloc(solver.visited_mask + 1, sizeof(u64));
+  Arena level_arena;
+  arena_init(&level_arena, (unsigned char*)malloc(arena_size), arena_size);
+  u32 *path = (u32*)malloc((max_steps + 1)*sizeof(u32));
+
+  s32 res = 0;
+  for (u32 i = 0; i < input_count; i++) {
+    arena_clear(&level_arena);
+    Level level = {};
+    if (!level_load_text(&level, &level_arena, inputs[i], entity_z, render_scale, atom_size, &solver.pool)) {
+      printf("%s: ERROR :: failed to parse\n", inputs[i]);
+      res = 1;
+      continue;
+    }
+    u32 players = 0;
+    u32 goals = 0;
+    for (u32 e = 0; e < level.entity_count; e++) {
+      players += level.entities[e].type == PLAYER;
+      goals += level.entities[e].type == GOAL;
+    }
+    if (players == 0 || goals == 0) {
+      printf("%s: ERROR :: needs a player and a goal\n", inputs[i]);
+      res = 1;
+      continue;
+    }
+
+    SolverResult result = solver_search(&solver, &level, atom_size, max_states, max_steps);
+    if (!result.solved) {
+      if (result.exhausted) {
+	printf("%s: not found at this quantum (%.2fpx), %u states in %.1fms\n", inputs[i],
+	       quantum, result.states, result.ms);
+      } else {
+	printf("%s: UNKNOWN, search limit reached, %u states in %.1fms\n", inputs[i],
+	       result.states, result.ms);
+      }
+      res = 1;
+      continue;
+    }
+    printf("%s: solvable in %u steps (%.2fs of gameplay), %u states in %.1fms\n", inputs[i],
+	   result.steps, result.ticks*SIM_TICK_SECONDS, result.states, result.ms);
+    u32 path_count = solver_path(&solver, result.goal, path, max_steps + 1);
+    solver_print_path(&solver, path, path_count);
+
+    if (replay_dir) {
+      char level_name[48];
+      solver_level_name(inputs[i], level_name, sizeof(level_name));
+      char replay_path[512];
+      snprintf(replay_path, sizeof(replay_path), "%s/%s.rep", replay_dir, level_name);
+      if (!solver_write_replay(&solver, path, path_count, level_name, replay_path)) {
+	printf("  ERROR :: could not write %s\n", replay_path);
+	res = 1;
+      }
+    }
+  }
+
+  thread_pool_shutdown(&solver.pool);
+  return res;
+}
@@ -0,0 +1,168 @@
+// @description: tunnelling stress test for the player's continuous collision.
+// Random scenes of obstacles on an atom grid, each with the player mid air and
+// a fast motion in a random direction, run through one sim_step (the swept clamp,
+// the contact rules and the re-sweep of what they resolved to). A scene tunnels
+// when the player ends clear of every obstacle but got there along a line through
+// the inside of one. Lines that only cut through an obstacle's outer
+// SWEPT_PENETRATION are corner grazes, counted on their own.
+// usage: swept_stress [-scenes <n>] [-speed <px per tick>] [-seed <n>]
+// e.g. swept_stress -scenes 200000 -speed 400
+// Exits with 1 when a scene tunnelled.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "../core.h"
+#include "../memory/arena.h"
+#include "../math.h"
+#include "../level/level.h"
+#include "../entity/entity_store.cpp"
+#include "../physics/colliders.cpp"
+#include "../physics/collision_grid.cpp"
+#include "../physics/occupancy.cpp"
+#include "../physics/contact_batch.cpp"
+#include "../physics/swept.cpp"
+#include "../sim/sim.cpp"
+#include "tool_common.h"
+
+// scenes are STRESS_GRID atoms square, with up to STRESS_MAX_OBSTACLES obstacles
+#define STRESS_GRID 20
+#define STRESS_MAX_OBSTACLES 40
+
+static Entity stress_entity(s32 id, ENTITY_TYPE type, Vec2 position, Vec2 size) {
+  Entity e = {};
+  e.id = id;
+  e.type = type;
+  e.raw_position = Vec3{position.x, position.y, 0.0f};
+  e.raw_size = size;
+  e.position = e.raw_position;
+  e.size = size;
+  e.bounds = rect(position, size);
+  return e;
+}
+
+int main(int argc, char* argv[]) {
+  u32 scene_count = 200000;
+  r32 speed = 400.0f;
+  u64 seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-scenes") == 0 && i + 1 < argc) {
+      scene_count = (u32)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-speed") == 0 && i + 1 < argc) {
+      speed = (r32)atof(argv[++i]);
+    } else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+      seed = strtoull(argv[++i], NULL, 10);
+    } else {
+      printf("usage: %s [-scenes <n>] [-speed <px per tick>] [-seed <n>]\n", argv[0]);
+      return -1;
+    }
+  }
+
+  Vec2 atom_size = Vec2{base_atom_size, base_atom_size};
+  SimTuning tuning = sim_tuning(Vec2{1.0f, 1.0f});
+  r32 dt = (r32)SIM_TICK_SECONDS;
+  r32 frames = dt*SIM_TUNING_RATE;
+
+  size_t arena_size = KB(256);
+  Arena store_arena;
+  Arena collision_arena;
+  arena_init(&store_arena, (unsigned char*)malloc(arena_size), arena_size);
+  arena_init(&collision_arena, (unsigned char*)malloc(arena_size), arena_size);
+
+  ToolRandom random = tool_random(seed);
+  Entity entities[STRESS_MAX_OBSTACLES + 1];
+  u32 contacts = 0;
+  u32 tunnels = 0;
+  u32 grazes = 0;
+  for (u32 scene = 0; scene < scene_count; scene++) {
+    // @step: obstacles one atom high and up to three wide, the player anywhere clear of them
+    u32 obstacle_count = 1 + (u32)(tool_next(&random) % STRESS_MAX_OBSTACLES);
+    for (u32 i = 0; i < obstacle_count; i++) {
+      Vec2 cell = Vec2{(r32)(tool_next(&random) % STRESS_GRID), (r32)(tool_next(&random) % STRESS_GRID)};
+      Vec2 size = Vec2{atom_size.x*(r32)(1 + tool_next(&random) % 3), atom_size.y};
+      entities[i + 1] = stress_entity((s32)i + 1, OBSTACLE, Vec2{cell.x*atom_size.x, cell.y*atom_size.y}, size);
+    }
+    Rect start;
+    b8 clear = 0;
+    while (!clear) {
+      Vec2 position = Vec2{tool_range(&random, 0.0f, (STRESS_GRID - 1)*atom_size.x),
+			   tool_range(&random, 0.0f, (STRESS_GRID - 1)*atom_size.y)};
+      start = rect(position, atom_size);
+      clear = 1;
+      for (u32 i = 1; i <= obstacle_count; i++) {
+	clear = clear && !aabb_collision_rect(start, entities[i].bounds);
+      }
+    }
+    entities[0] = stress_entity(0, PLAYER, start.lb, atom_size);
+    u32 entity_count = obstacle_count + 1;
+
+    arena_clear(&store_arena);
+    arena_clear(&collision_arena);
+    arena_reserve(&store_arena, entity_store_size(entity_count + ENTITY_SPAWN_RESERVE));
+    EntityStore store;
+    entity_store_init(&store, &store_arena, entity_count + ENTITY_SPAWN_RESERVE);
+    entity_store_load(&store, entities, entity_count);
+    arena_reserve(&collision_arena, collider_set_size(&store) +
+				    collision_grid_size(&store, atom_size) +
+				    occupancy_size(&store, atom_size));
+    ColliderSet colliders;
+    CollisionGrid collision_grid;
+    OccupancyMap occupancy;
+    collider_set_build(&colliders, &collision_arena, &store);
+    collision_grid_build(&collision_grid, &collision_arena, &colliders, atom_size);
+    occupancy_build(&occupancy, &collision_arena, &store, atom_size);
+    SimLevel level = {&store, &colliders, &collision_grid, &occupancy, entity_query(&store, PLAYER).indices[0]};
+
+    // @step: mid air with no input a tick moves the player by its velocity, after
+    // air resistance on x and gravity on y. Pick the velocity that moves it by motion.
+    Vec2 motion = Vec2{tool_range(&random, -speed, speed), tool_range(&random, -speed, speed)};
+    SimState sim;
+    sim_init(&sim);
+    sim.is_gravity = 1;
+    r32 velocity_x = motion.x/frames;
+    if (ABS(velocity_x) >= tuning.fall_accelx) {
+      velocity_x += (velocity_x > 0.0f ? 1.0f : -1.0f)*tuning.fall_accelx*dt;
+    }
+    sim.effective_force = velocity_x;
+    sim.player_velocity.y = motion.y/frames - sim.gravity_diry*tuning.freefall_accel*dt;
+    Controller controller = {};
+    r32 key_down_time[5] = {};
+    sim_step(&sim, &level, &tuning, &controller, key_down_time, dt);
+
+    // @step: where the player ended, and what the line there passes through
+    Rect end = entity_bounds(&store, level.player);
+    Vec2 moved = end.lb - start.lb;
+    b8 end_clear = 1;
+    b8 through_core = 0;
+    b8 through = 0;
+    for (u32 c = 0; c < colliders.count; c++) {
+      if (!collider_is_alive(&colliders, c)) {
+	continue;
+      }
+      Rect target = colliders.bounds[c];
+      r32 time;
+      u32 axis;
+      end_clear = end_clear && !swept_overlap(end, target);
+      through = through || swept_aabb(start, moved, target, &time, &axis);
+      through_core = through_core || swept_aabb(start, moved, swept_core(target, SWEPT_PENETRATION), &time, &axis);
+    }
+    contacts += sim.collidex || sim.collidey;
+    if (end_clear && through_core) {
+      if (tunnels < 4) {
+	printf("tunnelled: scene %u, player at (%.2f, %.2f) asked to move (%.2f, %.2f), moved (%.2f, %.2f)\n",
+	       scene, start.lb.x, start.lb.y, sim.motion.x, sim.motion.y, moved.x, moved.y);
+      }
+      tunnels++;
+    } else if (end_clear && through) {
+      grazes++;
+    }
+  }
+
+  printf("%u scenes at up to %.1f px/tick: %u with a contact, %u tunnelled, %u corner grazes\n",
+	 scene_count, speed, contacts, tunnels, grazes);
+  free(collision_arena.buffer);
+  free(store_arena.buffer);
+  return tunnels > 0 ? 1 : 0;
+}
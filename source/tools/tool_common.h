@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../core.h"
+
+// @note: shared by the tools in source/tools, none of it is part of the game
+
+// @note: must match the base atom the game is designed around (see main)
+static const r32 base_atom_size = 64.0f;
+
+// @note: xorshift64*, the same stream for a given seed on every platform, so
+// generated levels, benchmarks and checks can be run again with -seed
+struct ToolRandom {
+  u64 state;
+};
+
+static ToolRandom tool_random(u64 seed) {
+  ToolRandom r = {seed*0x9E3779B97F4A7C15ull + 1};
+  return r;
+}
+
+static u64 tool_next(ToolRandom *r) {
+  r->state ^= r->state >> 12;
+  r->state ^= r->state << 25;
+  r->state ^= r->state >> 27;
+  return r->state * 2685821657736338717ull;
+}
+
+// uniform in [lo, hi)
+static r32 tool_range(ToolRandom *r, r32 lo, r32 hi) {
+  return lo + (hi - lo)*(r32)((tool_next(r) >> 40)/(r64)(1ull << 24));
+}